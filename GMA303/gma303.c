@@ -564,28 +564,34 @@ s8 gma303_initialization(void){
 	
 }
 
+static void _gma303_decode_data(const u8* pu8Data, raw_data_xyzt_t* pxyzt, u8 dLen){
+
+  s16 s16Tmp, i;
+
+  for(i = 0; i < dLen; ++i){
+    s16Tmp = (pu8Data[2*i + 4] << 8) | (pu8Data[2*i + 3]);
+    pxyzt->v[i] = s16Tmp;
+  }
+}
+
 s8 _gma303_read_data(raw_data_xyzt_t* pxyzt, u8 dLen){
 	
   s8 comRslt = -1;
-  u8 u8Data[11];
-  s16 s16Tmp, i;
+  u8 u8Data[GMA303_DATA_XYZT_LEN];
 
   do{
 	
     if(dLen == 3) //xyz
       comRslt = gma303_burst_read(GMA303_STADR__REG, u8Data, 9);
     else  //xyzt
-      comRslt = gma303_burst_read(GMA303_STADR__REG, u8Data, 11);
+      comRslt = gma303_burst_read(GMA303_STADR__REG, u8Data, GMA303_DATA_XYZT_LEN);
 		
     if(comRslt < 0) goto EXIT;
 		
   } while(0 && (GMA303_GET_BITSLICE(u8Data[2], GMA303_DRDY) == 0));//No Check DRDY bit
 	
 	
-  for(i = 0; i < dLen; ++i){
-    s16Tmp = (u8Data[2*i + 4] << 8) | (u8Data[2*i + 3]);
-    pxyzt->v[i] = s16Tmp;
-  }
+  _gma303_decode_data(u8Data, pxyzt, dLen);
 	
  EXIT:
   return comRslt;
@@ -623,3 +629,52 @@ s8 gma303_read_data_xyzt(raw_data_xyzt_t* pxyzt){
   return _gma303_read_data(pxyzt, 4);
 	
 }
+
+/*!
+ * @brief GMA303 start a non-blocking read of data XYZT
+ *        Safe to call from an interrupt handler, decode the bytes with
+ *        gma303_decode_data_xyzt() in the callback
+ *
+ * @param pu8Data Buffer of GMA303_DATA_XYZT_LEN bytes, must stay valid until the callback
+ * @param cb_fcn Callback called when the read completes, from the TWI interrupt
+ * @param p_user_data User data passed to the callback
+ * 
+ * @return Result of the read scheduling
+ * @retval 0 Success
+ * @retval -127 Error null bus
+ * @retval < 0 Negated nRF51 error code, the read is not scheduled
+ *
+ */
+s8 gma303_schedule_read_data_xyzt(u8* pu8Data, app_twi_callback_t cb_fcn, void* p_user_data){
+
+  ret_code_t errCode;
+
+  if(pBus_support == NULL)
+    return -127;
+
+  errCode = pBus_support->bus_schedule_read(pBus_support->p_app_twi,
+					    pBus_support->u8DevAddr,
+					    GMA303_STADR__REG,
+					    pu8Data,
+					    GMA303_DATA_XYZT_LEN,
+					    cb_fcn,
+					    p_user_data);
+  if(errCode != NRF_SUCCESS) //return the nRF51 error code
+    return -(s8)errCode;
+
+  return 0;
+}
+
+/*!
+ * @brief GMA303 decode the bytes of a XYZT burst read
+ *
+ * @param pu8Data The GMA303_DATA_XYZT_LEN bytes read
+ * @param pxyzt Data buffer to store the values
+ * 
+ * @return None
+ *
+ */
+void gma303_decode_data_xyzt(const u8* pu8Data, raw_data_xyzt_t* pxyzt){
+
+  _gma303_decode_data(pu8Data, pxyzt, 4);
+}
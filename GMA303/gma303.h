@@ -42,6 +42,7 @@
 #define GMA303_7BIT_I2C_ADDR		0x18
 #define MAX_MOTION_THRESHOLD            0x1F
 #define GMA303_RAW_DATA_SENSITIVITY     512  //raw data 512 code/g
+#define GMA303_DATA_XYZT_LEN            11   //bytes of a XYZT burst read
 
 #define GMA1302_REG_PID 	        0x00
 #define GMA1302_REG_PD 		        0x01
@@ -280,6 +281,34 @@ s8 gma303_read_data_xyz(raw_data_xyzt_t* pxyzt);
  */
 s8 gma303_read_data_xyzt(raw_data_xyzt_t* pxyzt);
 
+/*!
+ * @brief GMA303 start a non-blocking read of data XYZT
+ *        Safe to call from an interrupt handler, decode the bytes with
+ *        gma303_decode_data_xyzt() in the callback
+ *
+ * @param pu8Data Buffer of GMA303_DATA_XYZT_LEN bytes, must stay valid until the callback
+ * @param cb_fcn Callback called when the read completes, from the TWI interrupt
+ * @param p_user_data User data passed to the callback
+ * 
+ * @return Result of the read scheduling
+ * @retval 0 Success
+ * @retval -127 Error null bus
+ * @retval < 0 Negated nRF51 error code, the read is not scheduled
+ *
+ */
+s8 gma303_schedule_read_data_xyzt(u8* pu8Data, app_twi_callback_t cb_fcn, void* p_user_data);
+
+/*!
+ * @brief GMA303 decode the bytes of a XYZT burst read
+ *
+ * @param pu8Data The GMA303_DATA_XYZT_LEN bytes read
+ * @param pxyzt Data buffer to store the values
+ * 
+ * @return None
+ *
+ */
+void gma303_decode_data_xyzt(const u8* pu8Data, raw_data_xyzt_t* pxyzt);
+
 /*!
  * @brief Set GMA303 filter
  *
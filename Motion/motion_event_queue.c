@@ -0,0 +1,127 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_event_queue.c
+ *
+ * Usage: Motion event queue
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+#include "motion_event_queue.h"
+#include "motion_profile.h"
+
+#define QUEUE_INDEX_MASK (MOTION_EVENT_QUEUE_SIZE - 1)
+//Keep the slot access and the index update in order
+#define QUEUE_BARRIER() __sync_synchronize()
+
+/*!
+ * @brief Initialize the event queue
+ *
+ * @param pQueue Pointer to the event queue
+ *
+ * @return None
+ */
+void eventQueueInit(motion_event_queue_t *pQueue)
+{
+
+  pQueue->ui32Head = 0;
+  pQueue->ui32Tail = 0;
+  pQueue->ui32OverflowCount = 0;
+  pQueue->ui32HighWater = 0;
+  pQueue->ui32EnqueueTimeMax = 0;
+}
+
+/*!
+ * @brief Push an event, producer side
+ *        The event is dropped and counted as overflow if the queue is full
+ *        With MOTION_ALG_PROFILE the longest push is kept, timer read included
+ *
+ * @param pQueue Pointer to the event queue
+ * @param pEvent Pointer to the event to push
+ *
+ * @return 1 for success, 0 if the queue is full
+ */
+int8_t eventQueuePush(motion_event_queue_t *pQueue, const motion_event_t *pEvent)
+{
+
+  uint32_t ui32Head = pQueue->ui32Head;
+  uint32_t ui32Count = ui32Head - pQueue->ui32Tail;
+  MOTION_PROFILE_START(ui32Start);
+
+  if(ui32Count >= MOTION_EVENT_QUEUE_SIZE){
+    pQueue->ui32OverflowCount += 1;
+    MOTION_PROFILE_STOP_MAX(pQueue->ui32EnqueueTimeMax, ui32Start);
+    return 0;
+  }
+
+  pQueue->events[ui32Head & QUEUE_INDEX_MASK] = *pEvent;
+  QUEUE_BARRIER();
+  pQueue->ui32Head = ui32Head + 1;
+
+  if(ui32Count + 1 > pQueue->ui32HighWater)
+    pQueue->ui32HighWater = ui32Count + 1;
+
+  MOTION_PROFILE_STOP_MAX(pQueue->ui32EnqueueTimeMax, ui32Start);
+
+  return 1;
+}
+
+/*!
+ * @brief Pop an event, consumer side
+ *
+ * @param pQueue Pointer to the event queue
+ * @param pEvent Pointer to store the event
+ *
+ * @return 1 for success, 0 if the queue is empty
+ */
+int8_t eventQueuePop(motion_event_queue_t *pQueue, motion_event_t *pEvent)
+{
+
+  uint32_t ui32Tail = pQueue->ui32Tail;
+
+  if(ui32Tail == pQueue->ui32Head)
+    return 0;
+
+  *pEvent = pQueue->events[ui32Tail & QUEUE_INDEX_MASK];
+  QUEUE_BARRIER();
+  pQueue->ui32Tail = ui32Tail + 1;
+
+  return 1;
+}
+
+/*!
+ * @brief Get the event queue statistics
+ *
+ * @param pQueue Pointer to the event queue
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getEventQueueStats(motion_event_queue_t *pQueue, motion_event_queue_stats_t *pStats)
+{
+
+  pStats->ui32Pending = pQueue->ui32Head - pQueue->ui32Tail;
+  pStats->ui32HighWater = pQueue->ui32HighWater;
+  pStats->ui32OverflowCount = pQueue->ui32OverflowCount;
+  pStats->ui32EnqueueTimeMax = pQueue->ui32EnqueueTimeMax;
+  pStats->ui32Capacity = MOTION_EVENT_QUEUE_SIZE;
+}
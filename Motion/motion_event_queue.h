@@ -0,0 +1,113 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_event_queue.h
+ *
+ * Usage: Motion event queue
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#ifndef __MOTION_EVENT_QUEUE_H__
+#define __MOTION_EVENT_QUEUE_H__
+
+#include "type_support.h"
+
+//Queue capacity, must be a power of 2
+#define MOTION_EVENT_QUEUE_SIZE (16)
+
+typedef struct{
+
+  int32_t alg;              //algorithm raising the event, motion_algorithm_t
+  int32_t i32Data;          //event value
+  uint32_t ui32SampleIndex; //index of the sample raising the event, from 1
+
+} motion_event_t;
+
+typedef struct{
+
+  uint32_t ui32Capacity;      //queue capacity
+  uint32_t ui32Pending;       //events waiting for dispatch
+  uint32_t ui32HighWater;     //max number of pending events
+  uint32_t ui32OverflowCount; //events dropped because the queue was full
+  uint32_t ui32EnqueueTimeMax; //longest push in MOTION_PROFILE_UNIT, 0 unless MOTION_ALG_PROFILE
+
+} motion_event_queue_stats_t;
+
+/*
+ * Fixed capacity single-producer/single-consumer ring.
+ * The producer only writes ui32Head, the consumer only writes ui32Tail,
+ * so push and pop need no lock as long as there is one of each.
+ * Push and pop are constant time, no loop and no call.
+ */
+typedef struct{
+
+  volatile uint32_t ui32Head; //free running write index, producer side
+  volatile uint32_t ui32Tail; //free running read index, consumer side
+  uint32_t ui32OverflowCount; //events dropped because the queue was full
+  uint32_t ui32HighWater;     //max number of pending events
+  uint32_t ui32EnqueueTimeMax; //longest push, see motion_profile.h
+  motion_event_t events[MOTION_EVENT_QUEUE_SIZE];
+
+} motion_event_queue_t;
+
+/*!
+ * @brief Initialize the event queue
+ *
+ * @param pQueue Pointer to the event queue
+ *
+ * @return None
+ */
+void eventQueueInit(motion_event_queue_t *pQueue);
+
+/*!
+ * @brief Push an event, producer side
+ *        The event is dropped and counted as overflow if the queue is full
+ *
+ * @param pQueue Pointer to the event queue
+ * @param pEvent Pointer to the event to push
+ *
+ * @return 1 for success, 0 if the queue is full
+ */
+int8_t eventQueuePush(motion_event_queue_t *pQueue, const motion_event_t *pEvent);
+
+/*!
+ * @brief Pop an event, consumer side
+ *
+ * @param pQueue Pointer to the event queue
+ * @param pEvent Pointer to store the event
+ *
+ * @return 1 for success, 0 if the queue is empty
+ */
+int8_t eventQueuePop(motion_event_queue_t *pQueue, motion_event_t *pEvent);
+
+/*!
+ * @brief Get the event queue statistics
+ *
+ * @param pQueue Pointer to the event queue
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getEventQueueStats(motion_event_queue_t *pQueue, motion_event_queue_stats_t *pStats);
+
+#endif //__MOTION_EVENT_QUEUE_H__
@@ -27,61 +27,143 @@
  *
  **************************************************************************/
 #include <math.h>
-#include "nrf_delay.h"
+#include "motion_period.h"
 #include "motion_falldown.h"
 
-static int falling_down_flag;
-static int falling_down_once_flag;
-static int falling_still_counter;
-
 /*!
  * @brief Initialize the fall down detection
  *
- * @param None
+ * @param pParam Pointer to the fall down parameter struct
+ * @param ui32PeriodMs Processing period in ms
  *
  * @return None
  */
-void fallDownInit(void){
+void fallDownInit(motion_fall_param_t *pParam, uint32_t ui32PeriodMs){
+
+  pParam->state = FALL_STATE_IDLE;
+  pParam->i32Count = 0;
+  pParam->i32SinceImpact = 0;
+  pParam->i32FallDown = 0;
+  pParam->i32LatencyMs = 0;
 
-  falling_down_flag = 0;
-  falling_down_once_flag = 0;
-  falling_still_counter = 0;
+  pParam->i32FreeFallDuration = MOTION_ALG_MS_TO_COUNT(FALL_FREE_FALL_MS, (int32_t)ui32PeriodMs);
+  pParam->i32ImpactWindow = MOTION_ALG_MS_TO_COUNT(FALL_IMPACT_WINDOW_MS, (int32_t)ui32PeriodMs);
+  pParam->i32WaitDuration = MOTION_ALG_MS_TO_COUNT(FALL_WAIT_MS, (int32_t)ui32PeriodMs);
+  pParam->i32StillDuration = MOTION_ALG_MS_TO_COUNT(FALL_STILL_MS, (int32_t)ui32PeriodMs);
+  pParam->ui32PeriodMs = ui32PeriodMs;
 
 }
 
 /*!
- * @brief Process the fall down detection
+ * @brief Process the fall down detection, one step of the state machine
  *
- * @param[in] gVal accelerometer reading in g
+ * @param pParam Pointer to the fall down parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
+ * @param[in] pHpVal High-passed accelerometer reading in g
  *
- * @return fall down flag
- *         0: not detected
- *         1: fall down detected
+ * @return 1 if a fall is reported on this sample, 0 otherwise
  */
-int32_t processFallDown(float_xyzt_t gVal)
+int32_t processFallDown(motion_fall_param_t *pParam,
+			motion_features_t *pFeat,
+			const float_xyzt_t *pHpVal)
 {
 
-  if (!falling_down_once_flag){
+  int8_t isFreeFall = getFeatureMag2(pFeat) < FALL_FREE_FALL_G * FALL_FREE_FALL_G;
+  int32_t i32Res = 0;
+
+  if(pParam->state != FALL_STATE_IDLE)
+    ++pParam->i32Count;
+  if(pParam->state == FALL_STATE_POST_IMPACT || pParam->state == FALL_STATE_STILL)
+    ++pParam->i32SinceImpact;
+
+  switch(pParam->state){
+
+  case FALL_STATE_IDLE:
+    if(isFreeFall){
+      pParam->state = FALL_STATE_FREE_FALL;
+      pParam->i32Count = 1;
+    }
+    break;
+
+  case FALL_STATE_FREE_FALL:
+    if(isFreeFall)
+      break;
+
+    if(pParam->i32Count - 1 < pParam->i32FreeFallDuration){
+      pParam->state = FALL_STATE_IDLE;
+      break;
+    }
+
+    //long enough, this sample may already be the impact
+    pParam->state = FALL_STATE_IMPACT;
+    pParam->i32Count = 1;
+    //fall through
+
+  case FALL_STATE_IMPACT:
     // X+Y > 4G and Z < 4G
-    if ((fabsf(gVal.u.x) + fabsf(gVal.u.y)) > 4. && (fabsf(gVal.u.z) < 4.)){
-      falling_down_once_flag = 1;
-      falling_down_flag = 0;
-      nrf_delay_ms(1000);
+    if((fabsf(pHpVal->u.x) + fabsf(pHpVal->u.y)) > 4. && (fabsf(pHpVal->u.z) < 4.)){
+      pParam->state = FALL_STATE_POST_IMPACT;
+      pParam->i32Count = 0;
+      pParam->i32SinceImpact = 0;
+      pParam->i32FallDown = 0;
     }
-  }
-  else{
-    if ((fabsf(gVal.u.x) < 0.25) && (fabsf(gVal.u.y) < 0.25) && (fabsf(gVal.u.z) < 0.5)){
-      falling_still_counter ++;
-      if (falling_still_counter >= 7){
-	falling_down_flag = 1;
-	falling_still_counter = 7;
-      }
+    else if(isFreeFall){
+      //falling again
+      pParam->state = FALL_STATE_FREE_FALL;
+      pParam->i32Count = 1;
     }
-    else{
-      falling_still_counter = 0;
-      falling_down_once_flag = 0;
+    else if(pParam->i32Count >= pParam->i32ImpactWindow)
+      pParam->state = FALL_STATE_IDLE;
+    break;
+
+  case FALL_STATE_POST_IMPACT:
+    if(pParam->i32Count >= pParam->i32WaitDuration){
+      pParam->state = FALL_STATE_STILL;
+      pParam->i32Count = 0;
+    }
+    break;
+
+  default: //FALL_STATE_STILL
+    if((fabsf(pHpVal->u.x) < 0.25) && (fabsf(pHpVal->u.y) < 0.25) && (fabsf(pHpVal->u.z) < 0.5)){
+      if(pParam->i32Count >= pParam->i32StillDuration){
+	pParam->state = FALL_STATE_IDLE;
+	pParam->i32FallDown = 1;
+	pParam->i32LatencyMs = pParam->i32SinceImpact * (int32_t)pParam->ui32PeriodMs;
+	i32Res = 1;
+      }
     }
+    else
+      pParam->state = FALL_STATE_IDLE;
+    break;
   }
-	
-  return falling_down_flag;
+
+  return i32Res;
+}
+
+/*!
+ * @brief Get the fall down flag
+ *
+ * @param pParam Pointer to the fall down parameter struct
+ *
+ * @return fall down flag
+ *         0: not detected
+ *         1: fall down detected, until the next impact
+ */
+int32_t getFallDown(motion_fall_param_t *pParam)
+{
+
+  return pParam->i32FallDown;
+}
+
+/*!
+ * @brief Get the latency of the last fall report
+ *
+ * @param pParam Pointer to the fall down parameter struct
+ *
+ * @return Time from the impact to the report in ms, 0 if no fall yet
+ */
+int32_t getFallDownLatencyMs(motion_fall_param_t *pParam)
+{
+
+  return pParam->i32LatencyMs;
 }
@@ -27,29 +27,99 @@
  *
  **************************************************************************/
 
+
+/*! @file motion_falldown.h
+ *  @brief Fall detection as a state machine advanced once per sample,
+ *         nothing waits inside the processing:
+ *           free fall:   |g| below FALL_FREE_FALL_G for FALL_FREE_FALL_MS
+ *           impact:      within FALL_IMPACT_WINDOW_MS after the free fall,
+ *                        X+Y > 4g and Z < 4g on the high-passed data
+ *           post impact: FALL_WAIT_MS of samples are skipped
+ *           stillness:   high-passed data within +/-0.25g on X and Y and
+ *                        +/-0.5g on Z for FALL_STILL_MS, any other sample
+ *                        drops the fall
+ *  The fall is reported on the last sample of the stillness, its latency
+ *  from the impact is FALL_WAIT_MS + FALL_STILL_MS.
+ */
+
 #ifndef __MOTION_FALLDOWN_H__
 #define __MOTION_FALLDOWN_H__
 
 #include "type_support.h"
+#include "motion_features.h"
+
+#define FALL_FREE_FALL_G        (0.6f)
+#define FALL_FREE_FALL_MS       (80)
+#define FALL_IMPACT_WINDOW_MS   (500)
+#define FALL_WAIT_MS            (1000)
+#define FALL_STILL_MS           (280)
+
+typedef enum {
+  FALL_STATE_IDLE,
+  FALL_STATE_FREE_FALL,
+  FALL_STATE_IMPACT,       //free fall seen, waiting for the impact
+  FALL_STATE_POST_IMPACT,
+  FALL_STATE_STILL
+} motion_fall_state_t;
+
+typedef struct{
+
+  motion_fall_state_t state;
+  int32_t i32Count;               //samples in the state
+  int32_t i32SinceImpact;         //samples from the impact
+  int32_t i32FallDown;            //fall seen, cleared by the next impact
+  int32_t i32LatencyMs;           //from the impact to the last fall report
+
+  //settings in samples
+  int32_t i32FreeFallDuration;
+  int32_t i32ImpactWindow;
+  int32_t i32WaitDuration;
+  int32_t i32StillDuration;
+  uint32_t ui32PeriodMs;
+
+} motion_fall_param_t;
 
 /*!
  * @brief Initialize the fall down detection
  *
- * @param None
+ * @param pParam Pointer to the fall down parameter struct
+ * @param ui32PeriodMs Processing period in ms
  *
  * @return None
  */
-void fallDownInit(void);
+void fallDownInit(motion_fall_param_t *pParam, uint32_t ui32PeriodMs);
 
 /*!
- * @brief Process the fall down detection
+ * @brief Process the fall down detection, one step of the state machine
  *
- * @param[in] gVal accelerometer reading in g
+ * @param pParam Pointer to the fall down parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
+ * @param[in] pHpVal High-passed accelerometer reading in g
+ *
+ * @return 1 if a fall is reported on this sample, 0 otherwise
+ */
+int32_t processFallDown(motion_fall_param_t *pParam,
+			motion_features_t *pFeat,
+			const float_xyzt_t *pHpVal);
+
+/*!
+ * @brief Get the fall down flag
+ *
+ * @param pParam Pointer to the fall down parameter struct
  *
  * @return fall down flag
  *         0: not detected
- *         1: fall down detected
+ *         1: fall down detected, until the next impact
+ */
+int32_t getFallDown(motion_fall_param_t *pParam);
+
+/*!
+ * @brief Get the latency of the last fall report
+ *
+ * @param pParam Pointer to the fall down parameter struct
+ *
+ * @return Time from the impact to the report in ms, 0 if no fall yet
  */
-int32_t processFallDown(float_xyzt_t gVal);
+int32_t getFallDownLatencyMs(motion_fall_param_t *pParam);
 
 #endif //__MOTION_FALLDOWN_H__
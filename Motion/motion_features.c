@@ -0,0 +1,51 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_features.c
+ *
+ * Usage: Per-sample features shared by the motion algorithms
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stddef.h>
+#include "motion_period.h"
+#include "motion_features.h"
+
+/*!
+ * @brief Initialize a feature record
+ *
+ * @param pFeat Pointer to the feature record
+ * @param ui32PeriodMs Period of the samples in ms
+ *
+ * @return None
+ */
+void featuresInit(motion_features_t *pFeat, uint32_t ui32PeriodMs)
+{
+
+  pFeat->pgVal = NULL;
+  pFeat->ui32Index = 0;
+  pFeat->ui32Valid = 0;
+  pFeat->ui32HpIndex = 0;
+  pFeat->fAlphaHp = MOTION_ALG_PERIOD_ALPHA(MOTION_FEATURE_HP_ALPHA, ui32PeriodMs);
+  iirHpfXyzInit(&pFeat->iirHp);
+}
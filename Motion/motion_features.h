@@ -0,0 +1,216 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_features.h
+ *
+ * Usage: Per-sample features shared by the motion algorithms
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file motion_features.h
+ *  @brief Features derived from one sample, computed on the first request
+ *         and cached until the next sample, so the algorithms processing
+ *         the same sample share them and features nobody asks for are never
+ *         computed.
+ *
+ *  The activity high-pass filter behind getFeatureHpMag2() keeps a state
+ *  across samples. It is run on request, and warm started again when a
+ *  sample was skipped, as if each user owned the filter.
+ */
+
+#ifndef __MOTION_FEATURES_H__
+#define __MOTION_FEATURES_H__
+
+#include <math.h>
+#include "type_support.h"
+#include "iir_filter.h"
+
+//Activity high-pass filter coefficient at MOTION_ALG_REF_PERIOD_MS
+#define MOTION_FEATURE_HP_ALPHA (0.9f)
+
+typedef enum {
+  MOTION_FEATURE_MAG2     = 1,   //x^2 + y^2 + z^2
+  MOTION_FEATURE_MAG      = 2,   //|g|
+  MOTION_FEATURE_XY_MAG   = 4,   //|g| in the XY plane
+  MOTION_FEATURE_COS_TILT = 8,   //z / |g|, cosine of the tilt from the Z axis
+  MOTION_FEATURE_HP_MAG2  = 16   //magnitude^2 of the activity high-pass output
+} motion_feature_t;
+
+typedef struct{
+
+  const float_xyzt_t *pgVal;  //sample in g
+  uint32_t ui32Index;         //sample counter, from 1
+  uint32_t ui32Valid;         //bit-or of motion_feature_t cached for this sample
+
+  float fMag2;
+  float fMag;
+  float fXyMag;
+  float fCosTilt;
+  float fHpMag2;
+
+  //activity high-pass filter
+  iir_hpf_xyz_t iirHp;
+  float fAlphaHp;
+  uint32_t ui32HpIndex;       //sample counter of the last filter update
+
+} motion_features_t;
+
+/*!
+ * @brief Initialize a feature record
+ *
+ * @param pFeat Pointer to the feature record
+ * @param ui32PeriodMs Period of the samples in ms
+ *
+ * @return None
+ */
+void featuresInit(motion_features_t *pFeat, uint32_t ui32PeriodMs);
+
+/*!
+ * @brief Start a new sample, the cached features are dropped
+ *
+ * @param pFeat Pointer to the feature record
+ * @param pgVal Sample in g, must stay valid until the next sample
+ *
+ * @return None
+ */
+static inline void featuresUpdate(motion_features_t *pFeat, const float_xyzt_t *pgVal)
+{
+
+  pFeat->pgVal = pgVal;
+  pFeat->ui32Valid = 0;
+  ++pFeat->ui32Index;
+}
+
+/*!
+ * @brief Magnitude^2 of the sample
+ *
+ * @param pFeat Pointer to the feature record
+ *
+ * @return x^2 + y^2 + z^2 in g^2
+ */
+static inline float getFeatureMag2(motion_features_t *pFeat)
+{
+
+  const float_xyzt_t *pgVal = pFeat->pgVal;
+
+  if(!(pFeat->ui32Valid & MOTION_FEATURE_MAG2)){
+    pFeat->fMag2 = pgVal->u.x * pgVal->u.x + pgVal->u.y * pgVal->u.y + pgVal->u.z * pgVal->u.z;
+    pFeat->ui32Valid |= MOTION_FEATURE_MAG2;
+  }
+
+  return pFeat->fMag2;
+}
+
+/*!
+ * @brief Magnitude of the sample
+ *
+ * @param pFeat Pointer to the feature record
+ *
+ * @return |g| in g
+ */
+static inline float getFeatureMag(motion_features_t *pFeat)
+{
+
+  if(!(pFeat->ui32Valid & MOTION_FEATURE_MAG)){
+    pFeat->fMag = sqrtf(getFeatureMag2(pFeat));
+    pFeat->ui32Valid |= MOTION_FEATURE_MAG;
+  }
+
+  return pFeat->fMag;
+}
+
+/*!
+ * @brief Magnitude of the sample in the XY plane
+ *
+ * @param pFeat Pointer to the feature record
+ *
+ * @return sqrt(x^2 + y^2) in g
+ */
+static inline float getFeatureXyMag(motion_features_t *pFeat)
+{
+
+  const float_xyzt_t *pgVal = pFeat->pgVal;
+
+  if(!(pFeat->ui32Valid & MOTION_FEATURE_XY_MAG)){
+    pFeat->fXyMag = sqrtf(pgVal->u.x * pgVal->u.x + pgVal->u.y * pgVal->u.y);
+    pFeat->ui32Valid |= MOTION_FEATURE_XY_MAG;
+  }
+
+  return pFeat->fXyMag;
+}
+
+/*!
+ * @brief Cosine of the tilt, angle between the sample and the Z axis
+ *
+ * @param pFeat Pointer to the feature record
+ *
+ * @return z / |g|, 0 for a zero sample
+ */
+static inline float getFeatureCosTilt(motion_features_t *pFeat)
+{
+
+  float mag;
+
+  if(!(pFeat->ui32Valid & MOTION_FEATURE_COS_TILT)){
+    //no direction, as if horizontal
+    mag = getFeatureMag(pFeat);
+    pFeat->fCosTilt = mag > 0.0f ? pFeat->pgVal->u.z / mag : 0.0f;
+    pFeat->ui32Valid |= MOTION_FEATURE_COS_TILT;
+  }
+
+  return pFeat->fCosTilt;
+}
+
+/*!
+ * @brief Magnitude^2 of the activity high-pass filter output
+ *
+ * @param pFeat Pointer to the feature record
+ *
+ * @return Magnitude^2 in g^2
+ */
+static inline float getFeatureHpMag2(motion_features_t *pFeat)
+{
+
+  float_xyzt_t fData_out;
+  int32_t i;
+
+  if(!(pFeat->ui32Valid & MOTION_FEATURE_HP_MAG2)){
+
+    //Warm start again after a gap
+    if(pFeat->ui32HpIndex + 1 != pFeat->ui32Index)
+      iirHpfXyzInit(&pFeat->iirHp);
+    pFeat->ui32HpIndex = pFeat->ui32Index;
+
+    filterHpfXyz(pFeat->pgVal->v, fData_out.v, pFeat->fAlphaHp, &pFeat->iirHp);
+
+    pFeat->fHpMag2 = 0.f;
+    for(i = 0; i < 3; ++i)
+      pFeat->fHpMag2 += fData_out.v[i] * fData_out.v[i];
+
+    pFeat->ui32Valid |= MOTION_FEATURE_HP_MAG2;
+  }
+
+  return pFeat->fHpMag2;
+}
+
+#endif //__MOTION_FEATURES_H__
@@ -0,0 +1,172 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_mag_run.c
+ *
+ * Usage: Threshold run detector on magnitude signals
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "motion_mag_run.h"
+
+/*!
+ * @brief Bits of a float as an int32
+ *        Non-negative floats have the order of their bits, and negative
+ *        ones are negative ints, below any threshold >= 0. No float
+ *        compare, a library call on the Cortex-M0.
+ *
+ * @param f Value
+ *
+ * @return Bits of f
+ */
+static inline int32_t magRunBits(float f)
+{
+
+  union{
+    float f;
+    int32_t i;
+  } u;
+
+  u.f = f;
+
+  return u.i;
+}
+
+/*!
+ * @brief Clamp a setting to a 16-bit counter
+ *
+ * @param val Value in samples or counts
+ *
+ * @return Value in [0, MAG_RUN_COUNTER_MAX]
+ */
+static uint16_t magRunClamp(int32_t val)
+{
+
+  if(val < 0)
+    return 0;
+
+  return (val > MAG_RUN_COUNTER_MAX) ? MAG_RUN_COUNTER_MAX : (uint16_t)val;
+}
+
+/*!
+ * @brief Initialize the threshold run detector
+ *
+ * @param pParam Pointer to the threshold run struct
+ * @param th Threshold, a negative one is taken as 0
+ * @param dur Run length above the threshold to count, in samples
+ * @param cnt Runs for an event
+ * @param tmd Time out from the first run, in samples
+ *
+ * @return None
+ */
+void magRunInit(motion_mag_run_t *pParam,
+		float th,
+		int32_t dur,
+		int32_t cnt,
+		int32_t tmd)
+{
+
+  //same result for values >= 0, and -0 to 0
+  pParam->threshold = (th > 0.f) ? magRunBits(th) : 0;
+  pParam->duration = magRunClamp(dur);
+  pParam->count = magRunClamp(cnt);
+  pParam->timeOutDuration = magRunClamp(tmd);
+
+  pParam->stateDuration = 0;
+  pParam->stateCount = 0;
+  pParam->stateTimeOutDuration = 0;
+  pParam->flagToCount = 0;
+  pParam->event = 0;
+}
+
+/*!
+ * @brief Process the threshold run detector
+ *
+ * @param pParam Pointer to the threshold run struct
+ * @param mag Value, >= 0
+ *
+ * @return 1 on an event, 0 otherwise
+ */
+int32_t processMagRun(motion_mag_run_t *pParam, float mag)
+{
+
+  uint32_t dur = pParam->stateDuration;
+  uint32_t cnt = pParam->stateCount;
+  uint32_t tmo = pParam->stateTimeOutDuration;
+  uint32_t flag = pParam->flagToCount;
+  int32_t event = 0;
+
+  if(magRunBits(mag) >= pParam->threshold){
+
+    if(dur != MAG_RUN_COUNTER_MAX)
+      ++dur;
+
+    //start of a run: the time out starts with the first one
+    if(dur == 1){
+      if(cnt == 0)
+	tmo = 0;
+      flag = 1;
+    }
+
+    //long enough: count once
+    if(flag && dur >= pParam->duration){
+      if(cnt != MAG_RUN_COUNTER_MAX)
+	++cnt;
+      flag = 0;
+    }
+  }
+  else
+    dur = 0;
+
+  //enough runs and back below
+  if(dur == 0 && cnt >= pParam->count){
+    event = 1;
+    cnt = tmo = flag = 0;
+  }
+
+  if(tmo >= pParam->timeOutDuration && pParam->timeOutDuration != MAG_RUN_COUNTER_MAX)
+    dur = cnt = tmo = flag = 0;
+  else if(tmo != MAG_RUN_COUNTER_MAX)
+    ++tmo;
+
+  pParam->stateDuration = (uint16_t)dur;
+  pParam->stateCount = (uint16_t)cnt;
+  pParam->stateTimeOutDuration = (uint16_t)tmo;
+  pParam->flagToCount = (uint8_t)flag;
+  pParam->event = (uint8_t)event;
+
+  return event;
+}
+
+/*!
+ * @brief Get the last event
+ *
+ * @param pParam Pointer to the threshold run struct
+ *
+ * @return 1 if the last sample raised an event, 0 otherwise
+ */
+int32_t getMagRunEvent(motion_mag_run_t *pParam)
+{
+
+  return pParam->event;
+}
@@ -0,0 +1,99 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_mag_run.h
+ *
+ * Usage: Threshold run detector on magnitude signals
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file motion_mag_run.h
+ *  @brief Counts runs of a non-negative signal, e.g. a magnitude^2, above a
+ *         threshold: an event once enough long enough runs were seen
+ *         before the time out, and the signal is back below.
+ *
+ *  Same rules as one face of one axis of the shake detection, without
+ *  its axis loop and negative face, which can never trigger on a
+ *  magnitude. Counters are 16-bit and saturate, a time out of
+ *  MAG_RUN_COUNTER_MAX samples or more never expires.
+ */
+
+#ifndef __MOTION_MAG_RUN_H__
+#define __MOTION_MAG_RUN_H__
+
+#include <stdint.h>
+
+#define MAG_RUN_COUNTER_MAX  0xFFFF
+
+typedef struct{
+
+  int32_t threshold;                 //bits of the threshold, >= 0
+  uint16_t duration;                 //run length to count, in samples
+  uint16_t count;                    //runs for an event
+  uint16_t timeOutDuration;          //in samples
+
+  uint16_t stateDuration;
+  uint16_t stateCount;
+  uint16_t stateTimeOutDuration;
+  uint8_t flagToCount;
+  uint8_t event;
+
+} motion_mag_run_t;
+
+/*!
+ * @brief Initialize the threshold run detector
+ *
+ * @param pParam Pointer to the threshold run struct
+ * @param th Threshold, a negative one is taken as 0
+ * @param dur Run length above the threshold to count, in samples
+ * @param cnt Runs for an event
+ * @param tmd Time out from the first run, in samples
+ *
+ * @return None
+ */
+void magRunInit(motion_mag_run_t *pParam,
+		float th,
+		int32_t dur,
+		int32_t cnt,
+		int32_t tmd);
+
+/*!
+ * @brief Process the threshold run detector
+ *
+ * @param pParam Pointer to the threshold run struct
+ * @param mag Value, >= 0
+ *
+ * @return 1 on an event, 0 otherwise
+ */
+int32_t processMagRun(motion_mag_run_t *pParam, float mag);
+
+/*!
+ * @brief Get the last event
+ *
+ * @param pParam Pointer to the threshold run struct
+ *
+ * @return 1 if the last sample raised an event, 0 otherwise
+ */
+int32_t getMagRunEvent(motion_mag_run_t *pParam);
+
+#endif //__MOTION_MAG_RUN_H__
@@ -27,572 +27,1394 @@
  *
  **************************************************************************/
 #include <stdio.h>
+#include <string.h>
 
 #include "motion_main_ctrl.h"
-#include "motion_pedo.h"
-#include "motion_falldown.h"
-#include "motion_shake.h"
-#include "motion_orientation.h"
-#include "motion_sleep_cycle.h"
-#include "iir_filter.h"
 
+//High-pass filter coefficients at MOTION_ALG_REF_PERIOD_MS
 #define alpha_pedo (0.8f)
 #define alpha_fall (0.5f)
 #define alpha_shake (0.4f)
-#define alpha_seden (0.9f)
-#define FLIP_INTERVAL_COUNT_THRESHOLD (1.0*MOTION_ALG_DATA_RATE_HZ)
+#define PEDO_PERIOD_MS         (40)  //PEDO_* step detector rate, 25Hz
+#define STEP_GAP_MS            (2000) //cadence starts over after a longer step interval
+#define STEP_INTERVAL_FRAC     (4)
+#define STEP_INTERVAL_SHIFT    (2)    //step interval average time constant, 4 steps
+#define FLIP_INTERVAL_MS       (1000)
+#define RAISE_CONFIRM_MS       (800)  //predicted raise to ORIENT_Z_POS
+#define RAISE_REFRACTORY_MS    (2000) //no prediction after a cancelled one
+#if MOTION_ALG_RAISE_PREDICT
+#define RAISE_HAND_PERIOD_MS   (0)
+#else
+#define RAISE_HAND_PERIOD_MS   (MOTION_ALG_ORIENT_PERIOD_MS)
+#endif
 #define SEDENTARY_THRESHOLD_G  (0.8)
-#define SEDENTARY_DURATION     (2)
+#define SEDENTARY_DURATION_MS  (80)
 #define SEDENTARY_COUNT        (40)
-#define SEDENTARY_TIME_OUT     (30*MOTION_ALG_DATA_RATE_HZ)
-
-static MOTION_ALG_EVENT_HANDLER eventHandler = NULL;
-static int32_t motionStates = 0, motionStates_pre = 0;
-static uint32_t timeStep = 0;
-
-//pedo states
-static uint32_t ui32StepCount = 0, ui32StepCount_pre = 0;
-static uint8_t ui8Activity = 0, ui8Activity_pre = 0;
-static float fCal = 0., fCal_pre = 0.;
-//Fall down states
-static int32_t i32FallDown = 0;
-//Shake states
-static int32_t i32ShakeState = EVENT_SHAKE_NONE;
-static motion_shake_param_t shakeParam;
-//Raise hand states
-static int32_t i32RaiseHandState = 0, i32RaiseHandState_pre = 0;
-//Flip states
-static int32_t i32FlipState = 0;
-static int32_t i32FlipIntervalCount = 0;
-//Sedentary states
-static int32_t i32SedenState = 0, i32SedenState_pre = 0;
-static int32_t i32SedenIntervalCount = 0, i32SedentaryDuration = 0;
-static int32_t i32SedenSnoozeCount = 0, i32SedenSnoozeDuration = 0;
-static motion_shake_param_t sedenShakeParam;
-//Sleep cycle state
-static motion_sleep_cycle_t sleepCycle = MOTION_SLEEP_CYCLE_NONE;
-static motion_sleep_cycle_t sleepCycle_pre = MOTION_SLEEP_CYCLE_NONE;
-
-//pedo high pass filter
-static float histX_pedo[3];
-static float histY_pedo[3];
-static float coeffA_pedo[] = {alpha_pedo};
-static float coeffB_pedo[] = {alpha_pedo, -alpha_pedo};
-static  iir_filter_param_t iirPedo = {
-  .dof = 3,
-  .lenCoeffA = 1,
-  .lenCoeffB = 2,
-  .histX = histX_pedo,
-  .histY = histY_pedo,
-  .coeffA = coeffA_pedo,
-  .coeffB = coeffB_pedo
+#define SEDENTARY_TIME_OUT_MS  (30000)
+
+//Algorithm registry entries, in processing order
+typedef enum {
+  MOTION_ALG_ENTRY_PEDO,
+  MOTION_ALG_ENTRY_FALL,
+  MOTION_ALG_ENTRY_SHAKE,
+  MOTION_ALG_ENTRY_ORIENT,
+  MOTION_ALG_ENTRY_RAISE_HAND,
+  MOTION_ALG_ENTRY_FLIP,
+  MOTION_ALG_ENTRY_SEDENTARY,
+  MOTION_ALG_ENTRY_SLEEP_CYCLE,
+  MOTION_ALG_ENTRY_TILT,
+  MOTION_ALG_ENTRY_COUNT
+} motion_alg_entry_t;
+
+#define MOTION_ALG_TABLE_SIZE  (sizeof(motionAlgTable) / sizeof(motionAlgTable[0]))
+#define MOTION_ALG_PEDO_ENTRY (&motionAlgTable[MOTION_ALG_ENTRY_PEDO])
+#define MOTION_ALG_SHAKE_ENTRY (&motionAlgTable[MOTION_ALG_ENTRY_SHAKE])
+#define MOTION_ALG_ORIENT_ENTRY (&motionAlgTable[MOTION_ALG_ENTRY_ORIENT])
+#define MOTION_ALG_SEDENTARY_ENTRY (&motionAlgTable[MOTION_ALG_ENTRY_SEDENTARY])
+
+//
+// Algorithm descriptor
+// An entry is enabled when any algorithm in its algMask is enabled, or when
+// an enabled entry depends on it. Entries are processed in table order, so
+// a dependency must be placed before the entries using it.
+// An entry runs every periodMs, on data decimated from the data rate, or on
+// every sample if periodMs is not longer than the sample period. Entries with
+// the same decimation share one decimation stage. An entry with a
+// maxSamplePeriodMs does not run on samples further apart: its algorithms
+// can not be enabled at lower data rates, nor the rate lowered while enabled.
+// Entries get the sample as a feature record, shared by the entries running
+// on the same sample, see motion_features.h.
+//
+typedef struct motion_alg_desc_s{
+
+  const char *name;                               //name in the profile report
+  int32_t algMask;                                //bit-or of motion_algorithm_t served
+  uint32_t periodMs;                              //processing period, 0 for every sample
+  uint32_t maxSamplePeriodMs;                     //longest sample period supported, 0 for any
+  const struct motion_alg_desc_s *pDependency;    //entry to run before this one
+  void (*init)(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);     //called when the entry gets enabled
+  void (*process)(motion_ctx_t *pCtx, motion_features_t *pFeat); //called on every sample
+  int32_t (*getState)(motion_ctx_t *pCtx, motion_algorithm_t alg); //state of an algorithm in algMask
+
+} motion_alg_desc_t;
+
+static motion_ctx_t defaultCtx;
+
+static void motion_alg_init_pedo(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_pedo(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_pedo(motion_ctx_t *pCtx, motion_algorithm_t alg);
+static void motion_alg_init_fall(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_fall(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_fall(motion_ctx_t *pCtx, motion_algorithm_t alg);
+static void motion_alg_init_shake(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_apply_shake_param(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_shake(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_shake(motion_ctx_t *pCtx, motion_algorithm_t alg);
+static void motion_alg_init_orient(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_orient(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static void motion_alg_init_raise_hand(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_raise_hand(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_raise_hand(motion_ctx_t *pCtx, motion_algorithm_t alg);
+static void motion_alg_init_flip(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_flip(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_flip(motion_ctx_t *pCtx, motion_algorithm_t alg);
+static void motion_alg_init_tilt(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_tilt(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_tilt(motion_ctx_t *pCtx, motion_algorithm_t alg);
+static void motion_alg_init_sedentary(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_apply_sedentary_param(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_sedentary(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_sedentary(motion_ctx_t *pCtx, motion_algorithm_t alg);
+static void motion_alg_init_sleep_cycle(motion_ctx_t *pCtx, uint32_t ui32PeriodMs);
+static void motion_alg_process_sleep_cycle(motion_ctx_t *pCtx, motion_features_t *pFeat);
+static int32_t motion_alg_get_state_sleep_cycle(motion_ctx_t *pCtx, motion_algorithm_t alg);
+
+//Algorithm registry, indexed by motion_alg_entry_t
+static const motion_alg_desc_t motionAlgTable[] = {
+  [MOTION_ALG_ENTRY_PEDO] = {
+    .name = "pedo",
+    .algMask = MOTION_ALG_PEDO | MOTION_ALG_CALORIE | MOTION_ALG_ACTIVITY | MOTION_ALG_STEP,
+    .periodMs = PEDO_PERIOD_MS,
+    .maxSamplePeriodMs = PEDO_PERIOD_MS,
+    .init = motion_alg_init_pedo,
+    .process = motion_alg_process_pedo,
+    .getState = motion_alg_get_state_pedo
+  },
+  [MOTION_ALG_ENTRY_FALL] = {
+    .name = "fall",
+    .algMask = MOTION_ALG_FALL,
+    .periodMs = 0,
+    .init = motion_alg_init_fall,
+    .process = motion_alg_process_fall,
+    .getState = motion_alg_get_state_fall
+  },
+  [MOTION_ALG_ENTRY_SHAKE] = {
+    .name = "shake",
+    .algMask = MOTION_ALG_SHAKE,
+    .periodMs = 0,
+    .init = motion_alg_init_shake,
+    .process = motion_alg_process_shake,
+    .getState = motion_alg_get_state_shake
+  },
+  [MOTION_ALG_ENTRY_ORIENT] = { //orientation, shared by raise hand and flip
+    .name = "orient",
+    .algMask = MOTION_ALG_NONE,
+    .periodMs = MOTION_ALG_ORIENT_PERIOD_MS,
+    .init = motion_alg_init_orient,
+    .process = motion_alg_process_orient
+  },
+  [MOTION_ALG_ENTRY_RAISE_HAND] = {
+    .name = "raise_hand",
+    .algMask = MOTION_ALG_RAISE_HAND,
+    .periodMs = RAISE_HAND_PERIOD_MS,
+    .pDependency = MOTION_ALG_ORIENT_ENTRY,
+    .init = motion_alg_init_raise_hand,
+    .process = motion_alg_process_raise_hand,
+    .getState = motion_alg_get_state_raise_hand
+  },
+  [MOTION_ALG_ENTRY_FLIP] = {
+    .name = "flip",
+    .algMask = MOTION_ALG_FLIP,
+    .periodMs = MOTION_ALG_ORIENT_PERIOD_MS,
+    .pDependency = MOTION_ALG_ORIENT_ENTRY,
+    .init = motion_alg_init_flip,
+    .process = motion_alg_process_flip,
+    .getState = motion_alg_get_state_flip
+  },
+  [MOTION_ALG_ENTRY_SEDENTARY] = {
+    .name = "sedentary",
+    .algMask = MOTION_ALG_SEDENTARY,
+    .periodMs = 0,
+    .init = motion_alg_init_sedentary,
+    .process = motion_alg_process_sedentary,
+    .getState = motion_alg_get_state_sedentary
+  },
+  [MOTION_ALG_ENTRY_SLEEP_CYCLE] = {
+    .name = "sleep_cycle",
+    .algMask = MOTION_ALG_SLEEP_CYCLE,
+    .periodMs = 0,
+    .init = motion_alg_init_sleep_cycle,
+    .process = motion_alg_process_sleep_cycle,
+    .getState = motion_alg_get_state_sleep_cycle
+  },
+  [MOTION_ALG_ENTRY_TILT] = {
+    .name = "tilt",
+    .algMask = MOTION_ALG_TILT,
+    .periodMs = MOTION_ALG_TILT_PERIOD_MS,
+    .init = motion_alg_init_tilt,
+    .process = motion_alg_process_tilt,
+    .getState = motion_alg_get_state_tilt
+  }
 };
 
-//fall high pass filter
-static float histX_fall[3];
-static float histY_fall[3];
-static float coeffA_fall[] = {alpha_fall};
-static float coeffB_fall[] = {alpha_fall, -alpha_fall};
-static  iir_filter_param_t iirFall = {
-  .dof = 3,
-  .lenCoeffA = 1,
-  .lenCoeffB = 2,
-  .histX = histX_fall,
-  .histY = histY_fall,
-  .coeffA = coeffA_fall,
-  .coeffB = coeffB_fall
-};
+_Static_assert(MOTION_ALG_TABLE_SIZE <= MOTION_ALG_MAX_ENTRIES,
+	       "MOTION_ALG_MAX_ENTRIES too small for the algorithm registry");
+_Static_assert(MOTION_ALG_TABLE_SIZE == MOTION_ALG_ENTRY_COUNT,
+	       "an algorithm registry entry has no motion_alg_entry_t");
+_Static_assert(MOTION_ALG_ENTRY_ORIENT < MOTION_ALG_ENTRY_RAISE_HAND &&
+	       MOTION_ALG_ENTRY_ORIENT < MOTION_ALG_ENTRY_FLIP,
+	       "orientation must be processed before raise hand and flip");
 
-//shake high pass filter
-static float histX_shake[3];
-static float histY_shake[3];
-static float coeffA_shake[] = {alpha_shake};
-static float coeffB_shake[] = {alpha_shake, -alpha_shake};
-static  iir_filter_param_t iirShake = {
-  .dof = 3,
-  .lenCoeffA = 1,
-  .lenCoeffB = 2,
-  .histX = histX_shake,
-  .histY = histY_shake,
-  .coeffA = coeffA_shake,
-  .coeffB = coeffB_shake
-};
+/*!
+ * @brief Get the algorithms that can not run at a data rate
+ *
+ * @param[in] rate Data rate
+ *
+ * @return A bit-or (|) combination of motion_algorithm_t
+ */
+static int32_t motion_alg_get_unsupported(motion_alg_rate_t rate)
+{
 
-//sedentary high pass filter
-static float histX_seden[3];
-static float histY_seden[3];
-static float coeffA_seden[] = {alpha_seden};
-static float coeffB_seden[] = {alpha_seden, -alpha_seden};
-static  iir_filter_param_t iirSeden = {
-  .dof = 3,
-  .lenCoeffA = 1,
-  .lenCoeffB = 2,
-  .histX = histX_seden,
-  .histY = histY_seden,
-  .coeffA = coeffA_seden,
-  .coeffB = coeffB_seden
-};
+  uint32_t i;
+  int32_t algMask = MOTION_ALG_NONE;
+
+  for(i = 0; i < MOTION_ALG_TABLE_SIZE; ++i)
+    if(motionAlgTable[i].maxSamplePeriodMs != 0 && (uint32_t)rate > motionAlgTable[i].maxSamplePeriodMs)
+      algMask |= motionAlgTable[i].algMask;
+
+  return algMask;
+}
+
+/*!
+ * @brief Check if an algorithm entry is needed by the enabled algorithms
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] pDesc Pointer to the algorithm descriptor
+ *
+ * @return 1 if needed, 0 otherwise
+ */
+static int8_t motion_alg_is_needed(motion_ctx_t *pCtx, const motion_alg_desc_t *pDesc)
+{
+
+  uint32_t i;
+
+  if(pDesc->algMask & pCtx->motionStates)
+    return 1;
+
+  for(i = 0; i < MOTION_ALG_TABLE_SIZE; ++i)
+    if(motionAlgTable[i].pDependency == pDesc && (motionAlgTable[i].algMask & pCtx->motionStates))
+      return 1;
+
+  return 0;
+}
 
 /*!
- * @brief Initialize the motion algorithm main control
+ * @brief Get the decimation of an algorithm entry at the data rate
  *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] pDesc Pointer to the algorithm descriptor
+ *
+ * @return Decimation factor, 1 for full rate
+ */
+static uint32_t motion_alg_get_decimation(const motion_ctx_t *pCtx, const motion_alg_desc_t *pDesc)
+{
+
+  uint32_t ui32SamplePeriodMs = (uint32_t)pCtx->rate;
+
+  if(pDesc->periodMs <= ui32SamplePeriodMs)
+    return 1;
+
+  return (pDesc->periodMs + ui32SamplePeriodMs / 2) / ui32SamplePeriodMs;
+}
+
+/*!
+ * @brief Get the processing period of an algorithm entry at the data rate
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] pDesc Pointer to the algorithm descriptor
+ *
+ * @return Period in ms
+ */
+static uint32_t motion_alg_get_period_ms(const motion_ctx_t *pCtx, const motion_alg_desc_t *pDesc)
+{
+
+  return (uint32_t)pCtx->rate * motion_alg_get_decimation(pCtx, pDesc);
+}
+
+/*!
+ * @brief Get the decimation stage for a decimation factor, stages in use keep
+ *        their states, a new stage is added if needed
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] stages_pre Stages before the update
+ * @param[in] ui32StageCount_pre Number of stages before the update
+ * @param[in] decimation Decimation factor
+ *
+ * @return Pointer to the stage, NULL for full rate
+ */
+static motion_alg_stage_t* motion_alg_get_stage(motion_ctx_t *pCtx,
+						const motion_alg_stage_t stages_pre[],
+						uint32_t ui32StageCount_pre,
+						uint32_t decimation)
+{
+
+  uint32_t i;
+  motion_alg_stage_t *pStage;
+
+  if(decimation <= 1)
+    return NULL;
+
+  for(i = 0; i < pCtx->ui32AlgStageCount; ++i)
+    if(pCtx->algStages[i].decimation == decimation)
+      return &pCtx->algStages[i];
+
+  pStage = &pCtx->algStages[pCtx->ui32AlgStageCount++];
+
+  for(i = 0; i < ui32StageCount_pre; ++i)
+    if(stages_pre[i].decimation == decimation)
+      break;
+
+  if(i < ui32StageCount_pre){
+    *pStage = stages_pre[i];
+  }
+  else{
+    pStage->decimation = decimation;
+    pStage->count = 0;
+    pStage->isReady = 0;
+    for(i = 0; i < 4; ++i)
+      pStage->sum.v[i] = pStage->out.v[i] = 0.0f;
+    featuresInit(&pStage->features, (uint32_t)pCtx->rate * decimation);
+  }
+
+  return pStage;
+}
+
+/*!
+ * @brief Update the decimation stage with a new sample
+ *
+ * @param[in] pStage Pointer to the stage
+ * @param[in] pgVal accelerometer reading in g
+ *
+ * @return None
+ */
+static void motion_alg_update_stage(motion_alg_stage_t *pStage, const float_xyzt_t *pgVal)
+{
+
+  int32_t i;
+  float fScale;
+
+  for(i = 0; i < 3; ++i)
+    pStage->sum.v[i] += pgVal->v[i];
+
+  pStage->isReady = (++pStage->count >= pStage->decimation);
+
+  if(pStage->isReady){
+
+    fScale = 1.0f / pStage->decimation;
+    for(i = 0; i < 3; ++i){
+      pStage->out.v[i] = pStage->sum.v[i] * fScale;
+      pStage->sum.v[i] = 0.0f;
+    }
+    pStage->out.v[3] = pgVal->v[3];
+    featuresUpdate(&pStage->features, &pStage->out);
+
+    pStage->count = 0;
+  }
+}
+
+/*!
+ * @brief Rebuild the enabled list, initialize the newly enabled entries
+ *
+ * @param[in] pCtx Pointer to the motion context
+ *
+ * @return None
+ */
+static void motion_alg_update_enabled(motion_ctx_t *pCtx)
+{
+
+  const motion_alg_desc_t *enabledAlgs_pre[MOTION_ALG_TABLE_SIZE];
+  uint32_t ui32EnabledAlgCount_pre = pCtx->ui32EnabledAlgCount;
+  motion_alg_stage_t algStages_pre[MOTION_ALG_TABLE_SIZE];
+  uint32_t ui32AlgStageCount_pre = pCtx->ui32AlgStageCount;
+  uint32_t i, j, ui32Decimation;
+
+  for(i = 0; i < ui32EnabledAlgCount_pre; ++i)
+    enabledAlgs_pre[i] = pCtx->enabledAlgs[i];
+
+  for(i = 0; i < ui32AlgStageCount_pre; ++i)
+    algStages_pre[i] = pCtx->algStages[i];
+
+  pCtx->ui32EnabledAlgCount = 0;
+  pCtx->ui32AlgStageCount = 0;
+
+  for(i = 0; i < MOTION_ALG_TABLE_SIZE; ++i){
+
+    if(!motion_alg_is_needed(pCtx, &motionAlgTable[i])) continue;
+
+    ui32Decimation = motion_alg_get_decimation(pCtx, &motionAlgTable[i]);
+    pCtx->enabledAlgStages[pCtx->ui32EnabledAlgCount] = motion_alg_get_stage(pCtx,
+									algStages_pre,
+									ui32AlgStageCount_pre,
+									ui32Decimation);
+    pCtx->enabledAlgs[pCtx->ui32EnabledAlgCount++] = &motionAlgTable[i];
+
+    //Initialize if it was not enabled
+    for(j = 0; j < ui32EnabledAlgCount_pre; ++j)
+      if(enabledAlgs_pre[j] == &motionAlgTable[i]) break;
+
+    if(j == ui32EnabledAlgCount_pre)
+      motionAlgTable[i].init(pCtx, (uint32_t)pCtx->rate * ui32Decimation);
+  }
+}
+
+/*!
+ * @brief Initialize a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
  * @param[in] eventFcn Motion event handler call back function
  *
  * @return 
  *         0: success
  *         1: fail
  */
-int8_t motion_alg_init(MOTION_ALG_EVENT_HANDLER eventFcn)
+int8_t motion_alg_init_ctx(motion_ctx_t *pCtx, MOTION_ALG_EVENT_HANDLER eventFcn)
 {
 
+#if MOTION_ALG_PROFILE
+  uint32_t i;
+#endif
+
   if(eventFcn == NULL)
     return 0;
 
-  eventHandler = eventFcn;
-  motionStates = 0;
-  timeStep = 0;
+  memset(pCtx, 0, sizeof(motion_ctx_t));
+
+  pCtx->eventHandler = eventFcn;
+  pCtx->rate = (motion_alg_rate_t)(1000 / MOTION_ALG_DATA_RATE_HZ);
+
+  //Shake settings in ms, converted when the shake detection gets enabled
+  pCtx->fShakeThG = DEFAULT_SHAKE_THRESHOLD;
+  pCtx->i32ShakeDurMs = DEFAULT_SHAKE_DURATION_MS;
+  pCtx->i32ShakeCnt = DEFAULT_SHAKE_COUNT;
+  pCtx->i32ShakeTimeOutMs = DEFAULT_SHAKE_TIME_OUT_MS;
+  pCtx->i32ShakeAxes = X_AXIS | Y_AXIS | Z_AXIS;
+  featuresInit(&pCtx->features, (uint32_t)pCtx->rate);
+  eventQueueInit(&pCtx->eventQueue);
+
+#if MOTION_ALG_PROFILE
+  profileTimerInit();
+  for(i = 0; i < MOTION_ALG_MAX_ENTRIES; ++i)
+    profileInit(&pCtx->profiles[i]);
+  profileInit(&pCtx->profileTotal);
+#endif
 
   return 1;
 }
 
 /*!
- * @brief Enable/Disenable algorithms
+ * @brief Enable/Disenable algorithms of a motion context
+ *        An algorithm is initialized when it gets enabled, algorithms that
+ *        are already enabled keep their states. The pedometer algorithms
+ *        are not enabled at 12.5Hz.
  *
+ * @param[in] pCtx Pointer to the motion context
  * @param[in] algSelections A bit-or (|) combination of motion_algorithm_t
  * @param[in] enable 1 to enable, 0 to disenble the selected algorithms
  *
  * @return None
  */
-void motion_alg_enable(int32_t algSelections, int8_t enable)
+void motion_alg_enable_ctx(motion_ctx_t *pCtx, int32_t algSelections, int8_t enable)
 {
 
   int i;
 
-  motionStates_pre = motionStates;
+  if(enable)
+    algSelections &= ~motion_alg_get_unsupported(pCtx->rate);
 
   for(i = 0; i < MOTION_ALG_COUNT; ++i){
 
     if((algSelections >> i) & 0x01){
       if(enable) //set bit
-	motionStates |= (1 << i);
+	pCtx->motionStates |= (1 << i);
       else //clear bit
-	motionStates &= (~(1 << i));
+	pCtx->motionStates &= (~(1 << i));
     }
   }
 
-  if(enable){ //enable
-
-    //Pedo, calorie and activity
-    if((motionStates_pre & (MOTION_ALG_PEDO | MOTION_ALG_CALORIE | MOTION_ALG_ACTIVITY)) == 0 &&
-       (motionStates & (MOTION_ALG_PEDO | MOTION_ALG_CALORIE | MOTION_ALG_ACTIVITY))){
+  motion_alg_update_enabled(pCtx);
+}
 
-      //printf("Pedo init\n");
-      
-      ui32StepCount = ui32StepCount_pre = 0;
-      ui8Activity = ui8Activity_pre = 0;
-      fCal = fCal_pre = 0.;
-      iirFilterInit(&iirPedo);  //Initialize pedo filter
-      pedoInit();
-    }
+/*!
+ * @brief Set the data rate of a motion context
+ *        Time constants are converted to the new rate, and the enabled
+ *        algorithms are initialized again, the step count and calories
+ *        carry on. The pedometer needs 25Hz or more, it runs on data
+ *        decimated to 25Hz at higher rates.
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] rate Data rate
+ *
+ * @return 1 for success, 0 if the rate is not supported or the pedometer
+ *         is enabled at 12.5Hz
+ */
+int8_t motion_alg_set_rate_ctx(motion_ctx_t *pCtx, motion_alg_rate_t rate)
+{
 
-    //fall down detection
-    if(motionStates & MOTION_ALG_FALL){
+  uint32_t ui32StepCount = pCtx->ui32StepCount;
+  float fCal = pCtx->fCal, fCal_pre = pCtx->fCal_pre;
 
-      //printf("Fall init\n");
+  switch(rate){
+  case MOTION_ALG_RATE_12_5HZ:
+  case MOTION_ALG_RATE_25HZ:
+  case MOTION_ALG_RATE_50HZ:
+  case MOTION_ALG_RATE_100HZ:
+    break;
+  default:
+    return 0;
+  }
 
-      i32FallDown = 0;
-      iirFilterInit(&iirFall); //Initialize fall filter
-      fallDownInit();
-    }
+  if(pCtx->motionStates & motion_alg_get_unsupported(rate))
+    return 0;
 
-    //Shake
-    if(motionStates & MOTION_ALG_SHAKE){
-      
-      //printf("Shake init\n");
+  pCtx->rate = rate;
+  featuresInit(&pCtx->features, (uint32_t)rate);
 
-      i32ShakeState = EVENT_SHAKE_NONE;
-      iirFilterInit(&iirShake); //Initialize shake filter
-      shakeInit(&shakeParam);
+  //Start over with new stages, all the needed entries get initialized
+  pCtx->ui32EnabledAlgCount = 0;
+  pCtx->ui32AlgStageCount = 0;
+  motion_alg_update_enabled(pCtx);
 
-    }
+  //The step detector starts over, the totals carry on from its new counts
+  pCtx->ui32StepCount = pCtx->ui32StepCount_pre = pCtx->ui32StepCountBase = ui32StepCount;
+  pCtx->fCal = pCtx->fCalBase = fCal;
+  pCtx->fCal_pre = fCal_pre;
 
-    //Raise hand & flip
-    if(motionStates & (MOTION_ALG_RAISE_HAND|MOTION_ALG_RAISE_HAND)){
-      
-      if((motionStates_pre & MOTION_ALG_RAISE_HAND) == 0 &&
-	 (motionStates & MOTION_ALG_RAISE_HAND)){
-	
-	//printf("Raise hand init\n");
+  return 1;
+}
 
-	i32RaiseHandState = i32RaiseHandState_pre = 0;
-      }
+/*!
+ * @brief Get algorithm state of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] alg Algorithm selected
+ *
+ * @return State of the selected algorithm
+ */
+int32_t motion_alg_get_state_ctx(motion_ctx_t *pCtx, motion_algorithm_t alg)
+{
 
-      if((motionStates_pre & MOTION_ALG_FLIP) == 0 &&
-	 (motionStates & MOTION_ALG_FLIP)){
-	
-	//printf("Flip init\n");
+  uint32_t i;
 
-	i32FlipState = 0;
-	i32FlipIntervalCount = 0;
-      }
+  for(i = 0; i < MOTION_ALG_TABLE_SIZE; ++i)
+    if((motionAlgTable[i].algMask & alg) && motionAlgTable[i].getState != NULL)
+      return motionAlgTable[i].getState(pCtx, alg);
 
-      if((motionStates_pre & (MOTION_ALG_RAISE_HAND|MOTION_ALG_RAISE_HAND)) == 0){
-	//printf("Orient init\n");
-	orientInit();
-      }
+  return 0;
+}
 
-    }
+/*!
+ * @brief Get the tilt angles of a motion context, MOTION_ALG_TILT
+ *        Updated every MOTION_ALG_TILT_PERIOD_MS, see motion_tilt.h
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[out] pTilt Pointer to store the angles, in 1/TILT_ANGLE_SCALE degree
+ *
+ * @return 1 for success, 0 if MOTION_ALG_TILT is disabled or no angle is
+ *         computed yet
+ */
+int8_t motion_alg_get_tilt_ctx(motion_ctx_t *pCtx, motion_tilt_t *pTilt)
+{
 
-    //Sedentary
-    if(motionStates & MOTION_ALG_SEDENTARY){
-
-      //printf("Sedentary init\n");
-
-      i32SedenState = i32SedenState_pre = i32SedenIntervalCount = 0;
-      
-      shakeInit(&sedenShakeParam);
-
-      setShakeThreshold(&sedenShakeParam,
-			SEDENTARY_THRESHOLD_G*SEDENTARY_THRESHOLD_G,
-			0,
-			0,
-			X_AXIS | Y_AXIS | Z_AXIS);
-      setShakeDuration(&sedenShakeParam,
-		       SEDENTARY_DURATION,
-		       0,
-		       0,
-		       X_AXIS | Y_AXIS | Z_AXIS);
-      setShakeCount(&sedenShakeParam,
-		    SEDENTARY_COUNT,
-		    0,
-		    0,
-		    X_AXIS | Y_AXIS | Z_AXIS);
-      setShakeTimeOutDuration(&sedenShakeParam,
-			      SEDENTARY_TIME_OUT,
-			      0,
-			      0,
-			      X_AXIS);
-      setShakeEnable(&sedenShakeParam, 1, 0, 0, X_AXIS | Y_AXIS | Z_AXIS);
+  if(!(pCtx->motionStates & MOTION_ALG_TILT))
+    return 0;
 
-    }
+  return getTilt(&pCtx->tiltParam, pTilt);
+}
 
-    //Sleep cycle monitor
-    if(motionStates & MOTION_ALG_SLEEP_CYCLE){
+/*!
+ * @brief Get the latency of the last fall of a motion context, MOTION_ALG_FALL
+ *
+ * @param[in] pCtx Pointer to the motion context
+ *
+ * @return Time from the impact to the fall event in ms, 0 if MOTION_ALG_FALL
+ *         is disabled or no fall is detected yet
+ */
+int32_t motion_alg_get_fall_latency_ctx(motion_ctx_t *pCtx)
+{
 
-      //printf("Sleep cycle init\n");
+  if(!(pCtx->motionStates & MOTION_ALG_FALL))
+    return 0;
 
-      sleepCycle = sleepCycle_pre = MOTION_SLEEP_CYCLE_NONE;
-      sleepCycleInit();
-    }
-  }
+  return getFallDownLatencyMs(&pCtx->fallParam);
 }
 
 /*!
- * @brief Get algorithm state
+ * @brief Get the index of the last sample processed by a motion context,
+ *        the ui32SampleIndex of the events raised on it
  *
- * @param[in] alg Algorithm selected
+ * @param[in] pCtx Pointer to the motion context
  *
- * @return State of the selected algorithm
+ * @return Samples processed since the context was initialized
  */
-int32_t motion_alg_get_state(motion_algorithm_t alg)
+uint32_t motion_alg_get_sample_index_ctx(motion_ctx_t *pCtx)
 {
-  switch(alg){
-  case MOTION_ALG_PEDO:
-    return (int32_t)ui32StepCount;
-  case MOTION_ALG_CALORIE:
-    return (int32_t)fCal;
-  case MOTION_ALG_ACTIVITY:
-    return (int32_t)ui8Activity;
-  case MOTION_ALG_FALL:
-    return i32FallDown;
-  case MOTION_ALG_SHAKE:
-    return i32ShakeState;
-  case MOTION_ALG_RAISE_HAND:
-    return i32RaiseHandState;
-  case MOTION_ALG_FLIP:
-    return i32FlipState;
-  case MOTION_ALG_SEDENTARY:
-    return i32SedenState;
-  case MOTION_ALG_SLEEP_CYCLE:
-    return sleepCycle;
-  default:
-    return 0;
-  }
+
+  return pCtx->timeStep;
 }
 
 /*!
- * @brief Reset pedo step, activity and calories
+ * @brief Reset pedo step, activity and calories of a motion context
  *
- * @param None
+ * @param[in] pCtx Pointer to the motion context
  *
  * @return None
  */
-void motion_pedo_reset(void)
+void motion_pedo_reset_ctx(motion_ctx_t *pCtx)
 {
-  ui32StepCount = ui32StepCount_pre = 0;
-  ui8Activity = ui8Activity_pre = 0;
-  fCal = fCal_pre = 0.;
-  pedoReset();
+  pCtx->ui32StepCount = pCtx->ui32StepCount_pre = pCtx->ui32StepCountBase = 0;
+  pCtx->ui8Activity = pCtx->ui8Activity_pre = 0;
+  pCtx->fCal = pCtx->fCal_pre = pCtx->fCalBase = 0.;
+  pedoReset(&pCtx->pedoParam);
 }
 
 /*!
- * @brief Set the calorie parameter
+ * @brief Set the calorie parameter of a motion context
  *
+ * @param[in] pCtx Pointer to the motion context
  * @param[in] ht_m Height in meter
  * @param[in] wt_kg Weight in kg
  *
  * @return None
  */
-void motion_calorie_set_param(float ht_m, float wt_kg)
+void motion_calorie_set_param_ctx(motion_ctx_t *pCtx, float ht_m, float wt_kg)
 {
-  pedoSetParam(ht_m, wt_kg);
+  pedoSetParam(&pCtx->pedoParam, ht_m, wt_kg);
 }
 
 /*!
- * @brief Set the shake parameters
+ * @brief Set the shake parameters of a motion context
  *
+ * @param[in] pCtx Pointer to the motion context
  * @param[in] th_g threshold in g
- * @param[in] dur Peak duration, number of time steps
+ * @param[in] dur_ms Peak duration in ms, at least one sample
  * @param[in] cnt Peak count
- * @param[in] timeout_s Timeout (sec) for the peak count
+ * @param[in] timeout_ms Timeout (ms) for the peak count, MAX_DURATION for none
  * @param[in] axes Select axes, a bit-or (|) combination of X_AXIS, Y_AXIS, Z_AXIS
  *
  * @return None
  */
-void motion_shake_set_param(float th_g,
-			    int32_t dur,
-			    int32_t cnt,
-			    float timeout_s,
-			    int32_t axes)
+void motion_shake_set_param_ctx(motion_ctx_t *pCtx,
+				float th_g,
+				int32_t dur_ms,
+				int32_t cnt,
+				int32_t timeout_ms,
+				int32_t axes)
 {
-  int32_t tm = (int32_t)(timeout_s * MOTION_ALG_DATA_RATE_HZ + 0.5f);
 
-  setShakeThreshold(&shakeParam, th_g, th_g, th_g, X_AXIS|Y_AXIS|Z_AXIS);
-  setShakeDuration(&shakeParam, dur, dur, dur, X_AXIS|Y_AXIS|Z_AXIS);
-  setShakeCount(&shakeParam, cnt, cnt, cnt, X_AXIS|Y_AXIS|Z_AXIS);
-  setShakeTimeOutDuration(&shakeParam, tm, tm, tm, X_AXIS|Y_AXIS|Z_AXIS);
+  pCtx->fShakeThG = th_g;
+  pCtx->i32ShakeDurMs = dur_ms;
+  pCtx->i32ShakeCnt = cnt;
+  pCtx->i32ShakeTimeOutMs = timeout_ms;
+  pCtx->i32ShakeAxes = axes;
 
-  //Reset axes enable, then set selected axes enable
-  setShakeEnable(&shakeParam, 0, 0, 0, X_AXIS|Y_AXIS|Z_AXIS);
-  setShakeEnable(&shakeParam, 1, 1, 1, axes);
+  motion_alg_apply_shake_param(pCtx, motion_alg_get_period_ms(pCtx, MOTION_ALG_SHAKE_ENTRY));
 }
 
 /*!
- * @brief Set the sedentary parameters
+ * @brief Set the sedentary parameters of a motion context
  *
+ * @param[in] pCtx Pointer to the motion context
  * @param[in] sedentary_time_min Sedentary time in min
  * @param[in] snooze_interval_min Interval to alarm sendentary
  *
  * @return None
  */
-void motion_sedentary_set_param(int32_t sedentary_time_min, int32_t snooze_interval_min)
+void motion_sedentary_set_param_ctx(motion_ctx_t *pCtx,
+				    int32_t sedentary_time_min,
+				    int32_t snooze_interval_min)
 {
 
-  i32SedentaryDuration = sedentary_time_min * 60 * MOTION_ALG_DATA_RATE_HZ;
-  i32SedenIntervalCount = i32SedentaryDuration;
-  i32SedenSnoozeDuration = snooze_interval_min * 60 * MOTION_ALG_DATA_RATE_HZ;
-  i32SedenSnoozeCount = 0;
+  pCtx->i32SedentaryTimeMin = sedentary_time_min;
+  pCtx->i32SedenSnoozeMin = snooze_interval_min;
+
+  motion_alg_apply_sedentary_param(pCtx, motion_alg_get_period_ms(pCtx, MOTION_ALG_SEDENTARY_ENTRY));
+  pCtx->i32SedenIntervalCount = pCtx->i32SedentaryDuration;
+  pCtx->i32SedenSnoozeCount = 0;
 
 }
 
+/*!
+ * @brief Dispatch the queued events of a motion context to its event handler
+ *        Call from a context with lower priority than motion_alg_process_data_ctx()
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] ui32MaxEvents Max number of events to dispatch
+ *
+ * @return Number of events dispatched
+ */
+uint32_t motion_alg_dispatch_events_ctx(motion_ctx_t *pCtx, uint32_t ui32MaxEvents)
+{
+
+  motion_event_t event;
+  uint32_t ui32Count = 0;
+
+  while(ui32Count < ui32MaxEvents && eventQueuePop(&pCtx->eventQueue, &event)){
+    pCtx->eventHandler(event.alg, event.i32Data);
+    ++ui32Count;
+  }
+
+  return ui32Count;
+}
+
+/*!
+ * @brief Pop one queued event of a motion context, for use instead of
+ *        motion_alg_dispatch_events_ctx()
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[out] pEvent Pointer to store the event
+ *
+ * @return 1 for success, 0 if no event is pending
+ */
+int8_t motion_alg_pop_event_ctx(motion_ctx_t *pCtx, motion_event_t *pEvent)
+{
+
+  return eventQueuePop(&pCtx->eventQueue, pEvent);
+}
+
+/*!
+ * @brief Get the event queue statistics of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[out] pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void motion_alg_get_event_stats_ctx(motion_ctx_t *pCtx, motion_event_queue_stats_t *pStats)
+{
+
+  getEventQueueStats(&pCtx->eventQueue, pStats);
+}
+
+/*!
+ * @brief Queue an event for dispatch
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] alg Algorithm raising the event
+ * @param[in] i32Data Event value
+ *
+ * @return None
+ */
+static void motion_alg_post_event(motion_ctx_t *pCtx, motion_algorithm_t alg, int32_t i32Data)
+{
+
+  motion_event_t event;
+
+  event.alg = alg;
+  event.i32Data = i32Data;
+  event.ui32SampleIndex = pCtx->timeStep;
+
+  eventQueuePush(&pCtx->eventQueue, &event);
+}
+
+/*!
+ * @brief Queue an event of an earlier sample for dispatch
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] alg Algorithm raising the event
+ * @param[in] i32Data Event value
+ * @param[in] ui32SampleIndex Sample index of the event
+ *
+ * @return None
+ */
+static void motion_alg_post_event_at(motion_ctx_t *pCtx, motion_algorithm_t alg,
+				     int32_t i32Data, uint32_t ui32SampleIndex)
+{
+
+  motion_event_t event;
+
+  event.alg = alg;
+  event.i32Data = i32Data;
+  event.ui32SampleIndex = ui32SampleIndex;
+
+  eventQueuePush(&pCtx->eventQueue, &event);
+}
+
+/*
+ * Pedo, calorie and activity
+ */
+static void motion_alg_init_pedo(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  pCtx->ui32StepCount = pCtx->ui32StepCount_pre = pCtx->ui32StepCountBase = 0;
+  pCtx->ui8Activity = pCtx->ui8Activity_pre = 0;
+  pCtx->fCal = pCtx->fCal_pre = pCtx->fCalBase = 0.;
+  pCtx->ui32PedoDecimation = ui32PeriodMs / (uint32_t)pCtx->rate;
+  pCtx->ui32StepIndex_pre = 0;
+  pCtx->hasStepIndex = 0;
+  pCtx->ui32StepIntervalAvg = 0;
+  pCtx->i32Cadence = 0;
+  iirHpfXyzInit(&pCtx->iirPedo);  //Initialize pedo filter
+  pCtx->fAlphaPedo = MOTION_ALG_PERIOD_ALPHA(alpha_pedo, ui32PeriodMs);
+  pedoInit(&pCtx->pedoParam, ui32PeriodMs);
+}
+
+/*!
+ * @brief Post one MOTION_ALG_STEP event per new step, at the sample of the
+ *        step, and update the cadence
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] ui32Steps New steps
+ *
+ * @return None
+ */
+static void motion_alg_post_steps(motion_ctx_t *pCtx, uint32_t ui32Steps)
+{
+
+  unsigned short ages[PEDO_STEP_AGES_MAX];
+  uint32_t i, n, ui32Index, ui32IntervalMs;
+
+#if PEDO_LIB
+  //libpedo.a has no step times, the steps are at the current sample
+  n = 0;
+#else
+  n = PEDO_GetStepAges(ages, PEDO_STEP_AGES_MAX);
+#endif
+
+  for(i = 0; i < ui32Steps; ++i){
+
+    ui32Index = pCtx->timeStep;
+    if(n == ui32Steps)
+      ui32Index -= ages[i] * pCtx->ui32PedoDecimation;
+
+    if(pCtx->hasStepIndex){
+
+      ui32IntervalMs = (ui32Index - pCtx->ui32StepIndex_pre) * (uint32_t)pCtx->rate;
+
+      if(ui32IntervalMs > STEP_GAP_MS){
+	pCtx->ui32StepIntervalAvg = 0;
+	pCtx->i32Cadence = 0;
+      }
+      else if(ui32IntervalMs > 0){
+
+	//running average of the step interval
+	if(pCtx->ui32StepIntervalAvg == 0)
+	  pCtx->ui32StepIntervalAvg = ui32IntervalMs << STEP_INTERVAL_FRAC;
+	else
+	  pCtx->ui32StepIntervalAvg = pCtx->ui32StepIntervalAvg -
+	    (pCtx->ui32StepIntervalAvg >> STEP_INTERVAL_SHIFT) +
+	    ((ui32IntervalMs << STEP_INTERVAL_FRAC) >> STEP_INTERVAL_SHIFT);
 
-void motion_alg_process_pedo(float_xyzt_t gVal)
+	pCtx->i32Cadence = (int32_t)((60000UL << STEP_INTERVAL_FRAC) / pCtx->ui32StepIntervalAvg);
+      }
+    }
+
+    pCtx->ui32StepIndex_pre = ui32Index;
+    pCtx->hasStepIndex = 1;
+
+    motion_alg_post_event_at(pCtx, MOTION_ALG_STEP, pCtx->i32Cadence, ui32Index);
+  }
+}
+
+static void motion_alg_process_pedo(motion_ctx_t *pCtx, motion_features_t *pFeat)
 {
 
   float_xyzt_t fData_out;
+  pedo_sample_t sample;
+  pedo_block_result_t result;
 
   //high-pass filter the data
-  filterData((float *)&gVal, (float *)&fData_out, &iirPedo);
+  filterHpfXyz(pFeat->pgVal->v, fData_out.v, pCtx->fAlphaPedo, &pCtx->iirPedo);
+  pedoToCodes(fData_out, &sample);
+
+  //one call for the step count, activity and calories, a block of one
+  //sample has no change to locate
+  processPedoBlock(&pCtx->pedoParam, &sample, 1, NULL, 0, &result);
+  pCtx->ui32StepCount = pCtx->ui32StepCountBase + result.ui32StepCount;
+  pCtx->ui8Activity = result.ui8Activity;
+  pCtx->fCal = pCtx->fCalBase + result.fCalories;
+
+  if(pCtx->ui32StepCount != pCtx->ui32StepCount_pre){
+    if(pCtx->motionStates & MOTION_ALG_STEP)
+      motion_alg_post_steps(pCtx, pCtx->ui32StepCount - pCtx->ui32StepCount_pre);
+    pCtx->ui32StepCount_pre = pCtx->ui32StepCount;
+    if(pCtx->motionStates & MOTION_ALG_PEDO)
+      motion_alg_post_event(pCtx, MOTION_ALG_PEDO, (int32_t) pCtx->ui32StepCount);
+  }
 
-  if(timeStep < 2*MOTION_ALG_DATA_RATE_HZ) return; //wait for the filter to settle down
-    
-  ui32StepCount = processPedo(fData_out);
-  ui8Activity = getPedoActivity();
-  fCal = getPedoCalorie();
-
-  if(ui32StepCount != ui32StepCount_pre){
-    ui32StepCount_pre = ui32StepCount;
-    if(motionStates & MOTION_ALG_PEDO)
-      eventHandler(MOTION_ALG_PEDO, (int32_t) ui32StepCount);
+  if(pCtx->ui8Activity != pCtx->ui8Activity_pre){
+    pCtx->ui8Activity_pre = pCtx->ui8Activity;
+    if(pCtx->ui8Activity == PEDO_ACTIVITY_STATIONARY)
+      pCtx->i32Cadence = 0;
+    if(pCtx->motionStates & MOTION_ALG_ACTIVITY)
+      motion_alg_post_event(pCtx, MOTION_ALG_ACTIVITY, (int32_t) pCtx->ui8Activity);
   }
 
-  if(ui8Activity != ui8Activity_pre){
-    ui8Activity_pre = ui8Activity;
-    if(motionStates & MOTION_ALG_ACTIVITY)
-      eventHandler(MOTION_ALG_ACTIVITY, (int32_t) ui8Activity);
+  if(pCtx->fCal - pCtx->fCal_pre > 1.){
+    pCtx->fCal_pre = pCtx->fCal;
+    if(pCtx->motionStates & MOTION_ALG_CALORIE)
+      motion_alg_post_event(pCtx, MOTION_ALG_CALORIE, (int32_t) pCtx->fCal);
   }
+}
 
-  if(fCal - fCal_pre > 1.){
-    fCal_pre = fCal;
-    if(motionStates & MOTION_ALG_CALORIE)
-      eventHandler(MOTION_ALG_CALORIE, (int32_t) fCal);
+static int32_t motion_alg_get_state_pedo(motion_ctx_t *pCtx, motion_algorithm_t alg)
+{
+
+  switch(alg){
+  case MOTION_ALG_PEDO:
+    return (int32_t)pCtx->ui32StepCount;
+  case MOTION_ALG_CALORIE:
+    return (int32_t)pCtx->fCal;
+  case MOTION_ALG_STEP:
+    return pCtx->i32Cadence;
+  default: //MOTION_ALG_ACTIVITY
+    return (int32_t)pCtx->ui8Activity;
   }
 }
 
-void motion_alg_process_fall(float_xyzt_t gVal)
+/*
+ * Fall down detection
+ */
+static void motion_alg_init_fall(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  pCtx->i32FallDown = 0;
+  iirHpfXyzInit(&pCtx->iirFall); //Initialize fall filter
+  pCtx->fAlphaFall = MOTION_ALG_PERIOD_ALPHA(alpha_fall, ui32PeriodMs);
+  fallDownInit(&pCtx->fallParam, ui32PeriodMs);
+}
+
+static void motion_alg_process_fall(motion_ctx_t *pCtx, motion_features_t *pFeat)
 {
 
   float_xyzt_t fData_out;
 
   //high-pass filter the data
-  filterData((float *)&gVal, (float *)&fData_out, &iirFall);
+  filterHpfXyz(pFeat->pgVal->v, fData_out.v, pCtx->fAlphaFall, &pCtx->iirFall);
   
-  i32FallDown = processFallDown(fData_out);
-
-  if(i32FallDown != 0){
-    eventHandler(MOTION_ALG_FALL, (int32_t) i32FallDown);
+  if(processFallDown(&pCtx->fallParam, pFeat, &fData_out) != 0){
+    motion_alg_post_event(pCtx, MOTION_ALG_FALL, 1);
   }
 
+  pCtx->i32FallDown = getFallDown(&pCtx->fallParam);
+
+}
+
+static int32_t motion_alg_get_state_fall(motion_ctx_t *pCtx, motion_algorithm_t alg)
+{
+
+  return pCtx->i32FallDown;
+}
+
+/*
+ * Shake
+ */
+static void motion_alg_init_shake(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  pCtx->i32ShakeState = EVENT_SHAKE_NONE;
+  iirHpfXyzInit(&pCtx->iirShake); //Initialize shake filter
+  pCtx->fAlphaShake = MOTION_ALG_PERIOD_ALPHA(alpha_shake, ui32PeriodMs);
+  shakeInit(&pCtx->shakeParam, ui32PeriodMs);
+  motion_alg_apply_shake_param(pCtx, ui32PeriodMs);
+}
+
+static void motion_alg_apply_shake_param(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  float th = pCtx->fShakeThG;
+  int32_t dur = MOTION_ALG_MS_TO_COUNT(pCtx->i32ShakeDurMs, (int32_t)ui32PeriodMs);
+  int32_t cnt = pCtx->i32ShakeCnt;
+  int32_t tm = MAX_DURATION;
+
+  if(pCtx->i32ShakeTimeOutMs != MAX_DURATION)
+    tm = MOTION_ALG_MS_TO_COUNT(pCtx->i32ShakeTimeOutMs, (int32_t)ui32PeriodMs);
+
+  setShakeThreshold(&pCtx->shakeParam, th, th, th, X_AXIS|Y_AXIS|Z_AXIS);
+  setShakeDuration(&pCtx->shakeParam, dur, dur, dur, X_AXIS|Y_AXIS|Z_AXIS);
+  setShakeCount(&pCtx->shakeParam, cnt, cnt, cnt, X_AXIS|Y_AXIS|Z_AXIS);
+  setShakeTimeOutDuration(&pCtx->shakeParam, tm, tm, tm, X_AXIS|Y_AXIS|Z_AXIS);
+
+  //Reset axes enable, then set selected axes enable
+  setShakeEnable(&pCtx->shakeParam, 0, 0, 0, X_AXIS|Y_AXIS|Z_AXIS);
+  setShakeEnable(&pCtx->shakeParam, 1, 1, 1, pCtx->i32ShakeAxes);
 }
 
-void motion_alg_process_shake(float_xyzt_t gVal)
+static void motion_alg_process_shake(motion_ctx_t *pCtx, motion_features_t *pFeat)
 {
 
   float_xyzt_t fData_out;
 
   //high-pass filter the data
-  filterData((float *)&gVal, (float *)&fData_out, &iirShake);
+  filterHpfXyz(pFeat->pgVal->v, fData_out.v, pCtx->fAlphaShake, &pCtx->iirShake);
   
-  i32ShakeState = processShake(&shakeParam, fData_out);
+  pCtx->i32ShakeState = processShake(&pCtx->shakeParam, fData_out);
 
-  if(i32ShakeState != EVENT_SHAKE_NONE){
-    eventHandler(MOTION_ALG_SHAKE, (int32_t) i32ShakeState);
+  if(pCtx->i32ShakeState != EVENT_SHAKE_NONE){
+    motion_alg_post_event(pCtx, MOTION_ALG_SHAKE, (int32_t) pCtx->i32ShakeState);
   }
 
 }
 
-void motion_alg_process_raise_hand_flip(float_xyzt_t gVal)
+static int32_t motion_alg_get_state_shake(motion_ctx_t *pCtx, motion_algorithm_t alg)
 {
 
-  motion_orient_t orient = processOrient(gVal);
+  return pCtx->i32ShakeState;
+}
 
-  //Raise hand
-  if(motionStates & MOTION_ALG_RAISE_HAND){
+/*
+ * Orientation, shared by raise hand and flip
+ */
+static void motion_alg_init_orient(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
 
-    i32RaiseHandState = (orient == ORIENT_Z_POS) ? 1 : 0;
+  pCtx->orientState = ORIENT_NA;
+  orientInit(&pCtx->orientParam);
+}
 
-    if(i32RaiseHandState != i32RaiseHandState_pre){
-    
-      i32RaiseHandState_pre = i32RaiseHandState;
-      eventHandler(MOTION_ALG_RAISE_HAND, (int32_t) i32RaiseHandState);
+static void motion_alg_process_orient(motion_ctx_t *pCtx, motion_features_t *pFeat)
+{
+
+  pCtx->orientState = processOrient(&pCtx->orientParam, pFeat);
+}
+
+/*
+ * Raise hand
+ */
+static void motion_alg_init_raise_hand(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  pCtx->i32RaiseHandState = pCtx->i32RaiseHandState_pre = 0;
+  pCtx->i32RaiseConfirmCount = 0;
+  pCtx->i32RaiseConfirmDuration = MOTION_ALG_MS_TO_COUNT(RAISE_CONFIRM_MS, (int32_t)ui32PeriodMs);
+  pCtx->i32RaiseRefractoryCount = 0;
+  pCtx->i32RaiseRefractoryDuration = MOTION_ALG_MS_TO_COUNT(RAISE_REFRACTORY_MS, (int32_t)ui32PeriodMs);
+  wristRaiseInit(&pCtx->wristRaiseParam, ui32PeriodMs);
+}
+
+static void motion_alg_process_raise_hand(motion_ctx_t *pCtx, motion_features_t *pFeat)
+{
+
+#if MOTION_ALG_RAISE_PREDICT
+  int8_t isRaising = processWristRaise(&pCtx->wristRaiseParam, pFeat);
+
+  if(pCtx->i32RaiseRefractoryCount > 0)
+    --pCtx->i32RaiseRefractoryCount;
+
+  if(pCtx->orientState == ORIENT_Z_POS){
+    pCtx->i32RaiseHandState = 1;
+    pCtx->i32RaiseConfirmCount = 0;
+  }
+  else if(pCtx->i32RaiseHandState == 0){
+    //predicted, count down to the confirmation
+    if(isRaising && pCtx->i32RaiseRefractoryCount == 0){
+      pCtx->i32RaiseHandState = 1;
+      pCtx->i32RaiseConfirmCount = pCtx->i32RaiseConfirmDuration;
     }
   }
+  else{
+    //lowered after the confirmation, or not confirmed in time, then no
+    //prediction for the refractory period
+    if(pCtx->i32RaiseConfirmCount > 0 && --pCtx->i32RaiseConfirmCount == 0)
+      pCtx->i32RaiseRefractoryCount = pCtx->i32RaiseRefractoryDuration;
+    if(pCtx->i32RaiseConfirmCount == 0)
+      pCtx->i32RaiseHandState = 0;
+  }
+#else
+  pCtx->i32RaiseHandState = (pCtx->orientState == ORIENT_Z_POS) ? 1 : 0;
+#endif
+
+  if(pCtx->i32RaiseHandState != pCtx->i32RaiseHandState_pre){
+    
+    pCtx->i32RaiseHandState_pre = pCtx->i32RaiseHandState;
+    motion_alg_post_event(pCtx, MOTION_ALG_RAISE_HAND, (int32_t) pCtx->i32RaiseHandState);
+  }
+}
 
-  //Flip
-  if(motionStates & MOTION_ALG_FLIP){
+static int32_t motion_alg_get_state_raise_hand(motion_ctx_t *pCtx, motion_algorithm_t alg)
+{
 
-    i32FlipState = 0;
-    --i32FlipIntervalCount;
+  return pCtx->i32RaiseHandState;
+}
 
-    if(orient == ORIENT_Z_POS)
-      i32FlipIntervalCount = FLIP_INTERVAL_COUNT_THRESHOLD; //start count down
-    else if(orient == ORIENT_Z_NEG){
+/*
+ * Flip
+ */
+static void motion_alg_init_flip(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
 
-      if(i32FlipIntervalCount >= 0){
+  pCtx->i32FlipState = 0;
+  pCtx->i32FlipIntervalCount = 0;
+  pCtx->i32FlipIntervalDuration = MOTION_ALG_MS_TO_COUNT(FLIP_INTERVAL_MS, (int32_t)ui32PeriodMs);
+}
 
-	i32FlipState = 1;
-	i32FlipIntervalCount = 0;
-	eventHandler(MOTION_ALG_FLIP, (int32_t) i32FlipState);
-      }
+static void motion_alg_process_flip(motion_ctx_t *pCtx, motion_features_t *pFeat)
+{
+
+  pCtx->i32FlipState = 0;
+  --pCtx->i32FlipIntervalCount;
+
+  if(pCtx->orientState == ORIENT_Z_POS)
+    pCtx->i32FlipIntervalCount = pCtx->i32FlipIntervalDuration; //start count down
+  else if(pCtx->orientState == ORIENT_Z_NEG){
+
+    if(pCtx->i32FlipIntervalCount >= 0){
 
+      pCtx->i32FlipState = 1;
+      pCtx->i32FlipIntervalCount = 0;
+      motion_alg_post_event(pCtx, MOTION_ALG_FLIP, (int32_t) pCtx->i32FlipState);
     }
 
-    if(i32FlipIntervalCount < 0)
-      i32FlipIntervalCount = 0;
   }
+
+  if(pCtx->i32FlipIntervalCount < 0)
+    pCtx->i32FlipIntervalCount = 0;
 }
 
-void motion_alg_process_sedentary(float_xyzt_t gVal)
+static int32_t motion_alg_get_state_flip(motion_ctx_t *pCtx, motion_algorithm_t alg)
 {
 
-  float_xyzt_t fData_out;
-  int32_t i32Res, i;
-  float fTmp;
+  return pCtx->i32FlipState;
+}
 
-  //high-pass filter the data
-  filterData((float *)&gVal, (float *)&fData_out, &iirSeden);
-  //Calculate magnitude^2 in g and store in the X
-  fTmp = 0.f;
-  for(i = 0; i < 3; ++i)
-    fTmp += fData_out.v[i] * fData_out.v[i];
-  fData_out.v[0] = fTmp;
-  fData_out.v[1] = fData_out.v[2] = 0.f;
-  
-  i32Res = processShake(&sedenShakeParam, fData_out);
+/*
+ * Tilt angles
+ */
+static void motion_alg_init_tilt(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  tiltInit(&pCtx->tiltParam);
+}
+
+static void motion_alg_process_tilt(motion_ctx_t *pCtx, motion_features_t *pFeat)
+{
+
+  processTilt(&pCtx->tiltParam, pFeat);
+}
+
+static int32_t motion_alg_get_state_tilt(motion_ctx_t *pCtx, motion_algorithm_t alg)
+{
+
+  return pCtx->tiltParam.tilt.i16Tilt;
+}
+
+/*
+ * Sedentary
+ */
+static void motion_alg_init_sedentary(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  pCtx->i32SedenState = pCtx->i32SedenState_pre = 0;
+  motion_alg_apply_sedentary_param(pCtx, ui32PeriodMs);
+
+  //count down from the start, also after a rate change re-inits the entry
+  pCtx->i32SedenIntervalCount = pCtx->i32SedentaryDuration;
+
+  magRunInit(&pCtx->sedenMagRun,
+	     SEDENTARY_THRESHOLD_G*SEDENTARY_THRESHOLD_G,
+	     MOTION_ALG_MS_TO_COUNT(SEDENTARY_DURATION_MS, (int32_t)ui32PeriodMs),
+	     SEDENTARY_COUNT,
+	     MOTION_ALG_MS_TO_COUNT(SEDENTARY_TIME_OUT_MS, (int32_t)ui32PeriodMs));
+}
+
+static void motion_alg_apply_sedentary_param(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  //minutes to the number of processing periods, 0 if not set
+  pCtx->i32SedentaryDuration =
+    (int32_t)(((int64_t)pCtx->i32SedentaryTimeMin * 60000 + ui32PeriodMs / 2) / ui32PeriodMs);
+  pCtx->i32SedenSnoozeDuration =
+    (int32_t)(((int64_t)pCtx->i32SedenSnoozeMin * 60000 + ui32PeriodMs / 2) / ui32PeriodMs);
+}
+
+static void motion_alg_process_sedentary(motion_ctx_t *pCtx, motion_features_t *pFeat)
+{
+
+  int32_t i32Res;
 
-  --i32SedenIntervalCount;
-  --i32SedenSnoozeCount;
+  //magnitude^2 of the high-passed data in g
+  i32Res = processMagRun(&pCtx->sedenMagRun, getFeatureHpMag2(pFeat));
+
+  --pCtx->i32SedenIntervalCount;
+  --pCtx->i32SedenSnoozeCount;
   
-  if(i32Res != EVENT_SHAKE_NONE){
-    i32SedenIntervalCount = i32SedentaryDuration;
-    i32SedenState = 0;
+  if(i32Res != 0){
+    pCtx->i32SedenIntervalCount = pCtx->i32SedentaryDuration;
+    pCtx->i32SedenState = 0;
   }
 
-  if(i32SedenIntervalCount == 0){
-    i32SedenState = 1;
-    i32SedenSnoozeCount = i32SedenSnoozeDuration;
+  if(pCtx->i32SedenIntervalCount == 0){
+    pCtx->i32SedenState = 1;
+    pCtx->i32SedenSnoozeCount = pCtx->i32SedenSnoozeDuration;
   }
-  else if(i32SedenIntervalCount < 0)
-    i32SedenIntervalCount = 0;
+  else if(pCtx->i32SedenIntervalCount < 0)
+    pCtx->i32SedenIntervalCount = 0;
 
-  if(i32SedenState != i32SedenState_pre){
+  if(pCtx->i32SedenState != pCtx->i32SedenState_pre){
 
-    i32SedenState_pre = i32SedenState;
-    eventHandler(MOTION_ALG_SEDENTARY, (int32_t) i32SedenState);
+    pCtx->i32SedenState_pre = pCtx->i32SedenState;
+    motion_alg_post_event(pCtx, MOTION_ALG_SEDENTARY, (int32_t) pCtx->i32SedenState);
 
   }
   else{
     //check snooze
-    if(i32SedenState && (i32SedenSnoozeCount == 0)){
-      i32SedenIntervalCount = i32SedentaryDuration;
-      eventHandler(MOTION_ALG_SEDENTARY, (int32_t) i32SedenState);
+    if(pCtx->i32SedenState && (pCtx->i32SedenSnoozeCount == 0)){
+      pCtx->i32SedenIntervalCount = pCtx->i32SedentaryDuration;
+      motion_alg_post_event(pCtx, MOTION_ALG_SEDENTARY, (int32_t) pCtx->i32SedenState);
     }
   }
 
-  if(i32SedenSnoozeCount < 0) i32SedenSnoozeCount = 0;
+  if(pCtx->i32SedenSnoozeCount < 0) pCtx->i32SedenSnoozeCount = 0;
+}
+
+static int32_t motion_alg_get_state_sedentary(motion_ctx_t *pCtx, motion_algorithm_t alg)
+{
+
+  return pCtx->i32SedenState;
 }
 
+/*
+ * Sleep cycle monitor
+ */
+static void motion_alg_init_sleep_cycle(motion_ctx_t *pCtx, uint32_t ui32PeriodMs)
+{
+
+  pCtx->sleepCycle = pCtx->sleepCycle_pre = MOTION_SLEEP_CYCLE_NONE;
+  sleepCycleInit(&pCtx->sleepCycleParam, ui32PeriodMs);
+}
 
-void motion_alg_process_sleep_cycle(float_xyzt_t gVal)
+static void motion_alg_process_sleep_cycle(motion_ctx_t *pCtx, motion_features_t *pFeat)
 {
 
-  sleepCycle = processSleepCycle(gVal);
+  pCtx->sleepCycle = processSleepCycle(&pCtx->sleepCycleParam, pFeat);
 
-  if(sleepCycle != sleepCycle_pre){
-    sleepCycle_pre = sleepCycle;
-    eventHandler(MOTION_ALG_SLEEP_CYCLE, (int32_t) sleepCycle);
+  if(pCtx->sleepCycle != pCtx->sleepCycle_pre){
+    pCtx->sleepCycle_pre = pCtx->sleepCycle;
+    motion_alg_post_event(pCtx, MOTION_ALG_SLEEP_CYCLE, (int32_t) pCtx->sleepCycle);
   }
 
 }
 
+static int32_t motion_alg_get_state_sleep_cycle(motion_ctx_t *pCtx, motion_algorithm_t alg)
+{
+
+  return pCtx->sleepCycle;
+}
+
 /*!
- * @brief Run the motion algorithm, frequency should be 20Hz
+ * @brief Run the motion algorithm of a motion context, at the data rate set
+ *        by motion_alg_set_rate_ctx()
  *
+ * @param[in] pCtx Pointer to the motion context
  * @param[in] gVal accelerometer reading in g
  *
  * @return None
  */
-void motion_alg_process_data(float_xyzt_t gVal)
+void motion_alg_process_data_ctx(motion_ctx_t *pCtx, float_xyzt_t gVal)
 {
 
-  timeStep += 1;
+  uint32_t i;
+  motion_alg_stage_t *pStage;
+  motion_features_t *pFeat;
+  MOTION_PROFILE_START(ui32TotalStart);
 
-  if(motionStates & (MOTION_ALG_PEDO | MOTION_ALG_CALORIE | MOTION_ALG_ACTIVITY))
-    motion_alg_process_pedo(gVal);
-  
-  if(motionStates & MOTION_ALG_FALL)
-    motion_alg_process_fall(gVal);
+  pCtx->timeStep += 1;
+  featuresUpdate(&pCtx->features, &gVal);
+
+  //Decimation stages
+  for(i = 0; i < pCtx->ui32AlgStageCount; ++i)
+    motion_alg_update_stage(&pCtx->algStages[i], &gVal);
 
-  if(motionStates & MOTION_ALG_SHAKE)
-    motion_alg_process_shake(gVal);
+  //Enabled algorithms, each at its rate
+  for(i = 0; i < pCtx->ui32EnabledAlgCount; ++i){
 
-  if(motionStates & (MOTION_ALG_RAISE_HAND|MOTION_ALG_FLIP))
-    motion_alg_process_raise_hand_flip(gVal);
+    pStage = pCtx->enabledAlgStages[i];
 
-  if(motionStates & MOTION_ALG_SEDENTARY)
-    motion_alg_process_sedentary(gVal);
+    if(pStage == NULL)
+      pFeat = &pCtx->features;
+    else if(pStage->isReady)
+      pFeat = &pStage->features;
+    else
+      continue;
 
-  if(motionStates & MOTION_ALG_SLEEP_CYCLE)
-    motion_alg_process_sleep_cycle(gVal);
+    MOTION_PROFILE_START(ui32Start);
+    pCtx->enabledAlgs[i]->process(pCtx, pFeat);
+    MOTION_PROFILE_STOP(&pCtx->profiles[pCtx->enabledAlgs[i] - motionAlgTable], ui32Start);
+  }
+
+  MOTION_PROFILE_STOP(&pCtx->profileTotal, ui32TotalStart);
 }
 
+#if MOTION_ALG_PROFILE
+/*!
+ * @brief Get the execution time profile of a motion context
+ *        Entries are the algorithm registry entries in processing order,
+ *        followed by the whole sample, named "total"
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] ui32Entry Entry index, from 0
+ * @param[out] ppName Pointer to store the entry name
+ * @param[out] pStats Pointer to store the statistics, in MOTION_PROFILE_UNIT
+ *
+ * @return 1 for success, 0 if ui32Entry is past the last entry
+ */
+int8_t motion_alg_get_profile_ctx(motion_ctx_t *pCtx,
+				  uint32_t ui32Entry,
+				  const char **ppName,
+				  motion_profile_stats_t *pStats)
+{
+
+  if(ui32Entry < MOTION_ALG_TABLE_SIZE){
+    *ppName = motionAlgTable[ui32Entry].name;
+    getProfileStats(&pCtx->profiles[ui32Entry], pStats);
+  }
+  else if(ui32Entry == MOTION_ALG_TABLE_SIZE){
+    *ppName = "total";
+    getProfileStats(&pCtx->profileTotal, pStats);
+  }
+  else
+    return 0;
+
+  return 1;
+}
+#endif
+
+/*
+ * Default context
+ */
+int8_t motion_alg_init(MOTION_ALG_EVENT_HANDLER eventFcn)
+{
+  return motion_alg_init_ctx(&defaultCtx, eventFcn);
+}
+
+int8_t motion_alg_set_rate(motion_alg_rate_t rate)
+{
+  return motion_alg_set_rate_ctx(&defaultCtx, rate);
+}
+
+void motion_alg_enable(int32_t algSelections, int8_t enable)
+{
+  motion_alg_enable_ctx(&defaultCtx, algSelections, enable);
+}
+
+int32_t motion_alg_get_state(motion_algorithm_t alg)
+{
+  return motion_alg_get_state_ctx(&defaultCtx, alg);
+}
+
+int8_t motion_alg_get_tilt(motion_tilt_t *pTilt)
+{
+  return motion_alg_get_tilt_ctx(&defaultCtx, pTilt);
+}
+
+int32_t motion_alg_get_fall_latency(void)
+{
+  return motion_alg_get_fall_latency_ctx(&defaultCtx);
+}
+
+uint32_t motion_alg_get_sample_index(void)
+{
+  return motion_alg_get_sample_index_ctx(&defaultCtx);
+}
+
+void motion_pedo_reset(void)
+{
+  motion_pedo_reset_ctx(&defaultCtx);
+}
+
+void motion_calorie_set_param(float ht_m, float wt_kg)
+{
+  motion_calorie_set_param_ctx(&defaultCtx, ht_m, wt_kg);
+}
+
+void motion_shake_set_param(float th_g,
+			    int32_t dur_ms,
+			    int32_t cnt,
+			    int32_t timeout_ms,
+			    int32_t axes)
+{
+  motion_shake_set_param_ctx(&defaultCtx, th_g, dur_ms, cnt, timeout_ms, axes);
+}
+
+void motion_sedentary_set_param(int32_t sedentary_time_min, int32_t snooze_interval_min)
+{
+  motion_sedentary_set_param_ctx(&defaultCtx, sedentary_time_min, snooze_interval_min);
+}
+
+void motion_alg_process_data(float_xyzt_t gVal)
+{
+  motion_alg_process_data_ctx(&defaultCtx, gVal);
+}
+
+uint32_t motion_alg_dispatch_events(uint32_t ui32MaxEvents)
+{
+  return motion_alg_dispatch_events_ctx(&defaultCtx, ui32MaxEvents);
+}
+
+int8_t motion_alg_pop_event(motion_event_t *pEvent)
+{
+  return motion_alg_pop_event_ctx(&defaultCtx, pEvent);
+}
+
+void motion_alg_get_event_stats(motion_event_queue_stats_t *pStats)
+{
+  motion_alg_get_event_stats_ctx(&defaultCtx, pStats);
+}
+
+#if MOTION_ALG_PROFILE
+int8_t motion_alg_get_profile(uint32_t ui32Entry,
+			      const char **ppName,
+			      motion_profile_stats_t *pStats)
+{
+  return motion_alg_get_profile_ctx(&defaultCtx, ui32Entry, ppName, pStats);
+}
+#endif
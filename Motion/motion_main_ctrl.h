@@ -32,27 +32,391 @@
 
 #include <stdint.h>
 #include "type_support.h"
+#include "iir_filter.h"
+#include "motion_event_queue.h"
+#include "motion_period.h"
+#include "motion_pedo.h"
+#include "motion_falldown.h"
+#include "motion_shake.h"
+#include "motion_mag_run.h"
+#include "motion_orientation.h"
+#include "motion_tilt.h"
+#include "motion_wrist_raise.h"
+#include "motion_sleep_cycle.h"
+#include "motion_profile.h"
+#include "motion_features.h"
 
-#define MOTION_ALG_DATA_RATE_HZ (25)
-#define MOTION_ALG_COUNT (9)
+#define MOTION_ALG_DATA_RATE_HZ (25) //default data rate, see motion_alg_set_rate_ctx()
+#define MOTION_ALG_COUNT (11)
+#define MOTION_ALG_MAX_ENTRIES (9)  //capacity of the algorithm registry
+
+//
+// Multi-rate processing
+// Orientation (flip, raise hand confirmation) and tilt run on decimated data, set
+// MOTION_ALG_MULTI_RATE to 0 to run everything at the data rate
+// Decimation is the processing period over the sample period, rounded
+// Sedentary and sleep cycle stay at the data rate: their thresholds are tuned
+// on the raw magnitude, the box-car average of a decimation stage lowers it
+//
+#ifndef MOTION_ALG_MULTI_RATE
+#define MOTION_ALG_MULTI_RATE (1)
+#endif
+
+#if MOTION_ALG_MULTI_RATE
+#define MOTION_ALG_ORIENT_PERIOD_MS (80)  //12.5Hz
+#define MOTION_ALG_SLOW_PERIOD_MS (200)   //5Hz
+#else
+#define MOTION_ALG_ORIENT_PERIOD_MS (0)
+#define MOTION_ALG_SLOW_PERIOD_MS (0)
+#endif
+
+//Tilt angles period, the angles are an average over it
+#ifndef MOTION_ALG_TILT_PERIOD_MS
+#define MOTION_ALG_TILT_PERIOD_MS (MOTION_ALG_SLOW_PERIOD_MS)
+#endif
+
+//
+// Raise hand prediction at the data rate, see motion_wrist_raise.h, set
+// MOTION_ALG_RAISE_PREDICT to 0 to raise on the orientation only
+//
+#ifndef MOTION_ALG_RAISE_PREDICT
+#define MOTION_ALG_RAISE_PREDICT (1)
+#endif
+
+//
+// Data rates, the value is the sample period in ms
+//
+typedef enum {
+  MOTION_ALG_RATE_12_5HZ = 80,
+  MOTION_ALG_RATE_25HZ = 40,
+  MOTION_ALG_RATE_50HZ = 20,
+  MOTION_ALG_RATE_100HZ = 10
+} motion_alg_rate_t;
 
 typedef enum {
   MOTION_ALG_NONE = 0,
   MOTION_ALG_PEDO = 1,
   MOTION_ALG_CALORIE = 2,
   MOTION_ALG_ACTIVITY = 4,
-  MOTION_ALG_FALL = 8,
+  MOTION_ALG_FALL = 8,           //once per fall, see motion_alg_get_fall_latency()
   MOTION_ALG_SHAKE = 16,
   MOTION_ALG_RAISE_HAND = 32,
   MOTION_ALG_FLIP = 64,
   MOTION_ALG_SEDENTARY = 128,
-  MOTION_ALG_SLEEP_CYCLE = 256
+  MOTION_ALG_SLEEP_CYCLE = 256,
+  MOTION_ALG_STEP = 512,         //one event per step at its sample index, data: cadence
+  MOTION_ALG_TILT = 1024         //no event, state: tilt, see motion_alg_get_tilt()
 } motion_algorithm_t;
 
 typedef void (*MOTION_ALG_EVENT_HANDLER)(motion_algorithm_t event, int32_t i32Data);
 
+//
+// Decimation stage, box-car average of decimation samples as the
+// anti-aliasing filter, one output every decimation samples
+//
+typedef struct{
+
+  uint32_t decimation;
+  uint32_t count;
+  int8_t isReady;        //output updated on this sample
+  float_xyzt_t sum;
+  float_xyzt_t out;
+  motion_features_t features;  //features of out
+
+} motion_alg_stage_t;
+
+struct motion_alg_desc_s;
+
+//
+// Motion context, all the states of one sensor stream
+// Contexts are independent of each other, except for the pedometer whose
+// PEDO_* step detector is a single global instance.
+//
+typedef struct{
+
+  MOTION_ALG_EVENT_HANDLER eventHandler;
+  motion_event_queue_t eventQueue;
+  int32_t motionStates;
+  uint32_t timeStep;
+  motion_alg_rate_t rate;        //data rate
+  motion_features_t features;    //features of the samples at the data rate
+
+  //Enabled entries, in processing order, with their decimation stage
+  const struct motion_alg_desc_s *enabledAlgs[MOTION_ALG_MAX_ENTRIES];
+  motion_alg_stage_t *enabledAlgStages[MOTION_ALG_MAX_ENTRIES]; //NULL at full rate
+  uint32_t ui32EnabledAlgCount;
+
+  //Decimation stages in use
+  motion_alg_stage_t algStages[MOTION_ALG_MAX_ENTRIES];
+  uint32_t ui32AlgStageCount;
+
+  //pedo states
+  uint32_t ui32StepCount, ui32StepCount_pre;
+  uint8_t ui8Activity, ui8Activity_pre;
+  float fCal, fCal_pre;
+  uint32_t ui32StepCountBase; //steps and calories before the last rate change
+  float fCalBase;
+  motion_pedo_param_t pedoParam;
+  //Step events: last step sample index, cadence from the step interval average
+  uint32_t ui32PedoDecimation;
+  uint32_t ui32StepIndex_pre;
+  int8_t hasStepIndex;
+  uint32_t ui32StepIntervalAvg;  //in ms, STEP_INTERVAL_FRAC fraction bits
+  int32_t i32Cadence;            //steps/min, 0 if unknown
+  //Fall down states
+  int32_t i32FallDown;
+  motion_fall_param_t fallParam;
+  //Shake states, and the settings in physical units
+  int32_t i32ShakeState;
+  motion_shake_param_t shakeParam;
+  float fShakeThG;
+  int32_t i32ShakeDurMs, i32ShakeCnt, i32ShakeTimeOutMs, i32ShakeAxes;
+  //Orientation states
+  motion_orient_t orientState;
+  motion_orient_param_t orientParam;
+  //Tilt angles
+  motion_tilt_param_t tiltParam;
+  //Raise hand states, a predicted raise is confirmed by ORIENT_Z_POS
+  //before the count down ends
+  int32_t i32RaiseHandState, i32RaiseHandState_pre;
+  int32_t i32RaiseConfirmCount, i32RaiseConfirmDuration;
+  int32_t i32RaiseRefractoryCount, i32RaiseRefractoryDuration;
+  motion_wrist_raise_param_t wristRaiseParam;
+  //Flip states
+  int32_t i32FlipState;
+  int32_t i32FlipIntervalCount, i32FlipIntervalDuration;
+  //Sedentary states
+  int32_t i32SedenState, i32SedenState_pre;
+  int32_t i32SedenIntervalCount, i32SedentaryDuration;
+  int32_t i32SedenSnoozeCount, i32SedenSnoozeDuration;
+  int32_t i32SedentaryTimeMin, i32SedenSnoozeMin;
+  motion_mag_run_t sedenMagRun;
+  //Sleep cycle state
+  motion_sleep_cycle_t sleepCycle, sleepCycle_pre;
+  motion_sleep_cycle_param_t sleepCycleParam;
+
+  //high pass filters, and their coefficients at the processing rate
+  iir_hpf_xyz_t iirPedo;
+  iir_hpf_xyz_t iirFall;
+  iir_hpf_xyz_t iirShake;
+  float fAlphaPedo, fAlphaFall, fAlphaShake;
+
+#if MOTION_ALG_PROFILE
+  //execution time of each registry entry, and of the whole sample
+  motion_profile_t profiles[MOTION_ALG_MAX_ENTRIES];
+  motion_profile_t profileTotal;
+#endif
+
+} motion_ctx_t;
+
+/*!
+ * @brief Initialize a motion context, at MOTION_ALG_DATA_RATE_HZ
+ *        Events are queued by motion_alg_process_data_ctx(), the handler is
+ *        called from motion_alg_dispatch_events_ctx()
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] eventFcn Motion event handler call back function
+ *
+ * @return 
+ *         0: success
+ *         1: fail
+ */
+int8_t motion_alg_init_ctx(motion_ctx_t *pCtx, MOTION_ALG_EVENT_HANDLER eventFcn);
+
+/*!
+ * @brief Enable/Disenable algorithms of a motion context
+ *        An algorithm is initialized when it gets enabled, algorithms that
+ *        are already enabled keep their states. The pedometer algorithms
+ *        are not enabled at 12.5Hz.
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] algSelections A bit-or (|) combination of motion_algorithm_t
+ * @param[in] enable 1 to enable, 0 to disenble the selected algorithms
+ *
+ * @return None
+ */
+void motion_alg_enable_ctx(motion_ctx_t *pCtx, int32_t algSelections, int8_t enable);
+
+/*!
+ * @brief Set the data rate of a motion context
+ *        Time constants are converted to the new rate, and the enabled
+ *        algorithms are initialized again, the step count and calories
+ *        carry on. The pedometer needs 25Hz or more, it runs on data
+ *        decimated to 25Hz at higher rates.
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] rate Data rate
+ *
+ * @return 1 for success, 0 if the rate is not supported or the pedometer
+ *         is enabled at 12.5Hz
+ */
+int8_t motion_alg_set_rate_ctx(motion_ctx_t *pCtx, motion_alg_rate_t rate);
+
+/*!
+ * @brief Get algorithm state of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] alg Algorithm selected
+ *
+ * @return State of the selected algorithm
+ */
+int32_t motion_alg_get_state_ctx(motion_ctx_t *pCtx, motion_algorithm_t alg);
+
+/*!
+ * @brief Get the tilt angles of a motion context, MOTION_ALG_TILT
+ *        Updated every MOTION_ALG_TILT_PERIOD_MS, see motion_tilt.h
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[out] pTilt Pointer to store the angles, in 1/TILT_ANGLE_SCALE degree
+ *
+ * @return 1 for success, 0 if MOTION_ALG_TILT is disabled or no angle is
+ *         computed yet
+ */
+int8_t motion_alg_get_tilt_ctx(motion_ctx_t *pCtx, motion_tilt_t *pTilt);
+
+/*!
+ * @brief Get the latency of the last fall of a motion context, MOTION_ALG_FALL
+ *        See motion_falldown.h
+ *
+ * @param[in] pCtx Pointer to the motion context
+ *
+ * @return Time from the impact to the fall event in ms, 0 if MOTION_ALG_FALL
+ *         is disabled or no fall is detected yet
+ */
+int32_t motion_alg_get_fall_latency_ctx(motion_ctx_t *pCtx);
+
+/*!
+ * @brief Get the index of the last sample processed by a motion context,
+ *        the ui32SampleIndex of the events raised on it
+ *
+ * @param[in] pCtx Pointer to the motion context
+ *
+ * @return Samples processed since the context was initialized
+ */
+uint32_t motion_alg_get_sample_index_ctx(motion_ctx_t *pCtx);
+
+/*!
+ * @brief Reset pedo step, activity and calories of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ *
+ * @return None
+ */
+void motion_pedo_reset_ctx(motion_ctx_t *pCtx);
+
+/*!
+ * @brief Set the calorie parameter of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] ht_m Height in meter
+ * @param[in] wt_kg Weight in kg
+ *
+ * @return None
+ */
+void motion_calorie_set_param_ctx(motion_ctx_t *pCtx, float ht_m, float wt_kg);
+
+/*!
+ * @brief Set the shake parameters of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] th_g threshold in g
+ * @param[in] dur_ms Peak duration in ms, at least one sample
+ * @param[in] cnt Peak count
+ * @param[in] timeout_ms Timeout (ms) for the peak count, MAX_DURATION for none
+ * @param[in] axes Select axes, a bit-or (|) combination of X_AXIS, Y_AXIS, Z_AXIS
+ *
+ * @return None
+ */
+void motion_shake_set_param_ctx(motion_ctx_t *pCtx,
+				float th_g,
+				int32_t dur_ms,
+				int32_t cnt,
+				int32_t timeout_ms,
+				int32_t axes);
+
+/*!
+ * @brief Set the sedentary parameters of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] sedentary_time_min Sedentary time in min
+ * @param[in] snooze_interval_min Interval to alarm sendentary
+ *
+ * @return None
+ */
+void motion_sedentary_set_param_ctx(motion_ctx_t *pCtx,
+				    int32_t sedentary_time_min,
+				    int32_t snooze_interval_min);
+
+/*!
+ * @brief Run the motion algorithm of a motion context, at the data rate set
+ *        by motion_alg_set_rate_ctx()
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] gVal accelerometer reading in g
+ *
+ * @return None
+ */
+void motion_alg_process_data_ctx(motion_ctx_t *pCtx, float_xyzt_t gVal);
+
+/*!
+ * @brief Dispatch the queued events of a motion context to its event handler
+ *        Call from a context with lower priority than motion_alg_process_data_ctx()
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] ui32MaxEvents Max number of events to dispatch
+ *
+ * @return Number of events dispatched
+ */
+uint32_t motion_alg_dispatch_events_ctx(motion_ctx_t *pCtx, uint32_t ui32MaxEvents);
+
+/*!
+ * @brief Pop one queued event of a motion context, for use instead of
+ *        motion_alg_dispatch_events_ctx()
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[out] pEvent Pointer to store the event
+ *
+ * @return 1 for success, 0 if no event is pending
+ */
+int8_t motion_alg_pop_event_ctx(motion_ctx_t *pCtx, motion_event_t *pEvent);
+
+/*!
+ * @brief Get the event queue statistics of a motion context
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[out] pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void motion_alg_get_event_stats_ctx(motion_ctx_t *pCtx, motion_event_queue_stats_t *pStats);
+
+#if MOTION_ALG_PROFILE
+/*!
+ * @brief Get the execution time profile of a motion context
+ *        Entries are the algorithm registry entries in processing order,
+ *        followed by the whole sample, named "total"
+ *
+ * @param[in] pCtx Pointer to the motion context
+ * @param[in] ui32Entry Entry index, from 0
+ * @param[out] ppName Pointer to store the entry name
+ * @param[out] pStats Pointer to store the statistics, in MOTION_PROFILE_UNIT
+ *
+ * @return 1 for success, 0 if ui32Entry is past the last entry
+ */
+int8_t motion_alg_get_profile_ctx(motion_ctx_t *pCtx,
+				  uint32_t ui32Entry,
+				  const char **ppName,
+				  motion_profile_stats_t *pStats);
+#endif
+
+//
+// Default context API, same as above on a built-in motion context
+//
+
 /*!
  * @brief Initialize the motion algorithm main control
+ *        Events are queued by motion_alg_process_data(), the handler is
+ *        called from motion_alg_dispatch_events()
  *
  * @param[in] eventFcn Motion event handler call back function
  *
@@ -62,6 +426,16 @@ typedef void (*MOTION_ALG_EVENT_HANDLER)(motion_algorithm_t event, int32_t i32Da
  */
 int8_t motion_alg_init(MOTION_ALG_EVENT_HANDLER eventFcn);
 
+/*!
+ * @brief Set the data rate, see motion_alg_set_rate_ctx()
+ *
+ * @param[in] rate Data rate
+ *
+ * @return 1 for success, 0 if the rate is not supported or the pedometer
+ *         is enabled at 12.5Hz
+ */
+int8_t motion_alg_set_rate(motion_alg_rate_t rate);
+
 /*!
  * @brief Enable/Disenable algorithms
  *
@@ -81,6 +455,32 @@ void motion_alg_enable(int32_t algSelections, int8_t enable);
  */
 int32_t motion_alg_get_state(motion_algorithm_t alg);
 
+/*!
+ * @brief Get the tilt angles, MOTION_ALG_TILT
+ *
+ * @param[out] pTilt Pointer to store the angles, in 1/TILT_ANGLE_SCALE degree
+ *
+ * @return 1 for success, 0 if MOTION_ALG_TILT is disabled or no angle is
+ *         computed yet
+ */
+int8_t motion_alg_get_tilt(motion_tilt_t *pTilt);
+
+/*!
+ * @brief Get the latency of the last fall, MOTION_ALG_FALL
+ *
+ * @return Time from the impact to the fall event in ms, 0 if MOTION_ALG_FALL
+ *         is disabled or no fall is detected yet
+ */
+int32_t motion_alg_get_fall_latency(void);
+
+/*!
+ * @brief Get the index of the last sample processed, the ui32SampleIndex of
+ *        the events raised on it
+ *
+ * @return Samples processed since motion_alg_init()
+ */
+uint32_t motion_alg_get_sample_index(void);
+
 /*!
  * @brief Reset pedo step, activity and calories
  *
@@ -105,17 +505,17 @@ void motion_calorie_set_param(float ht_m, float wt_kg);
  * @brief Set the shake parameters
  *
  * @param[in] th_g threshold in g
- * @param[in] dur Peak duration, number of time steps
+ * @param[in] dur_ms Peak duration in ms, at least one sample
  * @param[in] cnt Peak count
- * @param[in] timeout_s Timeout (sec) for the peak count
+ * @param[in] timeout_ms Timeout (ms) for the peak count, MAX_DURATION for none
  * @param[in] axes Select axes, a bit-or (|) combination of X_AXIS, Y_AXIS, Z_AXIS
  *
  * @return None
  */
 void motion_shake_set_param(float th_g,
-			    int32_t dur,
+			    int32_t dur_ms,
 			    int32_t cnt,
-			    float timeout_s,
+			    int32_t timeout_ms,
 			    int32_t axes);
 
 /*!
@@ -129,7 +529,7 @@ void motion_shake_set_param(float th_g,
 void motion_sedentary_set_param(int32_t sedentary_time_min, int32_t snooze_interval_min);
 
 /*!
- * @brief Run the motion algorithm, frequency should be 20Hz
+ * @brief Run the motion algorithm, at the data rate set by motion_alg_set_rate()
  *
  * @param[in] gVal accelerometer reading in g
  *
@@ -137,5 +537,49 @@ void motion_sedentary_set_param(int32_t sedentary_time_min, int32_t snooze_inter
  */
 void motion_alg_process_data(float_xyzt_t gVal);
 
+/*!
+ * @brief Dispatch the queued events to the event handler
+ *        Call from a context with lower priority than motion_alg_process_data()
+ *
+ * @param[in] ui32MaxEvents Max number of events to dispatch
+ *
+ * @return Number of events dispatched
+ */
+uint32_t motion_alg_dispatch_events(uint32_t ui32MaxEvents);
+
+/*!
+ * @brief Pop one queued event, for use instead of motion_alg_dispatch_events()
+ *
+ * @param[out] pEvent Pointer to store the event
+ *
+ * @return 1 for success, 0 if no event is pending
+ */
+int8_t motion_alg_pop_event(motion_event_t *pEvent);
+
+/*!
+ * @brief Get the event queue statistics
+ *
+ * @param[out] pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void motion_alg_get_event_stats(motion_event_queue_stats_t *pStats);
+
+#if MOTION_ALG_PROFILE
+/*!
+ * @brief Get the execution time profile
+ *        Entries are the algorithm registry entries in processing order,
+ *        followed by the whole sample, named "total"
+ *
+ * @param[in] ui32Entry Entry index, from 0
+ * @param[out] ppName Pointer to store the entry name
+ * @param[out] pStats Pointer to store the statistics, in MOTION_PROFILE_UNIT
+ *
+ * @return 1 for success, 0 if ui32Entry is past the last entry
+ */
+int8_t motion_alg_get_profile(uint32_t ui32Entry,
+			      const char **ppName,
+			      motion_profile_stats_t *pStats);
+#endif
 
 #endif //__MOTION_MAIN_CTRL_H__
@@ -27,26 +27,73 @@
  *
  **************************************************************************/
 
-#include <math.h>
 #include "motion_orientation.h"
 
-#define Rad2Deg (57.29578)
-#define SWITCH_THRESHOLD_DEG 45.f
-#define SWITCH_HYSTERESIS_DEG 15.f
+//|code| below 2^ORIENT_CODE_BITS, so D * v^2 and N * m^2 below fit in 32 bits
+#define ORIENT_CODE_BITS     (14)
 
-static motion_orient_t myOrientation = ORIENT_NA;
+//
+// cos^2 of a switch angle as N / D, for v the component along the axis
+// and m the magnitude in the plane tested
+//   angle to the axis < th  <=>  |cos| > cos(th)  <=>  D * v^2 > N * m^2
+// so the angles are never computed
+//
+typedef struct{
+
+  uint8_t ui8Num;
+  uint8_t ui8Den;
+
+} orient_cos2_t;
+
+#define ORIENT_COS2_30 {3, 4}
+#define ORIENT_COS2_45 {1, 2}
+#define ORIENT_COS2_60 {1, 4}
+
+//
+// Switch angles to the Z axis and to the X axis in the XY plane, per
+// orientation: 45 degrees, plus 15 to stay and minus 15 to leave
+//
+static const struct{
+
+  orient_cos2_t thZ;
+  orient_cos2_t thX;
+
+} orientSwitch[] = {
+  {ORIENT_COS2_45, ORIENT_COS2_45},   //ORIENT_NA
+  {ORIENT_COS2_30, ORIENT_COS2_60},   //ORIENT_X_POS
+  {ORIENT_COS2_30, ORIENT_COS2_60},   //ORIENT_X_NEG
+  {ORIENT_COS2_30, ORIENT_COS2_30},   //ORIENT_Y_POS
+  {ORIENT_COS2_30, ORIENT_COS2_30},   //ORIENT_Y_NEG
+  {ORIENT_COS2_60, ORIENT_COS2_45},   //ORIENT_Z_POS
+  {ORIENT_COS2_60, ORIENT_COS2_45}    //ORIENT_Z_NEG
+};
+
+/*!
+ * @brief Round a value in g to ORIENT_CODES_PER_G codes
+ *
+ * @param g Value in g
+ *
+ * @return Code
+ */
+static inline int32_t orientToCode(float g)
+{
+
+  float f = g * ORIENT_CODES_PER_G;
+
+  return (int32_t)(f >= 0.f ? f + 0.5f : f - 0.5f);
+}
 
 /*!
  * @brief Initialize orientation detection
  *
- * @param None
+ * @param pParam Pointer to the orientation parameter struct
  *
  * @return None
  */
-void orientInit(void)
+void orientInit(motion_orient_param_t *pParam)
 {
 
-  myOrientation = ORIENT_NA;
+  pParam->orientation = ORIENT_NA;
 
 }
 
@@ -54,65 +101,67 @@ void orientInit(void)
 /*!
  * @brief Process the orientation detection
  *
- * @param[in] gVal accelerometer reading in g
+ * @param pParam Pointer to the orientation parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
  *
  * @return Orientation
  */
-motion_orient_t processOrient(float_xyzt_t gVal)
+motion_orient_t processOrient(motion_orient_param_t *pParam, motion_features_t *pFeat)
 {
 
-  float gMag = sqrt(gVal.u.x * gVal.u.x + gVal.u.y * gVal.u.y + gVal.u.z * gVal.u.z);
-  float xi = acos(gVal.u.z / gMag) * Rad2Deg;
-  float xyMag = sqrt(gVal.u.x * gVal.u.x + gVal.u.y * gVal.u.y);
-  float psi = acos(gVal.u.x / xyMag) * Rad2Deg;
-  float thZ, thX;
-  
-  switch(myOrientation){
-  case ORIENT_NA:
-    thZ = SWITCH_THRESHOLD_DEG;
-    thX = SWITCH_THRESHOLD_DEG;
-    break;
-  case ORIENT_Z_POS:
-  case ORIENT_Z_NEG: //Check for switch
-    thZ = SWITCH_THRESHOLD_DEG + SWITCH_HYSTERESIS_DEG;
-    thX = SWITCH_THRESHOLD_DEG;
-    break;
-  case ORIENT_Y_POS:
-  case ORIENT_Y_NEG: //Check for switch
-    thZ = SWITCH_THRESHOLD_DEG - SWITCH_HYSTERESIS_DEG;
-    thX = SWITCH_THRESHOLD_DEG - SWITCH_HYSTERESIS_DEG;
-    break;
-  default: //X+/X-
-    thZ = SWITCH_THRESHOLD_DEG - SWITCH_HYSTERESIS_DEG;
-    thX = SWITCH_THRESHOLD_DEG + SWITCH_HYSTERESIS_DEG;
-    break;
+  const float_xyzt_t *pgVal = pFeat->pgVal;
+  int32_t x = orientToCode(pgVal->u.x);
+  int32_t y = orientToCode(pgVal->u.y);
+  int32_t z = orientToCode(pgVal->u.z);
+  uint32_t x2, xy2, z2, m2, absMax;
+  const orient_cos2_t *pThZ, *pThX;
+
+  //out of range, only the direction matters
+  absMax = (uint32_t)(x < 0 ? -x : x) | (uint32_t)(y < 0 ? -y : y) | (uint32_t)(z < 0 ? -z : z);
+  while(absMax >= (1u << ORIENT_CODE_BITS)){
+    x >>= 1;
+    y >>= 1;
+    z >>= 1;
+    absMax >>= 1;
   }
 
-  if(xi < thZ || xi > 180 - thZ){ //Tilt
-    myOrientation = gVal.u.z > 0 ? ORIENT_Z_POS : ORIENT_Z_NEG;
+  x2 = (uint32_t)(x * x);
+  xy2 = x2 + (uint32_t)(y * y);
+  z2 = (uint32_t)(z * z);
+  m2 = xy2 + z2;
+
+  //No direction
+  if(m2 == 0)
+    return pParam->orientation;
+
+  pThZ = &orientSwitch[pParam->orientation].thZ;
+  pThX = &orientSwitch[pParam->orientation].thX;
+
+  if(pThZ->ui8Den * z2 > pThZ->ui8Num * m2){ //Tilt
+    pParam->orientation = z > 0 ? ORIENT_Z_POS : ORIENT_Z_NEG;
   }
   else{
-    if(psi < thX || psi > 180 - thX){ //X
-      myOrientation = gVal.u.x > 0 ? ORIENT_X_POS : ORIENT_X_NEG;
+    if(pThX->ui8Den * x2 > pThX->ui8Num * xy2){ //X
+      pParam->orientation = x > 0 ? ORIENT_X_POS : ORIENT_X_NEG;
     }
     else{ //Y
-      myOrientation = gVal.u.y > 0 ? ORIENT_Y_POS : ORIENT_Y_NEG;
+      pParam->orientation = y > 0 ? ORIENT_Y_POS : ORIENT_Y_NEG;
     }
   }
 
-  return myOrientation;
+  return pParam->orientation;
 }
 
 /*!
  * @brief Get the orientation
  *
- * @param None
+ * @param pParam Pointer to the orientation parameter struct
  *
  * @return Orientation
  */
-motion_orient_t getOrient(void)
+motion_orient_t getOrient(motion_orient_param_t *pParam)
 {
 
-  return myOrientation;
+  return pParam->orientation;
 
 }
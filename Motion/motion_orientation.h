@@ -31,6 +31,7 @@
 #define __MOTION_ORIENTATION_H__
 
 #include "type_support.h"
+#include "motion_features.h"
 
 typedef enum {
   ORIENT_NA,
@@ -39,32 +40,48 @@ typedef enum {
   ORIENT_Z_POS, ORIENT_Z_NEG
 } motion_orient_t;
 
+//
+// The classification is done on integer codes of the sample, at the
+// GMA303 resolution, so the g values of main.c convert back exactly
+//
+#define ORIENT_CODES_PER_G   (512)
+
+typedef struct{
+
+  motion_orient_t orientation;
+
+} motion_orient_param_t;
+
 /*!
  * @brief Initialize orientation detection
  *
- * @param None
+ * @param pParam Pointer to the orientation parameter struct
  *
  * @return None
  */
-void orientInit(void);
+void orientInit(motion_orient_param_t *pParam);
 
 
 /*!
  * @brief Process the orientation detection
+ *        Face of the axis closest to the gravity, with a hysteresis of 15
+ *        degrees around the 45 degrees switch angles. A zero vector keeps
+ *        the orientation.
  *
- * @param[in] gVal accelerometer reading in g
+ * @param pParam Pointer to the orientation parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
  *
  * @return Orientation
  */
-motion_orient_t processOrient(float_xyzt_t gVal);
+motion_orient_t processOrient(motion_orient_param_t *pParam, motion_features_t *pFeat);
 
 /*!
  * @brief Get the orientation
  *
- * @param None
+ * @param pParam Pointer to the orientation parameter struct
  *
  * @return Orientation
  */
-motion_orient_t getOrient(void);
+motion_orient_t getOrient(motion_orient_param_t *pParam);
 
 #endif //__MOTION_ORIENTATION_H__
@@ -27,22 +27,17 @@
  *
  **************************************************************************/
 
+#include <stddef.h>
+#include <math.h>
+#include "motion_period.h"
 #include "motion_pedo.h"
 
 #define PEDO_SENSITIVITY {512.0f, 512.0f, 512.0f} //pedometer sensitivity, codes/g
-#define CALORIE_UPDATE_TIME_INTERVAL_SEC 2
-#define SAMPLING_RATE_HZ                 25
-#define CALORIE_UPDATE_TIME_STEPS        (CALORIE_UPDATE_TIME_INTERVAL_SEC * SAMPLING_RATE_HZ)
-
-static float height_m = 0.0;
-static float weight_kg = 0.0;
-static float calories = 0.0;
-static uint32_t step_pre = 0;
-static uint32_t time_step_interval = 0;
+#define CALORIE_UPDATE_TIME_INTERVAL_MS  2000
 
 static const float pedoSensitivity[] = PEDO_SENSITIVITY;
 
-float getStride(int32_t step_2)
+float getStride(motion_pedo_param_t *pParam, int32_t step_2)
 {
 
   float sf = 1.2;
@@ -62,21 +57,26 @@ float getStride(int32_t step_2)
   else
     sf = 1.2;
 
-  return height_m * sf;
+  return pParam->height_m * sf;
 
 }
 
 /*!
  * @brief Initialize the pedometer
  *
+ * @param pParam Pointer to the pedometer parameter struct
+ * @param ui32PeriodMs Processing period in ms
+ *
  * @return None
  */
-void pedoInit()
+void pedoInit(motion_pedo_param_t *pParam, uint32_t ui32PeriodMs)
 {
 
-  calories = 0.0;
-  step_pre = 0;
-  time_step_interval = 0;
+  pParam->calories = 0.0;
+  pParam->step_pre = 0;
+  pParam->activity_pre = PEDO_ACTIVITY_STATIONARY;
+  pParam->time_step_interval = 0;
+  pParam->calorie_update_steps = MOTION_ALG_MS_TO_COUNT(CALORIE_UPDATE_TIME_INTERVAL_MS, ui32PeriodMs);
 
   PEDO_InitAlgo(0);
 }
@@ -84,73 +84,203 @@ void pedoInit()
 /*!
  * @brief Set the pedometer parameters
  *
+ * @param pParam Pointer to the pedometer parameter struct
  * @param[in] ht_m Height in meter
  * @param[in] wt_kg Weight in kg
  *
  * @return None
  */
-void pedoSetParam(float ht_m, float wt_kg){
+void pedoSetParam(motion_pedo_param_t *pParam, float ht_m, float wt_kg){
 
-  height_m = ht_m;
-  weight_kg = wt_kg;
+  pParam->height_m = ht_m;
+  pParam->weight_kg = wt_kg;
 
 }
 
 /*!
  * @brief Reset the pedomters, step and calories will reset to 0
  *
- * @param None
+ * @param pParam Pointer to the pedometer parameter struct
  *
  * @return None
  */
-void pedoReset(void)
+void pedoReset(motion_pedo_param_t *pParam)
 {
 
-  calories = 0.0;
-  step_pre = 0;
-  time_step_interval = 0;
+  pParam->calories = 0.0;
+  pParam->step_pre = 0;
+  pParam->activity_pre = PEDO_ACTIVITY_STATIONARY;
+  pParam->time_step_interval = 0;
 
   PEDO_ResetAlgo();
 }
 
+/*!
+ * @brief Convert a high-pass filtered sample to the step detector input
+ *
+ * @param[in] gVal accelerometer reading in g
+ * @param[out] pSample Step detector input
+ *
+ * @return None
+ */
+void pedoToCodes(float_xyzt_t gVal, pedo_sample_t *pSample)
+{
+
+  int i;
+
+  for(i = 0; i < 3; ++i)
+    pSample->v[i] = (int16_t)lrintf(gVal.v[i] * pedoSensitivity[i]);
+}
+
 /*!
  * @brief Process the pedometer
  *
+ * @param pParam Pointer to the pedometer parameter struct
  * @param[in] gVal accelerometer reading in g
  *
  * @return Pedometer steps
  */
-uint32_t processPedo(float_xyzt_t gVal)
+uint32_t processPedo(motion_pedo_param_t *pParam, float_xyzt_t gVal)
 {
-  int i;
-  int16_t acc[3];
+
+  pedo_sample_t sample;
+  pedo_block_result_t result;
+
+  pedoToCodes(gVal, &sample);
+
+  return processPedoBlock(pParam, &sample, 1, NULL, 0, &result);
+}
+
+/*!
+ * @brief Store a change of a block, merged into the last change if it is on
+ *        the same sample or if there is no room left
+ *
+ * @param[out] pChanges Changes of the block
+ * @param[in] ui32MaxChanges Capacity of pChanges
+ * @param pResult Block result, counting the changes
+ * @param[in] ui32Offset Sample in the block
+ * @param[in] ui8Changed Bit-or of PEDO_CHANGE_*
+ * @param[in] ui32StepCount Steps after the sample
+ * @param[in] ui8Activity Activity after the sample
+ * @param[in] fCalories Calories after the sample
+ *
+ * @return None
+ */
+static void pedoAddChange(pedo_change_t *pChanges,
+			  uint32_t ui32MaxChanges,
+			  pedo_block_result_t *pResult,
+			  uint32_t ui32Offset,
+			  uint8_t ui8Changed,
+			  uint32_t ui32StepCount,
+			  uint8_t ui8Activity,
+			  float fCalories)
+{
+
+  pedo_change_t *pChange;
+  uint32_t n = pResult->ui32ChangeCount;
+
+  if(ui32MaxChanges == 0)
+    return;
+
+  if(n > 0 && (n == ui32MaxChanges || pChanges[n - 1].ui16Offset == ui32Offset))
+    pChange = &pChanges[n - 1];
+  else{
+    pChange = &pChanges[n];
+    pChange->ui8Changed = 0;
+    pResult->ui32ChangeCount = n + 1;
+  }
+
+  pChange->ui16Offset = (uint16_t)ui32Offset;
+  pChange->ui8Changed |= ui8Changed;
+  pChange->ui8Activity = ui8Activity;
+  pChange->ui32StepCount = ui32StepCount;
+  pChange->fCalories = fCalories;
+}
+
+/*!
+ * @brief Process a block of samples of the pedometer, e.g. a sensor FIFO read
+ *        Same steps and calories as processPedo() on each sample, each
+ *        change is stored with its offset. Once pChanges is full, later
+ *        changes are merged into its last entry.
+ *
+ * @param pParam Pointer to the pedometer parameter struct
+ * @param[in] pSamples Samples, see pedoToCodes()
+ * @param[in] ui32Count Number of samples, at most UINT16_MAX + 1
+ * @param[out] pChanges Changes of the block, NULL if ui32MaxChanges is 0
+ * @param[in] ui32MaxChanges Capacity of pChanges
+ * @param[out] pResult Totals at the end of the block
+ *
+ * @return Pedometer steps
+ */
+uint32_t processPedoBlock(motion_pedo_param_t *pParam,
+			  const pedo_sample_t *pSamples,
+			  uint32_t ui32Count,
+			  pedo_change_t *pChanges,
+			  uint32_t ui32MaxChanges,
+			  pedo_block_result_t *pResult)
+{
+
+  uint32_t i;
   int32_t step_cal;
-  int32_t pedoStep;
+  int32_t pedoStep, pedoStep_pre;
+  uint8_t activity;
+  uint8_t ui8Changed;
 
-  for(i = 0; i < 3; ++i)
-    acc[i] = (int16_t)(gVal.v[i] * pedoSensitivity[i] + 0.5);
+  pedoStep = pedoStep_pre = PEDO_GetStepCount();
+
+  pResult->ui32ChangeCount = 0;
+
+  for(i = 0; i < ui32Count; ++i){
+
+    ui8Changed = 0;
 
-  //feed to algorithm
-  PEDO_ProcessAccelarationData(acc[0], acc[1], acc[2]);
+    //feed to algorithm and get the pedo steps
+#if PEDO_LIB
+    PEDO_ProcessAccelarationData(pSamples[i].u.x, pSamples[i].u.y, pSamples[i].u.z);
+    pedoStep = PEDO_GetStepCount();
+#else
+    pedoStep += PEDO_ProcessAccelarationData(pSamples[i].u.x, pSamples[i].u.y, pSamples[i].u.z);
+#endif
 
-  //get the pedo steps
-  pedoStep = PEDO_GetStepCount();
+    if(pedoStep != pedoStep_pre){
+      pedoStep_pre = pedoStep;
+      ui8Changed |= PEDO_CHANGE_STEP;
+    }
 
-  //Calculate the carlories
-  ++time_step_interval;
-  if(time_step_interval > CALORIE_UPDATE_TIME_STEPS){
+    //Calculate the carlories
+    ++pParam->time_step_interval;
+    if(pParam->time_step_interval > pParam->calorie_update_steps){
 
-    step_cal = (pedoStep - step_pre);
-    time_step_interval = 0;
-    step_pre = pedoStep;
+      step_cal = (pedoStep - pParam->step_pre);
+      pParam->time_step_interval = 0;
+      pParam->step_pre = pedoStep;
 
-    if(step_cal == 0)
-      calories += weight_kg / 1800.0;
-    else
-      calories += step_cal * getStride(step_cal) * weight_kg / 800.0;
+      if(step_cal == 0)
+	pParam->calories += pParam->weight_kg / 1800.0;
+      else
+	pParam->calories += step_cal * getStride(pParam, step_cal) * pParam->weight_kg / 800.0;
+
+      ui8Changed |= PEDO_CHANGE_CALORIE;
+    }
+
+    if(ui8Changed)
+      pedoAddChange(pChanges, ui32MaxChanges, pResult, i, ui8Changed,
+		    (uint32_t)pedoStep, pParam->activity_pre, pParam->calories);
+  }
+
+  //The activity changes slowly, read it once per block
+  activity = PEDO_GetActivity();
+  if(activity != pParam->activity_pre && ui32Count > 0){
+    pParam->activity_pre = activity;
+    pedoAddChange(pChanges, ui32MaxChanges, pResult, ui32Count - 1, PEDO_CHANGE_ACTIVITY,
+		  (uint32_t)pedoStep, activity, pParam->calories);
   }
 
-  return pedoStep;
+  pResult->ui32StepCount = (uint32_t)pedoStep;
+  pResult->ui8Activity = pParam->activity_pre;
+  pResult->fCalories = pParam->calories;
+
+  return (uint32_t)pedoStep;
 }
 
 /*!
@@ -187,13 +317,13 @@ uint8_t getPedoActivity(void)
 /*!
  * @brief Get the pedometer calories
  *
- * @param None
+ * @param pParam Pointer to the pedometer parameter struct
  *
  * @return Pedometer calories
  */
-float getPedoCalorie(void)
+float getPedoCalorie(motion_pedo_param_t *pParam)
 {
 
-  return calories;
+  return pParam->calories;
 
 }
@@ -30,47 +30,141 @@
 #define __MOTION_PEDO_H__
 
 #include "type_support.h"
+#include "motion_step_detector.h"
 
-extern void PEDO_InitAlgo(unsigned char);
-extern short PEDO_ProcessAccelarationData(short, short, short);
-extern unsigned long PEDO_GetStepCount(void);
-extern unsigned char PEDO_GetActivity(void);
-extern void PEDO_ResetAlgo(void);
+//1: the step detector is libpedo.a, the steps are queried after each
+//sample as PEDO_ProcessAccelarationData() of libpedo.a returns no step count
+#ifndef PEDO_LIB
+#define PEDO_LIB (1)
+#endif
+
+//
+// Pedometer parameters and calorie states
+// Note: the PEDO_* step detector keeps a single global state, so only one
+// motion context at a time may run the pedometer
+//
+typedef struct{
+
+  float height_m;
+  float weight_kg;
+  float calories;
+  uint32_t step_pre;
+  uint8_t activity_pre;           //at the end of the last block
+  uint32_t time_step_interval;
+  uint32_t calorie_update_steps;  //calorie update interval, in samples
+
+} motion_pedo_param_t;
+
+//One sample of the step detector input, in codes of PEDO_CODES_PER_G
+typedef union {
+  struct{
+    int16_t x;
+    int16_t y;
+    int16_t z;
+  } u;
+  int16_t v[3];
+} pedo_sample_t;
+
+//pedo_change_t flags
+#define PEDO_CHANGE_STEP      (1)
+#define PEDO_CHANGE_ACTIVITY  (2)
+#define PEDO_CHANGE_CALORIE   (4)
+
+//
+// A change in a block of samples, with the values after the sample.
+// The activity is read once per block, its change is on the last sample.
+//
+typedef struct{
+
+  uint16_t ui16Offset;     //sample in the block
+  uint8_t ui8Changed;      //bit-or of PEDO_CHANGE_*
+  uint8_t ui8Activity;
+  uint32_t ui32StepCount;
+  float fCalories;
+
+} pedo_change_t;
+
+//Totals at the end of a block of samples
+typedef struct{
+
+  uint32_t ui32StepCount;
+  uint8_t ui8Activity;
+  float fCalories;
+  uint32_t ui32ChangeCount;   //changes stored, in sample order
+
+} pedo_block_result_t;
 
 /*!
  * @brief Initialize the pedometer
  *
+ * @param pParam Pointer to the pedometer parameter struct
+ * @param ui32PeriodMs Processing period in ms
+ *
  * @return None
  */
-void pedoInit(void);
+void pedoInit(motion_pedo_param_t *pParam, uint32_t ui32PeriodMs);
 
 /*!
  * @brief Set the pedometer parameters
  *
+ * @param pParam Pointer to the pedometer parameter struct
  * @param[in] ht_m Height in meter
  * @param[in] wt_kg Weight in kg
  *
  * @return None
  */
-void pedoSetParam(float ht_m, float wt_kg);
+void pedoSetParam(motion_pedo_param_t *pParam, float ht_m, float wt_kg);
 
 /*!
  * @brief Reset the pedomters, step and calories will reset to 0
  *
- * @param None
+ * @param pParam Pointer to the pedometer parameter struct
  *
  * @return None
  */
-void pedoReset(void);
+void pedoReset(motion_pedo_param_t *pParam);
 
 /*!
  * @brief Process the pedometer
  *
+ * @param pParam Pointer to the pedometer parameter struct
  * @param[in] gVal accelerometer reading in g
  *
  * @return Pedometer steps
  */
-uint32_t processPedo(float_xyzt_t gVal);
+uint32_t processPedo(motion_pedo_param_t *pParam, float_xyzt_t gVal);
+
+/*!
+ * @brief Convert a high-pass filtered sample to the step detector input
+ *
+ * @param[in] gVal accelerometer reading in g
+ * @param[out] pSample Step detector input
+ *
+ * @return None
+ */
+void pedoToCodes(float_xyzt_t gVal, pedo_sample_t *pSample);
+
+/*!
+ * @brief Process a block of samples of the pedometer, e.g. a sensor FIFO read
+ *        Same steps and calories as processPedo() on each sample, each
+ *        change is stored with its offset. Once pChanges is full, later
+ *        changes are merged into its last entry.
+ *
+ * @param pParam Pointer to the pedometer parameter struct
+ * @param[in] pSamples Samples, see pedoToCodes()
+ * @param[in] ui32Count Number of samples, at most UINT16_MAX + 1
+ * @param[out] pChanges Changes of the block, NULL if ui32MaxChanges is 0
+ * @param[in] ui32MaxChanges Capacity of pChanges
+ * @param[out] pResult Totals at the end of the block
+ *
+ * @return Pedometer steps
+ */
+uint32_t processPedoBlock(motion_pedo_param_t *pParam,
+			  const pedo_sample_t *pSamples,
+			  uint32_t ui32Count,
+			  pedo_change_t *pChanges,
+			  uint32_t ui32MaxChanges,
+			  pedo_block_result_t *pResult);
 
 /*!
  * @brief Get the pedometer steps
@@ -96,11 +190,11 @@ uint8_t getPedoActivity(void);
 /*!
  * @brief Get the pedometer calories
  *
- * @param None
+ * @param pParam Pointer to the pedometer parameter struct
  *
  * @return Pedometer calories
  */
-float getPedoCalorie(void);
+float getPedoCalorie(motion_pedo_param_t *pParam);
 
 
 #endif //__MOTION_PEDO_H__
@@ -0,0 +1,46 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_period.h
+ *
+ * Usage: Processing period conversions shared by the motion algorithms
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#ifndef __MOTION_PERIOD_H__
+#define __MOTION_PERIOD_H__
+
+//Sample period the filter coefficients are designed at, 25Hz
+#define MOTION_ALG_REF_PERIOD_MS (40)
+
+//Number of samples in ms at a processing period, rounded, at least 1
+#define MOTION_ALG_MS_TO_COUNT(ms, periodMs) \
+  (((ms) + (periodMs) / 2) / (periodMs) > 0 ? ((ms) + (periodMs) / 2) / (periodMs) : 1)
+
+//High-pass filter coefficient at a processing period, same time constant as
+//alpha at MOTION_ALG_REF_PERIOD_MS
+#define MOTION_ALG_PERIOD_ALPHA(alpha, periodMs)			\
+  ((periodMs) == MOTION_ALG_REF_PERIOD_MS ? (alpha) :			\
+   (alpha) / ((alpha) + (1.0f - (alpha)) * ((float)(periodMs) / MOTION_ALG_REF_PERIOD_MS)))
+
+#endif //__MOTION_PERIOD_H__
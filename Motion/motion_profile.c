@@ -0,0 +1,248 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_profile.c
+ *
+ * Usage: Execution time profiling of the motion algorithms
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "motion_profile.h"
+
+#if MOTION_ALG_PROFILE
+
+#ifdef NRF51
+#include "nrf.h"
+#define PROFILE_TIMER     NRF_TIMER1
+#define PROFILE_CC        (1)
+#else
+#include <time.h>
+#endif
+
+#define PROFILE_COUNT_MAX (0xFFFF)
+
+/*!
+ * @brief Start the profiling time base
+ *
+ * @param None
+ *
+ * @return None
+ */
+void profileTimerInit(void)
+{
+
+#ifdef NRF51
+  //Free running 32-bit timer at 16MHz
+  PROFILE_TIMER->TASKS_STOP = 1;
+  PROFILE_TIMER->MODE = TIMER_MODE_MODE_Timer;
+  PROFILE_TIMER->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+  PROFILE_TIMER->PRESCALER = 0;
+  PROFILE_TIMER->TASKS_CLEAR = 1;
+  PROFILE_TIMER->TASKS_START = 1;
+#endif
+}
+
+/*!
+ * @brief Read the profiling time base
+ *
+ * @param None
+ *
+ * @return Free running time in MOTION_PROFILE_UNIT
+ */
+uint32_t profileTimerNow(void)
+{
+
+#ifdef NRF51
+  PROFILE_TIMER->TASKS_CAPTURE[PROFILE_CC] = 1;
+  return PROFILE_TIMER->CC[PROFILE_CC];
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+#endif
+}
+
+/*!
+ * @brief Histogram bin of a time, values below 4 have their own bin,
+ *        above that each octave is split in 2 bins
+ *
+ * @param ui32Time Time
+ *
+ * @return Bin index
+ */
+static uint32_t profileBin(uint32_t ui32Time)
+{
+
+  uint32_t ui32Octave, ui32Bin;
+
+  if(ui32Time < 4)
+    return ui32Time;
+
+  ui32Octave = 31 - __builtin_clz(ui32Time);
+  ui32Bin = 2 * ui32Octave + ((ui32Time >> (ui32Octave - 1)) & 0x01);
+
+  return (ui32Bin < MOTION_PROFILE_BINS) ? ui32Bin : MOTION_PROFILE_BINS - 1;
+}
+
+/*!
+ * @brief Largest time falling in a histogram bin
+ *
+ * @param ui32Bin Bin index
+ *
+ * @return Upper bound of the bin
+ */
+static uint32_t profileBinUpper(uint32_t ui32Bin)
+{
+
+  uint32_t ui32Octave = ui32Bin / 2;
+
+  if(ui32Bin < 4)
+    return ui32Bin;
+
+  if(ui32Bin == MOTION_PROFILE_BINS - 1)
+    return 0xFFFFFFFF;
+
+  return ((3 + (ui32Bin & 0x01)) << (ui32Octave - 1)) - 1;
+}
+
+/*!
+ * @brief Clear a profile
+ *
+ * @param pProfile Pointer to the profile
+ *
+ * @return None
+ */
+void profileInit(motion_profile_t *pProfile)
+{
+
+  uint32_t i;
+
+  pProfile->ui32Count = 0;
+  pProfile->ui32Min = 0xFFFFFFFF;
+  pProfile->ui32Max = 0;
+  pProfile->ui64Sum = 0;
+
+  for(i = 0; i < MOTION_PROFILE_BINS; ++i)
+    pProfile->hist[i] = 0;
+}
+
+/*!
+ * @brief Record one execution time
+ *
+ * @param pProfile Pointer to the profile
+ * @param ui32Time Execution time in MOTION_PROFILE_UNIT
+ *
+ * @return None
+ */
+void profileRecord(motion_profile_t *pProfile, uint32_t ui32Time)
+{
+
+  uint32_t i, ui32Bin = profileBin(ui32Time);
+
+  ++pProfile->ui32Count;
+  pProfile->ui64Sum += ui32Time;
+  if(ui32Time < pProfile->ui32Min) pProfile->ui32Min = ui32Time;
+  if(ui32Time > pProfile->ui32Max) pProfile->ui32Max = ui32Time;
+
+  //Halve the histogram on saturation, the percentiles are kept
+  if(pProfile->hist[ui32Bin] == PROFILE_COUNT_MAX)
+    for(i = 0; i < MOTION_PROFILE_BINS; ++i)
+      pProfile->hist[i] >>= 1;
+
+  ++pProfile->hist[ui32Bin];
+}
+
+/*!
+ * @brief Add the records of a profile to another
+ *
+ * @param pDst Pointer to the profile to add to
+ * @param pSrc Pointer to the profile to add
+ *
+ * @return None
+ */
+void profileMerge(motion_profile_t *pDst, const motion_profile_t *pSrc)
+{
+
+  uint32_t i, ui32Shift = 0, ui32Count, ui32CountMax = 0;
+
+  if(pSrc->ui32Count == 0)
+    return;
+
+  pDst->ui32Count += pSrc->ui32Count;
+  pDst->ui64Sum += pSrc->ui64Sum;
+  if(pSrc->ui32Min < pDst->ui32Min) pDst->ui32Min = pSrc->ui32Min;
+  if(pSrc->ui32Max > pDst->ui32Max) pDst->ui32Max = pSrc->ui32Max;
+
+  //Scale down both histograms if the sum saturates, the percentiles are kept
+  for(i = 0; i < MOTION_PROFILE_BINS; ++i){
+    ui32Count = (uint32_t)pDst->hist[i] + pSrc->hist[i];
+    if(ui32Count > ui32CountMax) ui32CountMax = ui32Count;
+  }
+
+  while((ui32CountMax >> ui32Shift) > PROFILE_COUNT_MAX)
+    ++ui32Shift;
+
+  for(i = 0; i < MOTION_PROFILE_BINS; ++i)
+    pDst->hist[i] = ((uint32_t)pDst->hist[i] + pSrc->hist[i]) >> ui32Shift;
+}
+
+/*!
+ * @brief Get the statistics of a profile
+ *
+ * @param pProfile Pointer to the profile
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getProfileStats(const motion_profile_t *pProfile, motion_profile_stats_t *pStats)
+{
+
+  uint32_t i, ui32Total = 0, ui32Acc = 0;
+
+  pStats->ui32Count = pProfile->ui32Count;
+
+  if(pProfile->ui32Count == 0){
+    pStats->ui32Min = pStats->ui32Mean = pStats->ui32Max = pStats->ui32P99 = 0;
+    return;
+  }
+
+  pStats->ui32Min = pProfile->ui32Min;
+  pStats->ui32Max = pProfile->ui32Max;
+  pStats->ui32Mean = (uint32_t)(pProfile->ui64Sum / pProfile->ui32Count);
+
+  for(i = 0; i < MOTION_PROFILE_BINS; ++i)
+    ui32Total += pProfile->hist[i];
+
+  //first bin where the cumulated count reaches 99%
+  for(i = 0; i < MOTION_PROFILE_BINS; ++i){
+    ui32Acc += pProfile->hist[i];
+    if((uint64_t)ui32Acc * 100 >= (uint64_t)ui32Total * 99) break;
+  }
+
+  pStats->ui32P99 = profileBinUpper(i);
+  if(pStats->ui32P99 > pStats->ui32Max)
+    pStats->ui32P99 = pStats->ui32Max;
+}
+
+#endif //MOTION_ALG_PROFILE
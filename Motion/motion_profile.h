@@ -0,0 +1,143 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_profile.h
+ *
+ * Usage: Execution time profiling of the motion algorithms
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#ifndef __MOTION_PROFILE_H__
+#define __MOTION_PROFILE_H__
+
+#include "type_support.h"
+
+//
+// Profiling is compiled out unless MOTION_ALG_PROFILE is set to 1
+// On the nRF51 the time is counted by TIMER1 at 16MHz, one tick per CPU
+// cycle, on a host by the monotonic clock in ns.
+//
+#ifndef MOTION_ALG_PROFILE
+#define MOTION_ALG_PROFILE (0)
+#endif
+
+#ifdef NRF51
+#define MOTION_PROFILE_UNIT "cycles"
+#else
+#define MOTION_PROFILE_UNIT "ns"
+#endif
+
+//Histogram bins, 2 bins per octave, the last bin holds 2^23 and above
+#define MOTION_PROFILE_BINS (48)
+
+typedef struct{
+
+  uint32_t ui32Count;
+  uint32_t ui32Min;
+  uint32_t ui32Max;
+  uint64_t ui64Sum;
+  uint16_t hist[MOTION_PROFILE_BINS]; //halved when a bin saturates
+
+} motion_profile_t;
+
+typedef struct{
+
+  uint32_t ui32Count;
+  uint32_t ui32Min;
+  uint32_t ui32Mean;
+  uint32_t ui32Max;
+  uint32_t ui32P99;  //upper bound of the bin holding the 99th percentile
+
+} motion_profile_stats_t;
+
+/*!
+ * @brief Start the profiling time base
+ *
+ * @param None
+ *
+ * @return None
+ */
+void profileTimerInit(void);
+
+/*!
+ * @brief Read the profiling time base
+ *
+ * @param None
+ *
+ * @return Free running time in MOTION_PROFILE_UNIT
+ */
+uint32_t profileTimerNow(void);
+
+/*!
+ * @brief Clear a profile
+ *
+ * @param pProfile Pointer to the profile
+ *
+ * @return None
+ */
+void profileInit(motion_profile_t *pProfile);
+
+/*!
+ * @brief Record one execution time
+ *
+ * @param pProfile Pointer to the profile
+ * @param ui32Time Execution time in MOTION_PROFILE_UNIT
+ *
+ * @return None
+ */
+void profileRecord(motion_profile_t *pProfile, uint32_t ui32Time);
+
+/*!
+ * @brief Add the records of a profile to another
+ *
+ * @param pDst Pointer to the profile to add to
+ * @param pSrc Pointer to the profile to add
+ *
+ * @return None
+ */
+void profileMerge(motion_profile_t *pDst, const motion_profile_t *pSrc);
+
+/*!
+ * @brief Get the statistics of a profile
+ *
+ * @param pProfile Pointer to the profile
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getProfileStats(const motion_profile_t *pProfile, motion_profile_stats_t *pStats);
+
+#if MOTION_ALG_PROFILE
+#define MOTION_PROFILE_START(start) uint32_t start = profileTimerNow()
+#define MOTION_PROFILE_STOP(pProfile, start) profileRecord(pProfile, profileTimerNow() - (start))
+#define MOTION_PROFILE_STOP_MAX(ui32Max, start) do{			\
+    uint32_t ui32Time = profileTimerNow() - (start);			\
+    if(ui32Time > (ui32Max)) (ui32Max) = ui32Time;			\
+  }while(0)
+#else
+#define MOTION_PROFILE_START(start)
+#define MOTION_PROFILE_STOP(pProfile, start)
+#define MOTION_PROFILE_STOP_MAX(ui32Max, start)
+#endif
+
+#endif //__MOTION_PROFILE_H__
@@ -26,31 +26,119 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  **************************************************************************/
+#include "motion_period.h"
 #include "motion_shake.h"
 
 static const m_axis_t allAxes[] = {X_AXIS, Y_AXIS, Z_AXIS};
 
-void resetStates(motion_shake_param_t *pParam, int32_t face, int32_t axis)
+//All ones if the condition is true, 0 otherwise
+#define LANE_MASK(cond) (-(int32_t)(cond))
+
+/*!
+ * @brief Clamp a duration, count or time out to a 16-bit counter
+ *
+ * @param val Value in samples or counts
+ *
+ * @return Value in [0, SHAKE_COUNTER_MAX]
+ */
+static uint16_t shakeClamp(int32_t val)
+{
+
+  if(val < 0)
+    return 0;
+
+  return (val > SHAKE_COUNTER_MAX) ? SHAKE_COUNTER_MAX : (uint16_t)val;
+}
+
+/*!
+ * @brief Integer key of a float of the same order, so thresholds are
+ *        compared without a soft-float call on the Cortex-M0
+ *
+ * @param f Value
+ *
+ * @return Key, 0 for -0 and 0, minus the key of f for -f
+ */
+static inline int32_t shakeKey(float f)
+{
+
+  union{
+    float f;
+    int32_t i;
+  } u;
+  int32_t sign;
+
+  u.f = f;
+  sign = u.i >> 31;
+
+  return (u.i ^ (sign & 0x7FFFFFFF)) - sign;
+}
+
+/*!
+ * @brief Run the state machine of one face, every step a comparison mask
+ *        instead of a branch
+ *
+ * @param in Key of the data, negated for a negative face
+ * @param th Key of the threshold
+ * @param dur Duration setting of the axis
+ * @param cnt Count setting of the axis
+ * @param tmd Time out setting of the axis
+ * @param pDur Duration state of the face
+ * @param pCnt Count state of the face
+ * @param pTmo Time out state of the face
+ * @param pFlag ToCount flag of the face, 0 or 1
+ *
+ * @return All ones on an event, 0 otherwise
+ */
+static inline int32_t shakeFaceStep(int32_t in, int32_t th,
+				    int32_t dur, int32_t cnt, int32_t tmd,
+				    uint16_t *pDur, uint16_t *pCnt, uint16_t *pTmo,
+				    int32_t *pFlag)
 {
 
-  pParam->stateDuration[face].v[axis] = 0;
-  pParam->stateCount[face].v[axis] = 0;
-  pParam->stateTimeOutDuration[face].v[axis] = 0;
-  pParam->flagToCount[face].v[axis] = 0;
+  int32_t d = *pDur, c = *pCnt, t = *pTmo, flag = -*pFlag;
+  int32_t mask, reset;
+
+  //duration above the threshold, saturating
+  d = (d + (d != SHAKE_COUNTER_MAX)) & LANE_MASK(in >= th);
+
+  //a new peak inits the time out of a first peak and arms the count
+  mask = LANE_MASK(d == 1);
+  t &= ~mask | LANE_MASK(c != 0);
+  flag |= mask;
+
+  //a peak long enough is counted once
+  mask = LANE_MASK(d >= dur) & flag;
+  c += mask & (c != SHAKE_COUNTER_MAX);
+  flag &= ~mask;
+
+  //enough peaks and back below the threshold is an event
+  mask = LANE_MASK(c >= cnt) & LANE_MASK(d == 0);
+  t &= ~mask;
 
+  //time out, never at SHAKE_COUNTER_MAX
+  reset = LANE_MASK(t >= tmd) & LANE_MASK(tmd != SHAKE_COUNTER_MAX);
+
+  *pDur = (uint16_t)(d & ~reset);
+  *pCnt = (uint16_t)(c & ~(mask | reset));
+  *pTmo = (uint16_t)((t + (t != SHAKE_COUNTER_MAX)) & ~reset);
+  *pFlag = flag & ~(mask | reset) & 1;
+
+  return mask;
 }
 
 /*!
- * @brief Initialize the shake detection
+ * @brief Initialize the shake detection with the default settings
  *
  * @param pParam Pointer to the shake parameter struct
+ * @param ui32PeriodMs Processing period in ms
  *
  * @return None
  */
-void shakeInit(motion_shake_param_t *pParam)
+void shakeInit(motion_shake_param_t *pParam, uint32_t ui32PeriodMs)
 {
 
-  int32_t i, j;
+  int32_t i;
+  int32_t dur = MOTION_ALG_MS_TO_COUNT(DEFAULT_SHAKE_DURATION_MS, (int32_t)ui32PeriodMs);
 
   pParam->shakeEvent = EVENT_SHAKE_NONE;
 
@@ -63,9 +151,9 @@ void shakeInit(motion_shake_param_t *pParam)
 
   //set duration to default values
   setShakeDuration(pParam,
-		   DEFAULT_SHAKE_DURATION,
-		   DEFAULT_SHAKE_DURATION,
-		   DEFAULT_SHAKE_DURATION,
+		   dur,
+		   dur,
+		   dur,
 		   X_AXIS | Y_AXIS | Z_AXIS);
 
   //set count to default values
@@ -75,21 +163,24 @@ void shakeInit(motion_shake_param_t *pParam)
 		DEFAULT_SHAKE_COUNT,
 		X_AXIS | Y_AXIS | Z_AXIS);
 
-  //set reset duration to default values
+  //set reset duration to default values, never
   setShakeTimeOutDuration(pParam,
-			  DEFAULT_SHAKE_RESET_COUNT_DURATION,
-			  DEFAULT_SHAKE_RESET_COUNT_DURATION,
-			  DEFAULT_SHAKE_RESET_COUNT_DURATION,
+			  DEFAULT_SHAKE_TIME_OUT_MS,
+			  DEFAULT_SHAKE_TIME_OUT_MS,
+			  DEFAULT_SHAKE_TIME_OUT_MS,
 			  X_AXIS | Y_AXIS | Z_AXIS);
 
   //Enable all axes
+  pParam->shakeEnable = 0;
   setShakeEnable(pParam, 1, 1, 1, X_AXIS | Y_AXIS | Z_AXIS);
 
   //Reset all states and flags
-  for(i = 0; i < 2; ++i)
-    for(j = 0; j < 3; ++j){
-      resetStates(pParam, i, j);
-    }
+  for(i = 0; i < SHAKE_FACES; ++i){
+    pParam->stateDuration[i] = 0;
+    pParam->stateCount[i] = 0;
+    pParam->stateTimeOutDuration[i] = 0;
+  }
+  pParam->flagToCount = 0;
 }
 
 /*!
@@ -115,7 +206,7 @@ void setShakeThreshold(motion_shake_param_t *pParam,
   float_xyzt_t thTmp = {thX, thY, thZ};
 
   for(i = 0; i < 3; ++i)
-    if(axesSel & allAxes[i]) pParam->shakeThresholdInG.v[i] = thTmp.v[i];
+    if(axesSel & allAxes[i]) pParam->shakeThreshold[i] = shakeKey(thTmp.v[i]);
 }
 
 /*!
@@ -142,7 +233,7 @@ void setShakeDuration(motion_shake_param_t *pParam,
   raw_data_xyzt_t valTmp = {durX, durY, durZ};
 
   for(i = 0; i < 3; ++i)
-    if(axesSel & allAxes[i]) pParam->shakeDuration.v[i] = valTmp.v[i];
+    if(axesSel & allAxes[i]) pParam->shakeDuration[i] = shakeClamp(valTmp.v[i]);
 
 }
 
@@ -170,7 +261,7 @@ void setShakeCount(motion_shake_param_t *pParam,
   raw_data_xyzt_t valTmp = {cntX, cntY, cntZ};
 
   for(i = 0; i < 3; ++i)
-    if(axesSel & allAxes[i]) pParam->shakeCount.v[i] = valTmp.v[i];
+    if(axesSel & allAxes[i]) pParam->shakeCount[i] = shakeClamp(valTmp.v[i]);
 
 }
 
@@ -198,7 +289,7 @@ void setShakeTimeOutDuration(motion_shake_param_t *pParam,
   raw_data_xyzt_t valTmp = {tmdX, tmdY, tmdZ};
 
   for(i = 0; i < 3; ++i)
-    if(axesSel & allAxes[i]) pParam->shakeTimeOutDuration.v[i] = valTmp.v[i];
+    if(axesSel & allAxes[i]) pParam->shakeTimeOutDuration[i] = shakeClamp(valTmp.v[i]);
 
 }
 
@@ -226,7 +317,12 @@ void setShakeEnable(motion_shake_param_t *pParam,
   raw_data_xyzt_t valTmp = {enableX, enableY, enableZ};
 
   for(i = 0; i < 3; ++i)
-    if(axesSel & allAxes[i]) pParam->shakeEnable.v[i] = (valTmp.v[i] == 0)? 0 : 1;
+    if(axesSel & allAxes[i]){
+      if(valTmp.v[i] == 0)
+	pParam->shakeEnable &= (uint8_t)~(1 << i);
+      else
+	pParam->shakeEnable |= (uint8_t)(1 << i);
+    }
 
 }
 
@@ -240,68 +336,42 @@ void setShakeEnable(motion_shake_param_t *pParam,
  */
 int32_t processShake(motion_shake_param_t *pParam, float_xyzt_t gVal)
 {
-  int32_t i, j;
-  static const shake_event_type allShakeEvents[][3] = {
-    {EVENT_SHAKE_X_POS, EVENT_SHAKE_Y_POS, EVENT_SHAKE_Z_POS},
-    {EVENT_SHAKE_X_NEG, EVENT_SHAKE_Y_NEG, EVENT_SHAKE_Z_NEG}
-  };
 
-  pParam->shakeEvent = EVENT_SHAKE_NONE;
+  int32_t i, axis, flag;
+  int32_t event = EVENT_SHAKE_NONE;
+  int32_t in[SHAKE_FACES];
+  uint32_t flags = pParam->flagToCount;
 
+  //Positive face against the threshold, the negative one mirrored
   for(i = 0; i < 3; ++i){
+    in[2 * i] = shakeKey(gVal.v[i]);
+    in[2 * i + 1] = -in[2 * i];
+  }
 
-    //Check enable
-    if(pParam->shakeEnable.v[i] == 0) continue;
-
-    //Check against threshold
-    if(gVal.v[i] >= pParam->shakeThresholdInG.v[i]) //positive
-      pParam->stateDuration[0].v[i] += 1; //increase duration count
-    else
-      pParam->stateDuration[0].v[i] = 0; //reset duration count
-
-    if(gVal.v[i] <= -pParam->shakeThresholdInG.v[i]) //negative
-      pParam->stateDuration[1].v[i] += 1; //increase duratin count
-    else
-      pParam->stateDuration[1].v[i] = 0; //reset duration count
-    
-    for(j = 0; j < 2; ++j){
-
-      //Init the time out counter
-      if((pParam->stateDuration[j].v[i] == 1) && (pParam->stateCount[j].v[i] == 0))
-	pParam->stateTimeOutDuration[j].v[i] = 0;
-
-      //Reset the ToCount flag
-      if(pParam->stateDuration[j].v[i] == 1)
-	pParam->flagToCount[j].v[i] = 1;
-
-      //Check duration
-      if(pParam->stateDuration[j].v[i] >= pParam->shakeDuration.v[i] 
-	 && pParam->flagToCount[j].v[i] == 1){
-	
-	pParam->stateCount[j].v[i] += 1;
-	pParam->flagToCount[j].v[i] = 0;
-
-      }
-
-      //Check count for event
-      if(pParam->stateCount[j].v[i] >= pParam->shakeCount.v[i]
-	 && pParam->stateDuration[j].v[i] == 0){
-	
-	pParam->shakeEvent |= allShakeEvents[j][i];
-	//reset the states and flags
-	resetStates(pParam, j, i);
-      }
-
-      //Check time out
-      if(pParam->stateTimeOutDuration[j].v[i] >= pParam->shakeTimeOutDuration.v[i])
-	resetStates(pParam, j, i);
-      else
-	pParam->stateTimeOutDuration[j].v[i] += 1;
+  for(i = 0; i < SHAKE_FACES; ++i){
 
-    }
+    axis = i >> 1;
+
+    //Check enable
+    if(!(pParam->shakeEnable & (1 << axis))) continue;
+
+    flag = (flags >> i) & 1;
+    event |= shakeFaceStep(in[i], pParam->shakeThreshold[axis],
+			   pParam->shakeDuration[axis],
+			   pParam->shakeCount[axis],
+			   pParam->shakeTimeOutDuration[axis],
+			   &pParam->stateDuration[i],
+			   &pParam->stateCount[i],
+			   &pParam->stateTimeOutDuration[i],
+			   &flag) & (1 << i);
+
+    flags = (flags & ~(1u << i)) | ((uint32_t)flag << i);
   }
 
-  return pParam->shakeEvent;
+  pParam->flagToCount = (uint8_t)flags;
+  pParam->shakeEvent = (uint8_t)event;
+
+  return event;
 }
 
 /*!
@@ -318,4 +388,3 @@ int32_t getShakeEvent(motion_shake_param_t *pParam)
   return pParam->shakeEvent;
 
 }
-
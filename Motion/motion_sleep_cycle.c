@@ -26,10 +26,9 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  **************************************************************************/
-#include "motion_main_ctrl.h"
+#include "motion_period.h"
 #include "motion_sleep_cycle.h"
-#include "motion_shake.h"
-#include "iir_filter.h"
+#include "motion_mag_run.h"
 /*
  * The body movement rates are adapted from the article:
  * "Rate and distribution of body movements during sleep in humans, Johanna Wilde-Frenz and
@@ -47,117 +46,71 @@
 
 #define SLEEP_CYCLE_NONE_REPEAT_COUNT (5)
 #define SLEEP_CYCLE_CHECK_INTERVAL_SEC (60.f)
-#define SLEEP_CYCLE_INTERVAL_DURATION \
-  (SLEEP_CYCLE_CHECK_INTERVAL_SEC * MOTION_ALG_DATA_RATE_HZ)
-#define alpha_sleep (0.9f)
+#define SLEEP_CYCLE_CHECK_INTERVAL_MS  (60000)
 #define SLEEP_THRESHOLD_G (0.4)
-#define SLEEP_DURATION     (2)
+#define SLEEP_DURATION_MS  (80)
 #define SLEEP_COUNT        (1)
-#define SLEEP_TIME_OUT     (MAX_DURATION)
-
-//Sleep cycle state
-static motion_sleep_cycle_t sleepCycleState = MOTION_SLEEP_CYCLE_NONE;
-static int32_t i32SleepCycleIntervalCount = 0;
-static int32_t i32SleepMovementCount = 0;
-static int32_t i32SleepCycleNoneCount = 0;
-static motion_shake_param_t sleepShakeParam;
-
-//sleep cycle high pass filter
-static float histX_sleep[3];
-static float histY_sleep[3];
-static float coeffA_sleep[] = {alpha_sleep};
-static float coeffB_sleep[] = {alpha_sleep, -alpha_sleep};
-static  iir_filter_param_t iirSleep = {
-  .dof = 3,
-  .lenCoeffA = 1,
-  .lenCoeffB = 2,
-  .histX = histX_sleep,
-  .histY = histY_sleep,
-  .coeffA = coeffA_sleep,
-  .coeffB = coeffB_sleep
-};
+#define SLEEP_TIME_OUT     (MAG_RUN_COUNTER_MAX)  //never
 
 /*!
  * @brief Initialize the sleep cycle monitor
  *
- * @param None
+ * @param pParam Pointer to the sleep cycle parameter struct
+ * @param ui32PeriodMs Processing period in ms
  *
  * @return None
  */
-void sleepCycleInit(void){
+void sleepCycleInit(motion_sleep_cycle_param_t *pParam, uint32_t ui32PeriodMs){
 
-  sleepCycleState = MOTION_SLEEP_CYCLE_NONE;
-  i32SleepCycleIntervalCount = 0;
-  i32SleepMovementCount = 0;
-  i32SleepCycleNoneCount = 0;
-  iirFilterInit(&iirSleep);  //Initialize filter for sleep cycle monitor
+  pParam->sleepCycleState = MOTION_SLEEP_CYCLE_NONE;
+  pParam->i32SleepCycleIntervalCount = 0;
+  pParam->i32SleepMovementCount = 0;
+  pParam->i32SleepCycleNoneCount = 0;
+  pParam->i32SleepCycleIntervalDuration =
+    MOTION_ALG_MS_TO_COUNT(SLEEP_CYCLE_CHECK_INTERVAL_MS, (int32_t)ui32PeriodMs);
 
   //Movement definition
-  shakeInit(&sleepShakeParam);
-  setShakeThreshold(&sleepShakeParam,
-		    SLEEP_THRESHOLD_G * SLEEP_THRESHOLD_G,
-		    0,
-		    0,
-		    X_AXIS | Y_AXIS | Z_AXIS);
-  setShakeDuration(&sleepShakeParam,
-		   SLEEP_DURATION,
-		   0,
-		   0,
-		   X_AXIS | Y_AXIS | Z_AXIS);
-  setShakeCount(&sleepShakeParam,
-		SLEEP_COUNT,
-		0,
-		0,
-		X_AXIS | Y_AXIS | Z_AXIS);
-  setShakeTimeOutDuration(&sleepShakeParam,
-			  SLEEP_TIME_OUT,
-			  0,
-			  0,
-			  X_AXIS);
-  setShakeEnable(&sleepShakeParam, 1, 0, 0, X_AXIS | Y_AXIS | Z_AXIS);
+  magRunInit(&pParam->sleepMagRun,
+	     SLEEP_THRESHOLD_G * SLEEP_THRESHOLD_G,
+	     MOTION_ALG_MS_TO_COUNT(SLEEP_DURATION_MS, (int32_t)ui32PeriodMs),
+	     SLEEP_COUNT,
+	     SLEEP_TIME_OUT);
 
 }
 
 /*!
- * @brief Process the sleep cycle
+ * @brief Process the sleep cycle, at the period given to sleepCycleInit()
  *
- * @param[in] gVal accelerometer reading in g
+ * @param pParam Pointer to the sleep cycle parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
  *
  * @return Sleep cycle
  */
-motion_sleep_cycle_t processSleepCycle(float_xyzt_t gVal){
+motion_sleep_cycle_t processSleepCycle(motion_sleep_cycle_param_t *pParam, motion_features_t *pFeat){
 
-  float_xyzt_t fData_out;
-  int32_t i32Res, i;
+  int32_t i32Res;
   float fTmp;
-  motion_sleep_cycle_t sleepCycle = sleepCycleState;
+  motion_sleep_cycle_t sleepCycle = pParam->sleepCycleState;
 
-  //high-pass filter the data
-  filterData((float *)&gVal, (float *)&fData_out, &iirSleep);
-  //Calculate magnitude^2 in g and store in the X
-  fTmp = 0.f;
-  for(i = 0; i < 3; ++i)
-    fTmp += fData_out.v[i] * fData_out.v[i];
-  fData_out.v[0] = fTmp;
-  fData_out.v[1] = fData_out.v[2] = 0.f;
+  //magnitude^2 of the high-passed data in g
+  fTmp = getFeatureHpMag2(pFeat);
+  i32Res = processMagRun(&pParam->sleepMagRun, fTmp);
 
-  i32Res = processShake(&sleepShakeParam, fData_out);
-
-  if(i32Res != EVENT_SHAKE_NONE){
-    i32SleepMovementCount += 1;
+  if(i32Res != 0){
+    pParam->i32SleepMovementCount += 1;
   }
 
-  ++i32SleepCycleIntervalCount;
+  ++pParam->i32SleepCycleIntervalCount;
 
-  if(i32SleepCycleIntervalCount >= SLEEP_CYCLE_INTERVAL_DURATION){
+  if(pParam->i32SleepCycleIntervalCount >= pParam->i32SleepCycleIntervalDuration){
 
     if(fTmp < SLEEP_CYCLE_S3_LB)
-      i32SleepCycleNoneCount += 1;
+      pParam->i32SleepCycleNoneCount += 1;
     else
-      i32SleepCycleNoneCount = 0;
+      pParam->i32SleepCycleNoneCount = 0;
 
     //calculate the body movement rate
-    fTmp = ((float)i32SleepMovementCount) / SLEEP_CYCLE_CHECK_INTERVAL_SEC;
+    fTmp = ((float)pParam->i32SleepMovementCount) / SLEEP_CYCLE_CHECK_INTERVAL_SEC;
 
     if(fTmp >= SLEEP_CYCLE_WAKE_LB)
       sleepCycle = MOTION_SLEEP_CYCLE_WAKE;
@@ -169,15 +122,15 @@ motion_sleep_cycle_t processSleepCycle(float_xyzt_t gVal){
       sleepCycle = MOTION_SLEEP_CYCLE_S2;
     else if( fTmp < SLEEP_CYCLE_S3_UB && fTmp >= SLEEP_CYCLE_S3_LB)
       sleepCycle = MOTION_SLEEP_CYCLE_S3;
-    else if( i32SleepCycleNoneCount >= SLEEP_CYCLE_NONE_REPEAT_COUNT)
+    else if( pParam->i32SleepCycleNoneCount >= SLEEP_CYCLE_NONE_REPEAT_COUNT)
       sleepCycle = MOTION_SLEEP_CYCLE_NONE;
 
     //Update the state
-    sleepCycleState = sleepCycle;
+    pParam->sleepCycleState = sleepCycle;
 
     //reset the counter
-    i32SleepCycleIntervalCount = 0;
-    i32SleepMovementCount = 0;
+    pParam->i32SleepCycleIntervalCount = 0;
+    pParam->i32SleepMovementCount = 0;
 
   }
 
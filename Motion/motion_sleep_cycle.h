@@ -30,6 +30,10 @@
 #ifndef __MOTION_SLEEP_CYCLE_H__
 #define __MOTION_SLEEP_CYCLE_H__
 
+#include "type_support.h"
+#include "motion_mag_run.h"
+#include "motion_features.h"
+
 /*!
  * For NREM sleep cycles (S1, S2, and S3) description, see
  *  https://en.wikipedia.org/wiki/Non-rapid_eye_movement_sleep
@@ -46,22 +50,35 @@ typedef enum {
   MOTION_SLEEP_CYCLE_NONE
 } motion_sleep_cycle_t;
 
+typedef struct{
+
+  motion_sleep_cycle_t sleepCycleState;
+  int32_t i32SleepCycleIntervalCount;
+  int32_t i32SleepMovementCount;
+  int32_t i32SleepCycleNoneCount;
+  int32_t i32SleepCycleIntervalDuration;  //check interval, in processing periods
+  motion_mag_run_t sleepMagRun;
+
+} motion_sleep_cycle_param_t;
+
 /*!
  * @brief Initialize the sleep cycle monitor
  *
- * @param None
+ * @param pParam Pointer to the sleep cycle parameter struct
+ * @param ui32PeriodMs Processing period in ms
  *
  * @return None
  */
-void sleepCycleInit(void);
+void sleepCycleInit(motion_sleep_cycle_param_t *pParam, uint32_t ui32PeriodMs);
 
 /*!
- * @brief Process the sleep cycle monitor
+ * @brief Process the sleep cycle monitor, at the period given to sleepCycleInit()
  *
- * @param[in] gVal accelerometer reading in g
+ * @param pParam Pointer to the sleep cycle parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
  *
  * @return current sleep cycle
  */
-motion_sleep_cycle_t processSleepCycle(float_xyzt_t gVal);
+motion_sleep_cycle_t processSleepCycle(motion_sleep_cycle_param_t *pParam, motion_features_t *pFeat);
 
 #endif //__MOTION_SLEEP_CYCLE_H__
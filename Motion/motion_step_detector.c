@@ -0,0 +1,415 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_step_detector.c
+ *
+ * Usage: Fixed-point step detector, PEDO_* interface
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdint.h>
+#include "motion_step_detector.h"
+
+#define MS_TO_SAMPLES(ms)     (((ms) + PEDO_SAMPLE_PERIOD_MS / 2) / PEDO_SAMPLE_PERIOD_MS)
+#define MG_TO_CODES(mg)       ((mg) * PEDO_CODES_PER_G / 1000)
+
+#define INPUT_MAX             (8191)  //input clamp, keeps the covariance in 32 bits
+#define COV_SHIFT             (5)     //covariance time constant, 2^5 samples
+#define WEIGHT_SHIFT          (14)    //projection weight of the main axis, 1 << 14
+#define WEIGHT_UPDATE         (8)     //samples between projection updates
+#define AVG_SHIFT             (2)     //step amplitude and interval averages
+#define INTERVAL_FRAC         (4)     //fraction bits of the interval average
+
+#define STEP_INTERVAL_MIN     MS_TO_SAMPLES(250)   //240 steps/min
+#define STEP_INTERVAL_MAX     MS_TO_SAMPLES(2000)  //30 steps/min
+#define STATIONARY_SAMPLES    MS_TO_SAMPLES(2500)  //no step for this long
+#define STEP_P2P_MIN          MG_TO_CODES(120)     //smallest step, peak to valley
+#define RUN_INTERVAL          MS_TO_SAMPLES(400)   //150 steps/min and faster
+#define RUN_INTERVAL_SLOW     MS_TO_SAMPLES(480)   //125 steps/min and faster...
+#define RUN_P2P               MG_TO_CODES(1500)    //...with strong steps
+
+typedef struct{
+
+  //main direction of motion
+  int32_t cov[6];           //covariance xx, yy, zz, xy, xz, yz
+  int32_t weight[3];        //projection on the main direction
+  uint8_t ui8MainAxis;
+  uint8_t ui8WeightCount;
+
+  //peak detection on the projection, smoothed by [1 2 1] / 4
+  int32_t proj[2];          //last 2 projections
+  int8_t isRising;
+  int32_t i32Peak, i32Valley, i32LastValley;
+  uint32_t ui32PeakTime;
+
+  //steps
+  uint32_t ui32Time;        //sample counter
+  uint32_t ui32LastStepTime;
+  uint32_t ui32LastInterval;
+  uint32_t ui32IntervalAvg; //in samples, INTERVAL_FRAC fraction bits
+  int32_t i32P2PAvg;        //step peak to valley average, 0 if none
+  uint8_t ui8Run;           //regular steps in a row, while searching
+  uint8_t isCounting;       //steps counted as they come
+  uint8_t ui8Activity;
+  uint32_t ui32StepCount;
+  uint32_t stepTimes[PEDO_STEP_AGES_MAX];  //last steps, ring
+  uint8_t ui8StepHead;                    //next entry of stepTimes
+  uint8_t ui8NewSteps;                    //counted on the last sample
+
+} step_detector_t;
+
+static step_detector_t detector;
+
+/*!
+ * @brief Clear the detection states, the step count is kept
+ *
+ * @param pDet Pointer to the detector
+ *
+ * @return None
+ */
+static void detector_clear(step_detector_t *pDet)
+{
+
+  int32_t i;
+
+  for(i = 0; i < 6; ++i)
+    pDet->cov[i] = 0;
+
+  pDet->ui8MainAxis = 2;
+  pDet->ui8WeightCount = 0;
+  pDet->weight[0] = pDet->weight[1] = 0;
+  pDet->weight[2] = 1 << WEIGHT_SHIFT;
+
+  pDet->proj[0] = pDet->proj[1] = 0;
+  pDet->isRising = 1;
+  pDet->i32Peak = pDet->i32Valley = pDet->i32LastValley = 0;
+  pDet->ui32PeakTime = 0;
+
+  pDet->ui32Time = 0;
+  pDet->ui32LastStepTime = 0;
+  pDet->ui32LastInterval = 0;
+  pDet->ui32IntervalAvg = 0;
+  pDet->i32P2PAvg = 0;
+  pDet->ui8Run = 0;
+  pDet->isCounting = 0;
+  pDet->ui8Activity = PEDO_ACTIVITY_STATIONARY;
+  pDet->ui8StepHead = 0;
+  pDet->ui8NewSteps = 0;
+}
+
+/*!
+ * @brief Update the projection weights from the covariance
+ *        The main axis is the axis of largest variance, with hysteresis,
+ *        the weight of each axis its covariance with the main axis over
+ *        the main axis variance, one power iteration from the main axis.
+ *
+ * @param pDet Pointer to the detector
+ *
+ * @return None
+ */
+static void detector_update_weight(step_detector_t *pDet)
+{
+
+  static const uint8_t covIndex[3][3] = {{0, 3, 4}, {3, 1, 5}, {4, 5, 2}};
+  uint32_t d = pDet->ui8MainAxis, i, sh = 0;
+  int32_t cdd, w[3], dot;
+
+  for(i = 0; i < 3; ++i)
+    if(pDet->cov[i] > pDet->cov[d] + (pDet->cov[d] >> 2))
+      d = i;
+  pDet->ui8MainAxis = (uint8_t)d;
+
+  cdd = pDet->cov[d];
+  if(cdd <= 0)
+    return;
+
+  //keep (cov << WEIGHT_SHIFT) in 32 bits
+  while((cdd >> sh) >= (1 << 16))
+    ++sh;
+
+  for(i = 0; i < 3; ++i)
+    w[i] = (pDet->cov[covIndex[i][d]] >> sh) * (1 << WEIGHT_SHIFT) / (cdd >> sh);
+
+  //keep the sign of the projection when the main axis changes
+  dot = 0;
+  for(i = 0; i < 3; ++i)
+    dot += (w[i] >> 2) * (pDet->weight[i] >> 2);
+
+  for(i = 0; i < 3; ++i)
+    pDet->weight[i] = (dot < 0) ? -w[i] : w[i];
+}
+
+/*!
+ * @brief Process a confirmed peak
+ *
+ * @param pDet Pointer to the detector
+ * @param i32P2P Peak to valley
+ * @param ui32Time Time of the peak
+ *
+ * @return Number of steps counted
+ */
+static uint32_t detector_peak(step_detector_t *pDet, int32_t i32P2P, uint32_t ui32Time)
+{
+
+  uint32_t ui32Interval = ui32Time - pDet->ui32LastStepTime;
+  uint32_t ui32Steps = 0, ui32Prev = pDet->ui32LastInterval;
+  int32_t i32Threshold = (pDet->i32P2PAvg * 3) >> 3;
+
+  if(i32Threshold < STEP_P2P_MIN)
+    i32Threshold = STEP_P2P_MIN;
+
+  if(i32P2P < i32Threshold)
+    return 0;
+
+  //Second peak of the same step
+  if(pDet->ui8Run > 0 && ui32Interval < STEP_INTERVAL_MIN)
+    return 0;
+
+  if(pDet->ui8Run == 0 || ui32Interval > STEP_INTERVAL_MAX){
+
+    //first step of a run
+    pDet->ui8Run = 1;
+    pDet->isCounting = 0;
+    ui32Interval = 0;
+  }
+  else if(pDet->isCounting){
+
+    ui32Steps = 1;
+  }
+  else if(ui32Prev == 0 || (3 * ui32Interval >= 2 * ui32Prev && 2 * ui32Interval <= 3 * ui32Prev)){
+
+    //regular step, count the run once long enough
+    if(++pDet->ui8Run >= PEDO_INTER_STEP_COUNT){
+      pDet->isCounting = 1;
+      ui32Steps = pDet->ui8Run;
+    }
+  }
+  else{
+
+    //irregular, start over from the previous step
+    pDet->ui8Run = 2;
+  }
+
+  pDet->ui32LastStepTime = ui32Time;
+  pDet->ui32LastInterval = ui32Interval;
+  pDet->stepTimes[pDet->ui8StepHead] = ui32Time;
+  pDet->ui8StepHead = (pDet->ui8StepHead + 1) % PEDO_STEP_AGES_MAX;
+
+  //amplitude and cadence averages
+  if(pDet->i32P2PAvg == 0)
+    pDet->i32P2PAvg = i32P2P;
+  else
+    pDet->i32P2PAvg += (i32P2P - pDet->i32P2PAvg) >> AVG_SHIFT;
+
+  if(ui32Interval > 0){
+    if(pDet->ui32IntervalAvg == 0)
+      pDet->ui32IntervalAvg = ui32Interval << INTERVAL_FRAC;
+    else
+      pDet->ui32IntervalAvg = pDet->ui32IntervalAvg -
+	(pDet->ui32IntervalAvg >> AVG_SHIFT) + ((ui32Interval << INTERVAL_FRAC) >> AVG_SHIFT);
+  }
+
+  if(pDet->isCounting){
+
+    if(pDet->ui32IntervalAvg <= (RUN_INTERVAL << INTERVAL_FRAC) ||
+       (pDet->ui32IntervalAvg <= (RUN_INTERVAL_SLOW << INTERVAL_FRAC) && pDet->i32P2PAvg >= RUN_P2P))
+      pDet->ui8Activity = PEDO_ACTIVITY_RUN;
+    else
+      pDet->ui8Activity = PEDO_ACTIVITY_WALK;
+  }
+
+  return ui32Steps;
+}
+
+/*!
+ * @brief Initialize the step detector, the step count starts from 0
+ *
+ * @param ucSens Sensitivity selection of libpedo.a, only
+ *        PEDO_CODES_PER_G is supported, the value is ignored
+ *
+ * @return None
+ */
+void PEDO_InitAlgo(unsigned char ucSens)
+{
+
+  (void)ucSens;
+
+  detector_clear(&detector);
+  detector.ui32StepCount = 0;
+}
+
+/*!
+ * @brief Process one sample
+ *
+ * @param x X in codes of PEDO_CODES_PER_G, high-pass filtered
+ * @param y Y
+ * @param z Z
+ *
+ * @return Number of steps counted on this sample
+ */
+short PEDO_ProcessAccelarationData(short x, short y, short z)
+{
+
+  step_detector_t *pDet = &detector;
+  int32_t a[3] = {x, y, z};
+  int32_t i32Proj, i32Val, i32Threshold;
+  uint32_t i, ui32Steps = 0;
+
+  ++pDet->ui32Time;
+
+  for(i = 0; i < 3; ++i){
+    if(a[i] > INPUT_MAX) a[i] = INPUT_MAX;
+    else if(a[i] < -INPUT_MAX) a[i] = -INPUT_MAX;
+  }
+
+  //covariance, the input is zero mean
+  pDet->cov[0] += (a[0] * a[0] - pDet->cov[0]) >> COV_SHIFT;
+  pDet->cov[1] += (a[1] * a[1] - pDet->cov[1]) >> COV_SHIFT;
+  pDet->cov[2] += (a[2] * a[2] - pDet->cov[2]) >> COV_SHIFT;
+  pDet->cov[3] += (a[0] * a[1] - pDet->cov[3]) >> COV_SHIFT;
+  pDet->cov[4] += (a[0] * a[2] - pDet->cov[4]) >> COV_SHIFT;
+  pDet->cov[5] += (a[1] * a[2] - pDet->cov[5]) >> COV_SHIFT;
+
+  if(++pDet->ui8WeightCount >= WEIGHT_UPDATE){
+    pDet->ui8WeightCount = 0;
+    detector_update_weight(pDet);
+  }
+
+  i32Proj = (pDet->weight[0] * a[0] + pDet->weight[1] * a[1] + pDet->weight[2] * a[2]) >> WEIGHT_SHIFT;
+  i32Val = (pDet->proj[1] + 2 * pDet->proj[0] + i32Proj) >> 2;
+  pDet->proj[1] = pDet->proj[0];
+  pDet->proj[0] = i32Proj;
+
+  //Peaks and valleys, confirmed when the signal turns by half the threshold
+  i32Threshold = (pDet->i32P2PAvg * 3) >> 3;
+  if(i32Threshold < STEP_P2P_MIN)
+    i32Threshold = STEP_P2P_MIN;
+
+  if(pDet->isRising){
+
+    if(i32Val > pDet->i32Peak){
+      pDet->i32Peak = i32Val;
+      pDet->ui32PeakTime = pDet->ui32Time;
+    }
+    else if(i32Val < pDet->i32Peak - (i32Threshold >> 1)){
+      ui32Steps = detector_peak(pDet, pDet->i32Peak - pDet->i32LastValley, pDet->ui32PeakTime);
+      pDet->isRising = 0;
+      pDet->i32Valley = i32Val;
+    }
+  }
+  else{
+
+    if(i32Val < pDet->i32Valley)
+      pDet->i32Valley = i32Val;
+    else if(i32Val > pDet->i32Valley + (i32Threshold >> 1)){
+      pDet->i32LastValley = pDet->i32Valley;
+      pDet->isRising = 1;
+      pDet->i32Peak = i32Val;
+      pDet->ui32PeakTime = pDet->ui32Time;
+    }
+  }
+
+  //End of a run
+  if(pDet->ui8Run > 0 && pDet->ui32Time - pDet->ui32LastStepTime > STEP_INTERVAL_MAX){
+    pDet->ui8Run = 0;
+    pDet->isCounting = 0;
+    pDet->i32P2PAvg = 0;
+    pDet->ui32IntervalAvg = 0;
+    pDet->ui32LastInterval = 0;
+  }
+
+  if(pDet->ui32Time - pDet->ui32LastStepTime > STATIONARY_SAMPLES)
+    pDet->ui8Activity = PEDO_ACTIVITY_STATIONARY;
+
+  pDet->ui32StepCount += ui32Steps;
+  pDet->ui8NewSteps = (uint8_t)ui32Steps;
+
+  return (short)ui32Steps;
+}
+
+/*!
+ * @brief Get the step count
+ *
+ * @param None
+ *
+ * @return Steps since the initialization or the last reset
+ */
+unsigned long PEDO_GetStepCount(void)
+{
+
+  return detector.ui32StepCount;
+}
+
+/*!
+ * @brief Get the activity
+ *
+ * @param None
+ *
+ * @return PEDO_ACTIVITY_STATIONARY, PEDO_ACTIVITY_WALK or PEDO_ACTIVITY_RUN
+ */
+unsigned char PEDO_GetActivity(void)
+{
+
+  return detector.ui8Activity;
+}
+
+/*!
+ * @brief Get when the steps counted on the last sample happened
+ *        Not in libpedo.a
+ *
+ * @param pAges Age of each step in samples before the last sample, oldest first
+ * @param ucMax Size of pAges, PEDO_STEP_AGES_MAX for all the steps
+ *
+ * @return Number of ages written
+ */
+unsigned char PEDO_GetStepAges(unsigned short *pAges, unsigned char ucMax)
+{
+
+  uint32_t i, n = detector.ui8NewSteps, ui32Age;
+
+  //the new steps are the last ones of the ring, keep the newest
+  if(n > ucMax)
+    n = ucMax;
+
+  for(i = 0; i < n; ++i){
+    ui32Age = detector.ui32Time -
+      detector.stepTimes[(detector.ui8StepHead + PEDO_STEP_AGES_MAX - n + i) % PEDO_STEP_AGES_MAX];
+    pAges[i] = (ui32Age > 0xFFFF) ? 0xFFFF : (unsigned short)ui32Age;
+  }
+
+  return (unsigned char)n;
+}
+
+/*!
+ * @brief Reset the step count and the detection
+ *
+ * @param None
+ *
+ * @return None
+ */
+void PEDO_ResetAlgo(void)
+{
+
+  detector_clear(&detector);
+  detector.ui32StepCount = 0;
+}
@@ -0,0 +1,120 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_step_detector.h
+ *
+ * Usage: Fixed-point step detector, PEDO_* interface
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file motion_step_detector.h
+ *  @brief Step detector with the PEDO_* entry points of libpedo.a,
+ *         integer only, for the Cortex-M0 and the host
+ *
+ *  Input: high-pass filtered acceleration in codes of PEDO_CODES_PER_G,
+ *  one sample every PEDO_SAMPLE_PERIOD_MS.
+ *
+ *  - The signal is the acceleration projected on the main direction of
+ *    motion, estimated from a running covariance of the 3 axes.
+ *  - A step is a peak of the smoothed signal, with a peak to valley
+ *    above an adaptive threshold and within the step interval limits.
+ *  - Steps are counted after PEDO_INTER_STEP_COUNT regular steps in a
+ *    row, then added at once, so isolated gestures are not counted.
+ *  - The activity is from the cadence and the step amplitude.
+ *
+ *  Like libpedo.a, the detector keeps a single global state.
+ */
+
+#ifndef __MOTION_STEP_DETECTOR_H__
+#define __MOTION_STEP_DETECTOR_H__
+
+#define PEDO_CODES_PER_G        (512)  //input sensitivity
+#define PEDO_SAMPLE_PERIOD_MS   (40)   //input rate, 25Hz
+#define PEDO_INTER_STEP_COUNT   (4)    //regular steps in a row before counting
+#define PEDO_STEP_AGES_MAX      PEDO_INTER_STEP_COUNT  //steps counted at once, at most
+
+//PEDO_GetActivity() values
+#define PEDO_ACTIVITY_STATIONARY  (0)
+#define PEDO_ACTIVITY_WALK        (1)
+#define PEDO_ACTIVITY_RUN         (3)
+
+/*!
+ * @brief Initialize the step detector, the step count starts from 0
+ *
+ * @param ucSens Sensitivity selection of libpedo.a, only
+ *        PEDO_CODES_PER_G is supported, the value is ignored
+ *
+ * @return None
+ */
+void PEDO_InitAlgo(unsigned char ucSens);
+
+/*!
+ * @brief Process one sample
+ *
+ * @param x X in codes of PEDO_CODES_PER_G, high-pass filtered
+ * @param y Y
+ * @param z Z
+ *
+ * @return Number of steps counted on this sample
+ */
+short PEDO_ProcessAccelarationData(short x, short y, short z);
+
+/*!
+ * @brief Get the step count
+ *
+ * @param None
+ *
+ * @return Steps since the initialization or the last reset
+ */
+unsigned long PEDO_GetStepCount(void);
+
+/*!
+ * @brief Get the activity
+ *
+ * @param None
+ *
+ * @return PEDO_ACTIVITY_STATIONARY, PEDO_ACTIVITY_WALK or PEDO_ACTIVITY_RUN
+ */
+unsigned char PEDO_GetActivity(void);
+
+/*!
+ * @brief Get when the steps counted on the last sample happened
+ *        Not in libpedo.a
+ *
+ * @param pAges Age of each step in samples before the last sample, oldest first
+ * @param ucMax Size of pAges, PEDO_STEP_AGES_MAX for all the steps
+ *
+ * @return Number of ages written
+ */
+unsigned char PEDO_GetStepAges(unsigned short *pAges, unsigned char ucMax);
+
+/*!
+ * @brief Reset the step count and the detection
+ *
+ * @param None
+ *
+ * @return None
+ */
+void PEDO_ResetAlgo(void);
+
+#endif //__MOTION_STEP_DETECTOR_H__
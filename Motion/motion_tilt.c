@@ -0,0 +1,241 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_tilt.c
+ *
+ * Usage: Pitch, roll and tilt angles
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "motion_tilt.h"
+
+//Sample to integers with the largest component in [2^27, 2^28)
+#define TILT_NORM_SHIFT        (4)    //float mantissa, 24 bits, to 28 bits
+
+//1 / CORDIC gain of TILT_CORDIC_ITERATIONS iterations, Q16
+#define TILT_CORDIC_INV_GAIN   (39797)
+
+//atan(2^-i) in degrees, Q16
+static const int32_t tiltAtanTable[TILT_CORDIC_ITERATIONS] = {
+  2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335,
+  14668, 7334, 3667, 1833, 917, 458, 229, 115
+};
+
+#define TILT_DEG_180           (180 << 16)
+
+/*!
+ * @brief atan2 by CORDIC vectoring
+ *        Inputs below 2^28, so the magnitude times the gain fits in 31 bits
+ *
+ * @param y Y
+ * @param x X
+ * @param[out] pMag Magnitude times the CORDIC gain
+ *
+ * @return atan2(y, x) in degrees Q16, (-180, 180]
+ */
+static int32_t tiltAtan2(int32_t y, int32_t x, int32_t *pMag)
+{
+
+  int32_t i, s, xNew, angle = 0;
+
+  //Rotate by 180 degrees into the right half plane, where it converges
+  if(x < 0){
+    angle = (y >= 0) ? TILT_DEG_180 : -TILT_DEG_180;
+    x = -x;
+    y = -y;
+  }
+
+  //Rotate towards y = 0: clockwise if y > 0, else counter clockwise.
+  //s is all ones for counter clockwise, (v ^ s) - s is then -v
+  for(i = 0; i < TILT_CORDIC_ITERATIONS; ++i){
+
+    s = -(int32_t)(y <= 0);
+    xNew = x + (((y >> i) ^ s) - s);
+    y -= ((x >> i) ^ s) - s;
+    angle += (tiltAtanTable[i] ^ s) - s;
+    x = xNew;
+  }
+
+  //(-180, 180]
+  if(angle <= -TILT_DEG_180)
+    angle += 2 * TILT_DEG_180;
+
+  *pMag = x;
+
+  return angle;
+}
+
+/*!
+ * @brief Remove the CORDIC gain of a magnitude
+ *
+ * @param mag Magnitude times the gain, >= 0
+ *
+ * @return Magnitude
+ */
+static inline int32_t tiltRemoveGain(int32_t mag)
+{
+
+  uint32_t m = (uint32_t)mag;
+
+  return (int32_t)((m >> 16) * TILT_CORDIC_INV_GAIN + (((m & 0xFFFF) * TILT_CORDIC_INV_GAIN) >> 16));
+}
+
+/*!
+ * @brief Degrees Q16 to 1/TILT_ANGLE_SCALE degree, rounded
+ *
+ * @param angle Angle in degrees Q16, within +/-180
+ *
+ * @return Angle in 1/TILT_ANGLE_SCALE degree
+ */
+static inline int16_t tiltToScale(int32_t angle)
+{
+
+  return (int16_t)((angle * TILT_ANGLE_SCALE + (1 << 15)) >> 16);
+}
+
+/*!
+ * @brief Sample to integers of the same direction, the largest component
+ *        in [2^27, 2^28), from the float bits, without float arithmetic
+ *
+ * @param[in] pgVal Sample
+ * @param[out] v X, Y, Z
+ *
+ * @return 1 for success, 0 for a zero vector
+ */
+static int8_t tiltToInt(const float_xyzt_t *pgVal, int32_t v[3])
+{
+
+  union{
+    float f;
+    uint32_t u;
+  } bits;
+  int32_t i, shift, exponent[3], maxExponent = 0;
+  uint32_t mantissa[3], sign[3], isZero = 1;
+
+  for(i = 0; i < 3; ++i){
+
+    bits.f = pgVal->v[i];
+    sign[i] = bits.u >> 31;
+    exponent[i] = (bits.u >> 23) & 0xFF;
+    mantissa[i] = bits.u & 0x7FFFFF;
+    isZero &= (exponent[i] == 0 && mantissa[i] == 0);
+
+    //implicit leading one, denormals have the exponent of 1
+    if(exponent[i] != 0)
+      mantissa[i] |= 0x800000;
+    else
+      exponent[i] = 1;
+
+    if(exponent[i] > maxExponent)
+      maxExponent = exponent[i];
+  }
+
+  if(isZero)
+    return 0;
+
+  //align to the largest exponent
+  for(i = 0; i < 3; ++i){
+
+    shift = maxExponent - exponent[i];
+    v[i] = (shift < 24) ? (int32_t)((mantissa[i] >> shift) << TILT_NORM_SHIFT) : 0;
+    if(sign[i])
+      v[i] = -v[i];
+  }
+
+  //denormals only, bring the largest up to 2^27
+  while(((v[0] < 0 ? -v[0] : v[0]) | (v[1] < 0 ? -v[1] : v[1]) | (v[2] < 0 ? -v[2] : v[2]))
+	< (1 << 27))
+    for(i = 0; i < 3; ++i)
+      v[i] *= 2;
+
+  return 1;
+}
+
+/*!
+ * @brief Initialize the tilt angles
+ *
+ * @param pParam Pointer to the tilt parameter struct
+ *
+ * @return None
+ */
+void tiltInit(motion_tilt_param_t *pParam)
+{
+
+  pParam->tilt.i16Pitch = pParam->tilt.i16Roll = pParam->tilt.i16Tilt = 0;
+  pParam->isValid = 0;
+}
+
+/*!
+ * @brief Process the tilt angles
+ *        Only the direction of the sample is used, a zero vector keeps
+ *        the angles. Infinite and NaN samples are out of range.
+ *
+ * @param pParam Pointer to the tilt parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
+ *
+ * @return 1 if the angles are updated, 0 otherwise
+ */
+int8_t processTilt(motion_tilt_param_t *pParam, motion_features_t *pFeat)
+{
+
+  int32_t v[3], x, y, z;
+  int32_t angle, magYz, magXy;
+
+  //No direction
+  if(!tiltToInt(pFeat->pgVal, v))
+    return 0;
+
+  x = v[0];
+  y = v[1];
+  z = v[2];
+
+  angle = tiltAtan2(y, z, &magYz);
+  pParam->tilt.i16Roll = tiltToScale(angle);
+
+  angle = tiltAtan2(x, tiltRemoveGain(magYz), &magYz);
+  pParam->tilt.i16Pitch = tiltToScale(angle);
+
+  tiltAtan2(y, x, &magXy);
+  angle = tiltAtan2(tiltRemoveGain(magXy), z, &magXy);
+  pParam->tilt.i16Tilt = tiltToScale(angle);
+
+  pParam->isValid = 1;
+
+  return 1;
+}
+
+/*!
+ * @brief Get the tilt angles
+ *
+ * @param pParam Pointer to the tilt parameter struct
+ * @param[out] pTilt Pointer to store the angles, in 1/TILT_ANGLE_SCALE degree
+ *
+ * @return 1 if the angles are valid, 0 if none was computed yet
+ */
+int8_t getTilt(motion_tilt_param_t *pParam, motion_tilt_t *pTilt)
+{
+
+  *pTilt = pParam->tilt;
+
+  return pParam->isValid;
+}
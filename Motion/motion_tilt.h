@@ -0,0 +1,103 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_tilt.h
+ *
+ * Usage: Pitch, roll and tilt angles
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file motion_tilt.h
+ *  @brief Pitch, roll and tilt angles of the gravity, in integer
+ *         arithmetic with CORDIC, for display rotation and posture.
+ *
+ *  For x, y, z the sample in g, positive along the axis pointing up:
+ *    pitch = atan2(x, sqrt(y^2 + z^2)), the X axis above the horizontal
+ *    roll  = atan2(y, z), rotation about the X axis, Y up is positive
+ *    tilt  = atan2(sqrt(x^2 + y^2), z), the Z axis away from the vertical
+ *  The roll has no meaning near a pitch of +/-90 degrees.
+ *
+ *  Cost on the Cortex-M0, estimated and not measured: a CORDIC run is
+ *  about 430 cycles, 23 to 25 per iteration in the code llc generates
+ *  for -mcpu=cortex-m0, and a call of processTilt() with its four runs
+ *  about 1900 cycles, 10% more with the 32 cycle multiplier. No number
+ *  against soft-float atan2f was taken, Replay/tilt_bench measures both.
+ */
+
+#ifndef __MOTION_TILT_H__
+#define __MOTION_TILT_H__
+
+#include "type_support.h"
+#include "motion_features.h"
+
+//Angles in 1/TILT_ANGLE_SCALE degree
+#define TILT_ANGLE_SCALE       (100)
+#define TILT_CORDIC_ITERATIONS (16)
+
+typedef struct{
+
+  int16_t i16Pitch;   //[-90, 90] degrees
+  int16_t i16Roll;    //(-180, 180] degrees
+  int16_t i16Tilt;    //[0, 180] degrees
+
+} motion_tilt_t;
+
+typedef struct{
+
+  motion_tilt_t tilt;
+  int8_t isValid;     //angles computed at least once
+
+} motion_tilt_param_t;
+
+/*!
+ * @brief Initialize the tilt angles
+ *
+ * @param pParam Pointer to the tilt parameter struct
+ *
+ * @return None
+ */
+void tiltInit(motion_tilt_param_t *pParam);
+
+/*!
+ * @brief Process the tilt angles
+ *        Only the direction of the sample is used, a zero vector keeps
+ *        the angles. Infinite and NaN samples are out of range.
+ *
+ * @param pParam Pointer to the tilt parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
+ *
+ * @return 1 if the angles are updated, 0 otherwise
+ */
+int8_t processTilt(motion_tilt_param_t *pParam, motion_features_t *pFeat);
+
+/*!
+ * @brief Get the tilt angles
+ *
+ * @param pParam Pointer to the tilt parameter struct
+ * @param[out] pTilt Pointer to store the angles, in 1/TILT_ANGLE_SCALE degree
+ *
+ * @return 1 if the angles are valid, 0 if none was computed yet
+ */
+int8_t getTilt(motion_tilt_param_t *pParam, motion_tilt_t *pTilt);
+
+#endif //__MOTION_TILT_H__
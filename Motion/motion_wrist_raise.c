@@ -0,0 +1,241 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_wrist_raise.c
+ *
+ * Usage: predictive wrist raise detection
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "motion_wrist_raise.h"
+
+//Cosine threshold in 1/WRIST_RAISE_COS_SCALE
+#define WRIST_RAISE_TO_COS(c)  ((int32_t)((c) * WRIST_RAISE_COS_SCALE + 0.5f))
+
+//|g| range in codes, a component above the max is out of range
+#define WRIST_RAISE_TO_CODE(g) ((int32_t)((g) * WRIST_RAISE_CODES_PER_G))
+#define WRIST_RAISE_TO_CODE2(g) (WRIST_RAISE_TO_CODE(g) * WRIST_RAISE_TO_CODE(g))
+
+_Static_assert((WRIST_RAISE_WINDOW_MAX & (WRIST_RAISE_WINDOW_MAX - 1)) == 0,
+	       "WRIST_RAISE_WINDOW_MAX must be a power of 2");
+
+/*!
+ * @brief Round a value in g to WRIST_RAISE_CODES_PER_G codes
+ *
+ * @param g Value in g
+ *
+ * @return Code
+ */
+static inline int32_t wristRaiseToCode(float g)
+{
+
+  float f = g * WRIST_RAISE_CODES_PER_G;
+
+  return (int32_t)(f >= 0.f ? f + 0.5f : f - 0.5f);
+}
+
+/*!
+ * @brief Cosine of a component, floor(v / |g|) in 1/WRIST_RAISE_COS_SCALE,
+ *        the largest j with j * |j| * |g|^2 <= v * |v| * WRIST_RAISE_COS_SCALE^2
+ *        With |g| up to WRIST_RAISE_MAG_MAX_G both sides fit in 31 bits
+ *
+ * @param v Component in codes
+ * @param m2 |g|^2 in codes^2
+ *
+ * @return Cosine in [-WRIST_RAISE_COS_SCALE, WRIST_RAISE_COS_SCALE]
+ */
+static int32_t wristRaiseCos(int32_t v, int32_t m2)
+{
+
+  int32_t s = v * (v < 0 ? -v : v) * (WRIST_RAISE_COS_SCALE * WRIST_RAISE_COS_SCALE);
+  int32_t lo = -WRIST_RAISE_COS_SCALE, hi = WRIST_RAISE_COS_SCALE, j;
+
+  //binary search, j * |j| increases with j
+  while(lo < hi){
+
+    j = (lo + hi + 1) >> 1;
+    if(j * (j < 0 ? -j : j) * m2 <= s)
+      lo = j;
+    else
+      hi = j - 1;
+  }
+
+  return lo;
+}
+
+/*!
+ * @brief A time in samples, rounded, in [1, 255]
+ *
+ * @param ui32Ms Time in ms
+ * @param ui32PeriodMs Period of the samples in ms
+ *
+ * @return Samples
+ */
+static uint32_t wristRaiseSamples(uint32_t ui32Ms, uint32_t ui32PeriodMs)
+{
+
+  uint32_t n = (ui32Ms + ui32PeriodMs / 2) / ui32PeriodMs;
+
+  if(n < 1)
+    n = 1;
+  else if(n > 255)
+    n = 255;
+
+  return n;
+}
+
+/*!
+ * @brief Initialize the wrist raise prediction
+ *
+ * @param pParam Pointer to the wrist raise parameter struct
+ * @param ui32PeriodMs Period of the samples in ms
+ *
+ * @return None
+ */
+void wristRaiseInit(motion_wrist_raise_param_t *pParam, uint32_t ui32PeriodMs)
+{
+
+  uint32_t i;
+  uint32_t window = (WRIST_RAISE_WINDOW_MS + ui32PeriodMs / 2) / ui32PeriodMs;
+
+  //the history holds the window and the current sample
+  if(window < 1)
+    window = 1;
+  else if(window > WRIST_RAISE_WINDOW_MAX - 1)
+    window = WRIST_RAISE_WINDOW_MAX - 1;
+
+  for(i = 0; i < WRIST_RAISE_WINDOW_MAX; ++i)
+    pParam->i8Cos[i] = pParam->i8CosX[i] = 0;
+
+  pParam->ui8Window = (uint8_t)window;
+  pParam->ui8StillLen = (uint8_t)wristRaiseSamples(WRIST_RAISE_STILL_MS, ui32PeriodMs);
+  pParam->ui8StillAgeMax = (uint8_t)wristRaiseSamples(WRIST_RAISE_STILL_AGE_MS, ui32PeriodMs);
+  pParam->ui8Still = 0;
+  pParam->ui8StillAge = 255;
+  pParam->ui8Head = 0;
+  pParam->ui8Steady = 0;
+  pParam->isRaising = 0;
+}
+
+/*!
+ * @brief Process the wrist raise prediction
+ *
+ * @param pParam Pointer to the wrist raise parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
+ *
+ * @return 1 if a raise is predicted on this sample, 0 otherwise
+ */
+int8_t processWristRaise(motion_wrist_raise_param_t *pParam, motion_features_t *pFeat)
+{
+
+  const float_xyzt_t *pgVal = pFeat->pgVal;
+  int32_t x = wristRaiseToCode(pgVal->u.x);
+  int32_t y = wristRaiseToCode(pgVal->u.y);
+  int32_t z = wristRaiseToCode(pgVal->u.z);
+  int32_t m2 = -1;
+  uint32_t i;
+  uint32_t window = pParam->ui8Window;
+  uint32_t head = pParam->ui8Head;
+  int32_t c, cX, cMin, cXMin, cXMax, v;
+
+  //no component above the max |g|, so |g|^2 fits in 32 bits
+  if((x < 0 ? -x : x) <= WRIST_RAISE_TO_CODE(WRIST_RAISE_MAG_MAX_G) &&
+     (y < 0 ? -y : y) <= WRIST_RAISE_TO_CODE(WRIST_RAISE_MAG_MAX_G) &&
+     (z < 0 ? -z : z) <= WRIST_RAISE_TO_CODE(WRIST_RAISE_MAG_MAX_G))
+    m2 = x * x + y * y + z * z;
+
+  //|g| out of range: not a rotation, the window starts over
+  if(m2 >= WRIST_RAISE_TO_CODE2(WRIST_RAISE_MAG_MIN_G) &&
+     m2 <= WRIST_RAISE_TO_CODE2(WRIST_RAISE_MAG_MAX_G)){
+
+    c = wristRaiseCos(z, m2);
+    cX = wristRaiseCos(x, m2);
+
+    if(pParam->ui8Steady <= window)
+      ++pParam->ui8Steady;
+  }
+  else{
+
+    c = cX = 0;
+    pParam->ui8Steady = 0;
+  }
+
+  //the hand still for ui8StillLen samples, then the age of it
+  if(m2 >= WRIST_RAISE_TO_CODE2(WRIST_RAISE_STILL_MIN_G) &&
+     m2 <= WRIST_RAISE_TO_CODE2(WRIST_RAISE_STILL_MAX_G)){
+    if(pParam->ui8Still < pParam->ui8StillLen)
+      ++pParam->ui8Still;
+  }
+  else
+    pParam->ui8Still = 0;
+
+  if(pParam->ui8Still >= pParam->ui8StillLen)
+    pParam->ui8StillAge = 0;
+  else if(pParam->ui8StillAge < 255)
+    ++pParam->ui8StillAge;
+
+  pParam->i8Cos[head] = (int8_t)c;
+  pParam->i8CosX[head] = (int8_t)cX;
+  pParam->isRaising = 0;
+
+  if(pParam->ui8Steady > window &&
+     pParam->ui8StillAge <= pParam->ui8StillAgeMax &&
+     c >= WRIST_RAISE_TO_COS(WRIST_RAISE_TILT_COS) &&
+     c > pParam->i8Cos[(head - 1) & (WRIST_RAISE_WINDOW_MAX - 1)]){
+
+    //lowest z / |g| and range of x / |g| over the window
+    cMin = c;
+    cXMin = cXMax = cX;
+    for(i = 1; i <= window; ++i){
+      v = pParam->i8Cos[(head - i) & (WRIST_RAISE_WINDOW_MAX - 1)];
+      if(v < cMin)
+	cMin = v;
+      v = pParam->i8CosX[(head - i) & (WRIST_RAISE_WINDOW_MAX - 1)];
+      if(v < cXMin)
+	cXMin = v;
+      if(v > cXMax)
+	cXMax = v;
+    }
+
+    if(c - cMin >= WRIST_RAISE_TO_COS(WRIST_RAISE_RISE_COS) &&
+       cXMax - cXMin >= WRIST_RAISE_TO_COS(WRIST_RAISE_PITCH_COS))
+      pParam->isRaising = 1;
+  }
+
+  pParam->ui8Head = (uint8_t)((head + 1) & (WRIST_RAISE_WINDOW_MAX - 1));
+
+  return pParam->isRaising;
+}
+
+/*!
+ * @brief Get the last prediction
+ *
+ * @param pParam Pointer to the wrist raise parameter struct
+ *
+ * @return 1 if a raise was predicted on the last sample, 0 otherwise
+ */
+int8_t getWristRaise(motion_wrist_raise_param_t *pParam)
+{
+
+  return pParam->isRaising;
+}
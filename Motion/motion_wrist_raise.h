@@ -0,0 +1,125 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_wrist_raise.h
+ *
+ * Usage: predictive wrist raise detection
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file motion_wrist_raise.h
+ *  @brief Predicts a wrist raise while the wrist is still turning, from the
+ *         rise of the cosine of the tilt, z / |g|, over a short sliding
+ *         window, so the screen can be lit before the orientation settles
+ *         on ORIENT_Z_POS.
+ *
+ *  A raise is predicted on a sample when
+ *    - z / |g| rose by WRIST_RAISE_RISE_COS or more over the window, and
+ *      is still rising,
+ *    - the Z axis is within WRIST_RAISE_TILT_COS of the vertical,
+ *    - |g| stayed in [WRIST_RAISE_MAG_MIN_G, WRIST_RAISE_MAG_MAX_G] over
+ *      the window, so it is a rotation and not a swing or a shake,
+ *    - the hand was still, |g| in [WRIST_RAISE_STILL_MIN_G,
+ *      WRIST_RAISE_STILL_MAX_G] for WRIST_RAISE_STILL_MS, at most
+ *      WRIST_RAISE_STILL_AGE_MS ago, so the rise is not a vibration,
+ *    - x / |g| moved by WRIST_RAISE_PITCH_COS or more over the window, so
+ *      the forearm, along X, turned too and it is not a roll of the wrist
+ *      about the forearm, such as turning a door knob.
+ *  The caller confirms the prediction with the orientation, see
+ *  motion_alg_process_raise_hand().
+ *
+ *  As in processOrient(), the sample is taken to WRIST_RAISE_CODES_PER_G
+ *  codes and the cosines are found by integer comparisons of v * |v|
+ *  against j * |j| * |g|^2, so no square root or division is computed.
+ */
+
+#ifndef __MOTION_WRIST_RAISE_H__
+#define __MOTION_WRIST_RAISE_H__
+
+#include "type_support.h"
+#include "motion_features.h"
+
+#define WRIST_RAISE_WINDOW_MS    (200)   //rise window
+#define WRIST_RAISE_WINDOW_MAX   (32)    //window capacity in samples, 200 ms at 100Hz
+#define WRIST_RAISE_CODES_PER_G  (512)   //sample grid, as ORIENT_CODES_PER_G
+#define WRIST_RAISE_COS_SCALE    (32)    //cosines in 1/WRIST_RAISE_COS_SCALE, rounded down
+
+//Thresholds on z / |g|
+#define WRIST_RAISE_RISE_COS     (0.3f)   //rise over the window
+#define WRIST_RAISE_TILT_COS     (0.42f)  //cos(65 degrees)
+//Threshold on x / |g|, range over the window
+#define WRIST_RAISE_PITCH_COS    (0.1f)
+//Range of |g| during the gesture, the hand is lifted so it starts above 1g
+#define WRIST_RAISE_MAG_MIN_G    (0.8f)
+#define WRIST_RAISE_MAG_MAX_G    (1.4f)
+//Hand still before the gesture
+#define WRIST_RAISE_STILL_MS     (300)
+#define WRIST_RAISE_STILL_AGE_MS (500)   //end of the still part to the prediction
+#define WRIST_RAISE_STILL_MIN_G  (0.9f)
+#define WRIST_RAISE_STILL_MAX_G  (1.1f)
+
+typedef struct{
+
+  int8_t i8Cos[WRIST_RAISE_WINDOW_MAX];  //z / |g| history, circular
+  int8_t i8CosX[WRIST_RAISE_WINDOW_MAX]; //x / |g| history, same slots
+  uint8_t ui8Window;    //window length in samples, history of ui8Window + 1
+  uint8_t ui8Head;      //slot of the next sample
+  uint8_t ui8Steady;    //samples in a row with |g| in range, up to ui8Window + 1
+  uint8_t ui8StillLen;  //WRIST_RAISE_STILL_MS in samples
+  uint8_t ui8StillAgeMax; //WRIST_RAISE_STILL_AGE_MS in samples
+  uint8_t ui8Still;     //samples in a row with the hand still, up to ui8StillLen
+  uint8_t ui8StillAge;  //samples since the hand was still, up to 255
+  int8_t isRaising;     //raise predicted on the last sample
+
+} motion_wrist_raise_param_t;
+
+/*!
+ * @brief Initialize the wrist raise prediction
+ *
+ * @param pParam Pointer to the wrist raise parameter struct
+ * @param ui32PeriodMs Period of the samples in ms
+ *
+ * @return None
+ */
+void wristRaiseInit(motion_wrist_raise_param_t *pParam, uint32_t ui32PeriodMs);
+
+/*!
+ * @brief Process the wrist raise prediction
+ *
+ * @param pParam Pointer to the wrist raise parameter struct
+ * @param[in] pFeat Features of the accelerometer reading in g
+ *
+ * @return 1 if a raise is predicted on this sample, 0 otherwise
+ */
+int8_t processWristRaise(motion_wrist_raise_param_t *pParam, motion_features_t *pFeat);
+
+/*!
+ * @brief Get the last prediction
+ *
+ * @param pParam Pointer to the wrist raise parameter struct
+ *
+ * @return 1 if a raise was predicted on the last sample, 0 otherwise
+ */
+int8_t getWristRaise(motion_wrist_raise_param_t *pParam);
+
+#endif //__MOTION_WRIST_RAISE_H__
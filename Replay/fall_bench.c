@@ -0,0 +1,336 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : fall_bench.c
+ *
+ * Usage: Fall detection on synthetic falls, against the blocking one
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "iir_filter.h"
+#include "motion_features.h"
+#include "motion_falldown.h"
+
+//
+// processFallDown() against the previous detection, which waited 1 s in
+// nrf_delay_ms() after the impact: the samples of that second were lost for
+// every algorithm, modelled here by skipping them, or, buffered, processed
+// right after the impact 1 s late, as motion_replay did. Synthetic scenarios at
+// 25Hz, quantized to the GMA303 1/512 g, TRIALS of each:
+//  - falls: free fall, impact, bounce, lying still
+//  - not falls: jump and walk on, sit down hard, watch put down on a table
+// Detections, fall events, latency from the impact sample as detected and
+// the samples lost are printed.
+//
+#define RATE_HZ        (25)
+#define PERIOD_MS      (1000 / RATE_HZ)
+#define MAX_SAMPLES    (4096)
+#define TRIALS         (100)
+#define alpha_fall     (0.5f)
+#define REF_BLOCK_MS   (1000)
+#define REF_STILL_MS   (280)
+
+typedef struct{
+
+  const char *name;
+  int8_t isFall;
+  void (*gen)(void);
+
+} fall_scenario_t;
+
+typedef struct{
+
+  uint32_t ui32Detected;    //scenarios with one event or more
+  uint32_t ui32Events;
+  uint32_t ui32Lost;        //samples not processed
+  int32_t latMs[TRIALS];    //first event from the impact
+  uint32_t ui32Lat;
+
+} fall_result_t;
+
+static float_xyzt_t samples[MAX_SAMPLES];
+static uint32_t ui32SampleCount;
+static uint32_t ui32Seed = 12345;
+
+static double rnd(void)
+{
+
+  ui32Seed = ui32Seed * 1103515245u + 12345u;
+
+  return ((ui32Seed >> 8) & 0xFFFF) / 65536.0;
+}
+
+static double sgn(void)
+{
+
+  return rnd() < 0.5 ? -1.0 : 1.0;
+}
+
+static void push(double x, double y, double z)
+{
+
+  double v[3] = {x, y, z};
+  int32_t i;
+
+  if(ui32SampleCount >= MAX_SAMPLES)
+    return;
+
+  for(i = 0; i < 3; ++i){
+    v[i] += (rnd() - 0.5) * 0.04;
+    samples[ui32SampleCount].v[i] = (float)(lrint(v[i] * 512.0) / 512.0);
+  }
+  samples[ui32SampleCount].u.t = 0.f;
+  ++ui32SampleCount;
+}
+
+//up vector of a random orientation, scaled
+static void up(double g, double *v)
+{
+
+  double th = M_PI * rnd(), ph = 2 * M_PI * rnd();
+
+  v[0] = g * sin(th) * cos(ph);
+  v[1] = g * sin(th) * sin(ph);
+  v[2] = g * cos(th);
+}
+
+static void hold(const double *v, uint32_t ms)
+{
+
+  uint32_t i;
+
+  for(i = 0; i < ms / PERIOD_MS; ++i)
+    push(v[0], v[1], v[2]);
+}
+
+//1.8 steps/s, heel strike of 1 g
+static void walk(uint32_t ms)
+{
+
+  uint32_t i;
+  double t, strike;
+
+  for(i = 0; i < ms / PERIOD_MS; ++i){
+    t = (double)i / RATE_HZ;
+    strike = (i % 14 == 0) ? 1.0 : 0.0;
+    push(0.3 * sin(2 * M_PI * 0.9 * t) + 0.3 * strike, 0.1, 1.0 + 0.4 * sin(2 * M_PI * 1.8 * t) + strike);
+  }
+}
+
+//impact on X and Y of 4 to 6 g each, after the free fall or not
+static void impact(double ffMs, double ffG)
+{
+
+  double v[3];
+  uint32_t i, n = 1 + (uint32_t)(rnd() * 2.99);
+
+  up(ffG, v);
+  hold(v, (uint32_t)ffMs);
+
+  for(i = 0; i < n; ++i)
+    push(sgn() * (4.0 + 2.0 * rnd()), sgn() * (4.0 + 2.0 * rnd()), sgn() * 3.0 * rnd());
+}
+
+static void gen_fall(void)
+{
+
+  double v[3];
+  uint32_t i;
+
+  walk(2000);
+  impact(200.0 + 300.0 * rnd(), 0.1 + 0.4 * rnd());
+  //bounce, then lying still
+  for(i = 0; i < 200 / PERIOD_MS; ++i)
+    push(0.5 * sgn(), 0.5 * sgn(), 1.0);
+  up(1.0, v);
+  hold(v, 5000);
+}
+
+static void gen_jump(void)
+{
+
+  walk(2000);
+  impact(300.0, 0.1);
+  walk(5000);
+}
+
+static void gen_sit(void)
+{
+
+  double v[3] = {0.2, 0.0, 0.98};
+
+  walk(2000);
+  //short dip, no free fall
+  impact(120.0, 0.7);
+  hold(v, 5000);
+}
+
+static void gen_table(void)
+{
+
+  double v[3] = {0.0, 0.0, 1.0};
+
+  hold(v, 2000);
+  impact(0.0, 1.0);
+  hold(v, 5000);
+}
+
+static const fall_scenario_t scenarios[] = {
+  {"fall", 1, gen_fall},
+  {"jump", 0, gen_jump},
+  {"sit_hard", 0, gen_sit},
+  {"table", 0, gen_table}
+};
+
+//previous detection, the samples of the 1 s wait lost, or processed late
+//when buffered
+static void run_ref(fall_result_t *pRes, int8_t isLost)
+{
+
+  iir_hpf_xyz_t iir;
+  float_xyzt_t hp;
+  int32_t flag = 0, onceFlag = 0, stillCount = 0, first = -1, impact = 0;
+  int32_t stillDuration = (REF_STILL_MS + PERIOD_MS / 2) / PERIOD_MS;
+  uint32_t i;
+
+  iirHpfXyzInit(&iir);
+  for(i = 0; i < ui32SampleCount; ++i){
+
+    filterHpfXyz(samples[i].v, hp.v, alpha_fall, &iir);
+
+    if(!onceFlag){
+      if((fabsf(hp.u.x) + fabsf(hp.u.y)) > 4. && (fabsf(hp.u.z) < 4.)){
+	onceFlag = 1;
+	flag = 0;
+	impact = (int32_t)i;
+	if(isLost){
+	  i += REF_BLOCK_MS / PERIOD_MS;
+	  pRes->ui32Lost += REF_BLOCK_MS / PERIOD_MS;
+	}
+	continue;
+      }
+    }
+    else{
+      if((fabsf(hp.u.x) < 0.25) && (fabsf(hp.u.y) < 0.25) && (fabsf(hp.u.z) < 0.5)){
+	if(++stillCount >= stillDuration){
+	  flag = 1;
+	  stillCount = stillDuration;
+	}
+      }
+      else{
+	stillCount = 0;
+	onceFlag = 0;
+      }
+    }
+
+    if(flag){
+      ++pRes->ui32Events;
+      if(first < 0){
+	first = (int32_t)i;
+	pRes->latMs[pRes->ui32Lat++] = (first - impact) * PERIOD_MS;
+      }
+    }
+  }
+
+  if(first >= 0)
+    ++pRes->ui32Detected;
+}
+
+static void run_new(fall_result_t *pRes)
+{
+
+  iir_hpf_xyz_t iir;
+  motion_features_t feat;
+  motion_fall_param_t fall;
+  float_xyzt_t hp;
+  int8_t isDetected = 0;
+  uint32_t i;
+
+  iirHpfXyzInit(&iir);
+  featuresInit(&feat, PERIOD_MS);
+  fallDownInit(&fall, PERIOD_MS);
+  for(i = 0; i < ui32SampleCount; ++i){
+
+    featuresUpdate(&feat, &samples[i]);
+    filterHpfXyz(samples[i].v, hp.v, alpha_fall, &iir);
+
+    if(processFallDown(&fall, &feat, &hp)){
+      ++pRes->ui32Events;
+      if(!isDetected)
+	pRes->latMs[pRes->ui32Lat++] = getFallDownLatencyMs(&fall);
+      isDetected = 1;
+    }
+  }
+
+  pRes->ui32Detected += isDetected;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+
+  return *(const int32_t*)a - *(const int32_t*)b;
+}
+
+static void print_result(const char *name, const char *alg, fall_result_t *pRes)
+{
+
+  qsort(pRes->latMs, pRes->ui32Lat, sizeof(pRes->latMs[0]), cmp_int);
+  printf("%-10s %-8s %8u %8u %8d %8d %8u\n", name, alg, pRes->ui32Detected, pRes->ui32Events,
+	 pRes->ui32Lat ? pRes->latMs[pRes->ui32Lat / 2] : -1,
+	 pRes->ui32Lat ? pRes->latMs[pRes->ui32Lat - 1] : -1, pRes->ui32Lost);
+}
+
+int main(void)
+{
+
+  static fall_result_t ref, buf, res;
+  uint32_t s, j;
+
+  printf("%d trials each, latency from the impact in ms\n", TRIALS);
+  printf("%-10s %-8s %8s %8s %8s %8s %8s\n", "scenario", "", "detected", "events",
+	 "med_ms", "max_ms", "lost");
+  for(s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); ++s){
+
+    memset(&ref, 0, sizeof(ref));
+    memset(&buf, 0, sizeof(buf));
+    memset(&res, 0, sizeof(res));
+    for(j = 0; j < TRIALS; ++j){
+      ui32SampleCount = 0;
+      scenarios[s].gen();
+      run_ref(&ref, 1);
+      run_ref(&buf, 0);
+      run_new(&res);
+    }
+
+    print_result(scenarios[s].name, "lost", &ref);
+    print_result("", "buffered", &buf);
+    print_result("", "states", &res);
+  }
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : filter_bench.c
+ *
+ * Usage: Cost of the generic IIR filter against the XYZ high-pass kernel
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "iir_filter.h"
+#include "motion_period.h"
+#include "motion_features.h"
+
+//
+// The high-pass filters of motion_main_ctrl.c and motion_features.c, each
+// at every processing period. As in the tree the coefficient is computed
+// when the rate is set and read from memory at every sample; the periods
+// are volatile so the compiler can't fold it into the kernel.
+//
+#define ALPHA_PEDO  (0.8f)
+#define ALPHA_FALL  (0.5f)
+#define ALPHA_SHAKE (0.4f)
+
+#define MAX_SAMPLES   (1 << 22)
+#define BENCH_REPEAT  (4)
+
+static const struct{
+
+  const char *name;
+  float alpha;
+
+} filters[] = {
+  {"pedo", ALPHA_PEDO},
+  {"fall", ALPHA_FALL},
+  {"shake", ALPHA_SHAKE},
+  {"features", MOTION_FEATURE_HP_ALPHA},
+};
+
+static volatile uint32_t periodsMs[] = {80, 40, 20, 10};
+
+static float samples[MAX_SAMPLES][3];
+
+static double now_ns(void)
+{
+
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/*!
+ * @brief Set up filterData() as the first order high-pass filter
+ *
+ * @param pParam IIR filter struct
+ * @param pCoeffA {a1}, 1 float
+ * @param pCoeffB {b0, b1}, 2 floats
+ * @param pHistX 3 floats
+ * @param pHistY 3 floats
+ * @param alpha Filter coefficient
+ *
+ * @return None
+ */
+static void generic_init(iir_filter_param_t *pParam, float *pCoeffA, float *pCoeffB,
+			 float *pHistX, float *pHistY, float alpha)
+{
+
+  pCoeffA[0] = alpha;
+  pCoeffB[0] = alpha;
+  pCoeffB[1] = -alpha;
+
+  pParam->dof = 3;
+  pParam->lenCoeffA = 1;
+  pParam->lenCoeffB = 2;
+  pParam->coeffA = pCoeffA;
+  pParam->coeffB = pCoeffB;
+  pParam->histX = pHistX;
+  pParam->histY = pHistY;
+  iirFilterInit(pParam);
+}
+
+int main(int argc, char **argv)
+{
+
+  uint32_t n = 0, i, f, p, ui32Diff, ui32Failed = 0;
+  int k;
+  float sink = 0.0f, alpha;
+  float coeffA[1], coeffB[2], histX[3], histY[3];
+  float yRef[3], yHpf[3];
+  FILE *fp;
+  iir_filter_param_t iir;
+  iir_hpf_xyz_t hpf;
+  double t0, dRefNs, dHpfNs;
+
+  //logs back to back, X,Y,Z in g
+  for(k = 1; k < argc; ++k){
+
+    if((fp = fopen(argv[k], "r")) == NULL){
+      fprintf(stderr, "can't read %s\n", argv[k]);
+      return 1;
+    }
+    while(n < MAX_SAMPLES &&
+	  fscanf(fp, " %f , %f , %f", &samples[n][0], &samples[n][1], &samples[n][2]) == 3)
+      ++n;
+    fclose(fp);
+  }
+
+  if(n == 0){
+    fprintf(stderr, "usage: filter_bench log ...\n");
+    return 1;
+  }
+
+  printf("%u samples\n", n);
+  printf("filter   period  alpha     generic_ns  hpf_ns  mismatch\n");
+
+  for(f = 0; f < sizeof(filters) / sizeof(filters[0]); ++f){
+    for(p = 0; p < sizeof(periodsMs) / sizeof(periodsMs[0]); ++p){
+
+      alpha = MOTION_ALG_PERIOD_ALPHA(filters[f].alpha, periodsMs[p]);
+
+      //same output on every sample, bit for bit
+      ui32Diff = 0;
+      generic_init(&iir, coeffA, coeffB, histX, histY, alpha);
+      iirHpfXyzInit(&hpf);
+      for(i = 0; i < n; ++i){
+	filterData(samples[i], yRef, &iir);
+	filterHpfXyz(samples[i], yHpf, alpha, &hpf);
+	if(yRef[0] != yHpf[0] || yRef[1] != yHpf[1] || yRef[2] != yHpf[2])
+	  ++ui32Diff;
+      }
+
+      t0 = now_ns();
+      for(k = 0; k < BENCH_REPEAT; ++k){
+	generic_init(&iir, coeffA, coeffB, histX, histY, alpha);
+	for(i = 0; i < n; ++i){
+	  filterData(samples[i], yRef, &iir);
+	  sink += yRef[0] + yRef[1] + yRef[2];
+	}
+      }
+      dRefNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+      t0 = now_ns();
+      for(k = 0; k < BENCH_REPEAT; ++k){
+	iirHpfXyzInit(&hpf);
+	for(i = 0; i < n; ++i){
+	  filterHpfXyz(samples[i], yHpf, alpha, &hpf);
+	  sink += yHpf[0] + yHpf[1] + yHpf[2];
+	}
+      }
+      dHpfNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+      printf("%-8s %4ums  %.6f  %10.2f  %6.2f  %8u\n", filters[f].name,
+	     (unsigned)periodsMs[p], alpha, dRefNs, dHpfNs, ui32Diff);
+      ui32Failed += ui32Diff;
+    }
+  }
+
+  //keep the filtered data alive
+  if(sink == 1.0f)
+    printf("\n");
+
+  return ui32Failed != 0;
+}
@@ -0,0 +1,635 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : motion_replay.c
+ *
+ * Usage: Multi-threaded offline replay of recorded accelerometer logs
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file motion_replay.c
+ *  @brief Run the motion algorithms over recorded accelerometer logs on a
+ *         Linux host, one stream per log, streams spread over a pool of
+ *         worker threads with work stealing.
+ *
+ *  Log format: one sample per line, "x,y,z" in g at MOTION_ALG_DATA_RATE_HZ
+ *  or at the rate given with -r,
+ *  separators may be comma, space or tab, lines starting with '#' are skipped.
+ *
+ *  Output: for each log, <outdir>/<log name>.events with one
+ *  "sample index,algorithm,data" line per event, or with -b
+ *  <outdir>/<log name>.tlm with one telemetry frame per event, or with -l
+ *  event packets as sent by the demo firmware, and one throughput line per
+ *  stream on the stdout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "motion_main_ctrl.h"
+#include "telemetry.h"
+#include "event_batch.h"
+
+#define REPLAY_MAX_WORKERS     (256)
+#define REPLAY_OUT_BUF_SIZE    (1 << 16)
+#define REPLAY_LINE_SIZE       (256)
+
+//The PEDO_* step detector keeps global state, it runs on a single worker
+#define REPLAY_ALG_UNSAFE      (MOTION_ALG_PEDO | MOTION_ALG_CALORIE | MOTION_ALG_ACTIVITY | MOTION_ALG_STEP)
+#define REPLAY_ALG_DEFAULT     (MOTION_ALG_FALL | MOTION_ALG_SHAKE | MOTION_ALG_RAISE_HAND | \
+				MOTION_ALG_FLIP | MOTION_ALG_SEDENTARY | MOTION_ALG_SLEEP_CYCLE)
+
+typedef struct{
+
+  const char *pInPath;
+  char outPath[1024];
+  uint32_t ui32SampleCount;
+  uint32_t ui32EventCount;
+  event_batch_stats_t batchStats;
+  double dSeconds;
+  int32_t i32Error;
+
+} replay_stream_t;
+
+//
+// Work queue of a worker, the owner takes from the tail,
+// thieves take from the head
+//
+typedef struct{
+
+  pthread_mutex_t lock;
+  uint32_t *pItems;
+  uint32_t ui32Head;
+  uint32_t ui32Tail;
+
+} replay_deque_t;
+
+typedef struct{
+
+  uint32_t ui32Id;
+  pthread_t thread;
+  replay_deque_t deque;
+  motion_ctx_t ctx;      //motion state owned by the worker
+  uint32_t ui32StolenCount;
+#if MOTION_ALG_PROFILE
+  //profiles of all the streams replayed by the worker
+  motion_profile_t profiles[MOTION_ALG_MAX_ENTRIES + 1];
+#endif
+
+} replay_worker_t;
+
+static replay_stream_t *pStreams = NULL;
+static uint32_t ui32StreamCount = 0;
+static replay_worker_t *pWorkers = NULL;
+static uint32_t ui32WorkerCount = 0;
+static int32_t i32AlgMask = REPLAY_ALG_DEFAULT;
+static motion_alg_rate_t rate = (motion_alg_rate_t)(1000 / MOTION_ALG_DATA_RATE_HZ);
+static const char *pOutDir = ".";
+static int8_t i8Binary = 0;
+static int32_t i32BatchLatencyMs = -1;  //event packets max latency, -1 for no packets
+
+/*!
+ * @brief Get the monotonic time
+ *
+ * @return Time in sec
+ */
+static double replay_time_s(void)
+{
+
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*!
+ * @brief Take a stream from the tail of a work queue
+ *
+ * @param[in] pDeque Pointer to the work queue
+ * @param[out] pIndex Pointer to store the stream index
+ *
+ * @return 1 for success, 0 if the queue is empty
+ */
+static int8_t replay_deque_pop_tail(replay_deque_t *pDeque, uint32_t *pIndex)
+{
+
+  int8_t res = 0;
+
+  pthread_mutex_lock(&pDeque->lock);
+  if(pDeque->ui32Tail != pDeque->ui32Head){
+    *pIndex = pDeque->pItems[--pDeque->ui32Tail];
+    res = 1;
+  }
+  pthread_mutex_unlock(&pDeque->lock);
+
+  return res;
+}
+
+/*!
+ * @brief Take a stream from the head of a work queue
+ *
+ * @param[in] pDeque Pointer to the work queue
+ * @param[out] pIndex Pointer to store the stream index
+ *
+ * @return 1 for success, 0 if the queue is empty
+ */
+static int8_t replay_deque_pop_head(replay_deque_t *pDeque, uint32_t *pIndex)
+{
+
+  int8_t res = 0;
+
+  pthread_mutex_lock(&pDeque->lock);
+  if(pDeque->ui32Tail != pDeque->ui32Head){
+    *pIndex = pDeque->pItems[pDeque->ui32Head++];
+    res = 1;
+  }
+  pthread_mutex_unlock(&pDeque->lock);
+
+  return res;
+}
+
+/*!
+ * @brief Get the next stream for a worker, from its own queue first,
+ *        otherwise stolen from another worker
+ *
+ * @param[in] pWorker Pointer to the worker
+ * @param[out] pIndex Pointer to store the stream index
+ *
+ * @return 1 for success, 0 if no stream is left
+ */
+static int8_t replay_next_stream(replay_worker_t *pWorker, uint32_t *pIndex)
+{
+
+  uint32_t i;
+
+  if(replay_deque_pop_tail(&pWorker->deque, pIndex))
+    return 1;
+
+  //No stream is ever added after the start, so all queues empty means done
+  for(i = 1; i < ui32WorkerCount; ++i){
+
+    if(replay_deque_pop_head(&pWorkers[(pWorker->ui32Id + i) % ui32WorkerCount].deque, pIndex)){
+      ++pWorker->ui32StolenCount;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*!
+ * @brief Parse one log line
+ *
+ * @param[in] pLine The line
+ * @param[out] pgVal Pointer to store the sample in g
+ *
+ * @return 1 for a sample, 0 for a line to skip
+ */
+static int8_t replay_parse_line(const char *pLine, float_xyzt_t *pgVal)
+{
+
+  int32_t i;
+  char *pEnd;
+
+  while(*pLine == ' ' || *pLine == '\t') ++pLine;
+
+  if(*pLine == '#' || *pLine == '\r' || *pLine == '\n' || *pLine == '\0')
+    return 0;
+
+  for(i = 0; i < 3; ++i){
+
+    while(*pLine == ',' || *pLine == ' ' || *pLine == '\t') ++pLine;
+
+    pgVal->v[i] = strtof(pLine, &pEnd);
+    if(pEnd == pLine) return 0;
+    pLine = pEnd;
+  }
+
+  pgVal->v[3] = 0.0f;
+
+  return 1;
+}
+
+static void replay_event_handler(motion_algorithm_t event, int32_t i32Data)
+{
+  //events are popped from the context queue
+}
+
+/*!
+ * @brief Replay one stream on a worker
+ *
+ * @param[in] pWorker Pointer to the worker
+ * @param[in] pStream Pointer to the stream
+ *
+ * @return None
+ */
+static void replay_run_stream(replay_worker_t *pWorker, replay_stream_t *pStream)
+{
+
+  motion_ctx_t *pCtx = &pWorker->ctx;
+  FILE *pIn, *pOut;
+  char line[REPLAY_LINE_SIZE];
+  char *pOutBuf;
+  float_xyzt_t gVal;
+  motion_event_t event;
+  telemetry_frame_t frame;
+  event_batch_t batch;
+  uint32_t ui32NowMs = 0;
+  double dStart;
+#if MOTION_ALG_PROFILE
+  uint32_t i;
+#endif
+
+  pIn = fopen(pStream->pInPath, "r");
+  if(pIn == NULL){
+    pStream->i32Error = 1;
+    return;
+  }
+
+  pOut = fopen(pStream->outPath, i8Binary ? "wb" : "w");
+  if(pOut == NULL){
+    fclose(pIn);
+    pStream->i32Error = 1;
+    return;
+  }
+
+  pOutBuf = malloc(REPLAY_OUT_BUF_SIZE);
+  if(pOutBuf != NULL)
+    setvbuf(pOut, pOutBuf, _IOFBF, REPLAY_OUT_BUF_SIZE);
+
+  dStart = replay_time_s();
+
+  //Same settings as the demo firmware
+  motion_alg_init_ctx(pCtx, replay_event_handler);
+  motion_alg_set_rate_ctx(pCtx, rate);
+  motion_alg_enable_ctx(pCtx, i32AlgMask, 1);
+  motion_shake_set_param_ctx(pCtx, 0.7, 40, 2, 1500, X_AXIS|Y_AXIS|Z_AXIS);
+  motion_sedentary_set_param_ctx(pCtx, 30, 10);
+
+  //Same packets as the demo firmware, the time is the sample time
+  eventBatchInit(&batch, EVENT_BATCH_MAX_EVENTS, (uint32_t)i32BatchLatencyMs);
+  eventBatchSetPriority(&batch, MOTION_ALG_FALL, EVENT_BATCH_PRIORITY_URGENT);
+
+  while(fgets(line, sizeof(line), pIn) != NULL){
+
+    if(!replay_parse_line(line, &gVal)) continue;
+
+    motion_alg_process_data_ctx(pCtx, gVal);
+    ++pStream->ui32SampleCount;
+    ui32NowMs += (uint32_t)rate;
+
+    while(motion_alg_pop_event_ctx(pCtx, &event)){
+
+      if(i32BatchLatencyMs >= 0){
+	if(eventBatchAdd(&batch, &event, ui32NowMs) &&
+	   eventBatchFlush(&batch, &frame, ui32NowMs) > 0)
+	  fwrite(frame.buf, 1, telemetryEnd(&frame), pOut);
+      }
+      else if(i8Binary){
+	telemetryBegin(&frame, TELEMETRY_TYPE_EVENT);
+	telemetryPutU32(&frame, __builtin_ctz(event.alg));
+	telemetryPutS32(&frame, event.i32Data);
+	telemetryPutU32(&frame, event.ui32SampleIndex);
+	fwrite(frame.buf, 1, telemetryEnd(&frame), pOut);
+      }
+      else
+	fprintf(pOut, "%u,%d,%d\n", event.ui32SampleIndex, event.alg, event.i32Data);
+
+      ++pStream->ui32EventCount;
+    }
+
+    if(i32BatchLatencyMs >= 0 && eventBatchIsDue(&batch, ui32NowMs) &&
+       eventBatchFlush(&batch, &frame, ui32NowMs) > 0)
+      fwrite(frame.buf, 1, telemetryEnd(&frame), pOut);
+  }
+
+  //End of the log, send what is left
+  if(i32BatchLatencyMs >= 0 && eventBatchFlush(&batch, &frame, ui32NowMs) > 0)
+    fwrite(frame.buf, 1, telemetryEnd(&frame), pOut);
+  getEventBatchStats(&batch, &pStream->batchStats);
+
+  pStream->dSeconds = replay_time_s() - dStart;
+
+#if MOTION_ALG_PROFILE
+  for(i = 0; i < MOTION_ALG_MAX_ENTRIES + 1; ++i)
+    profileMerge(&pWorker->profiles[i], (i < MOTION_ALG_MAX_ENTRIES) ? &pCtx->profiles[i] : &pCtx->profileTotal);
+#endif
+
+  fclose(pIn);
+  fclose(pOut);
+  free(pOutBuf);
+}
+
+static void* replay_worker_main(void *pArg)
+{
+
+  replay_worker_t *pWorker = (replay_worker_t*)pArg;
+  uint32_t ui32Index;
+
+  while(replay_next_stream(pWorker, &ui32Index))
+    replay_run_stream(pWorker, &pStreams[ui32Index]);
+
+  return NULL;
+}
+
+#if MOTION_ALG_PROFILE
+/*!
+ * @brief Print the execution time profile of all the workers to the stderr
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void replay_report_profile(void)
+{
+
+  motion_ctx_t *pCtx = &pWorkers[0].ctx;
+  motion_profile_stats_t stats;
+  const char *pName;
+  uint32_t i, j;
+
+  //Merge into the first worker, then report through its context
+  for(i = 0; i < MOTION_ALG_MAX_ENTRIES + 1; ++i){
+
+    for(j = 1; j < ui32WorkerCount; ++j)
+      profileMerge(&pWorkers[0].profiles[i], &pWorkers[j].profiles[i]);
+
+    if(i < MOTION_ALG_MAX_ENTRIES)
+      pCtx->profiles[i] = pWorkers[0].profiles[i];
+    else
+      pCtx->profileTotal = pWorkers[0].profiles[i];
+  }
+
+  fprintf(stderr, "# profile (%s): count min mean max p99\n", MOTION_PROFILE_UNIT);
+
+  for(i = 0; motion_alg_get_profile_ctx(pCtx, i, &pName, &stats); ++i){
+
+    if(stats.ui32Count == 0) continue;
+
+    fprintf(stderr, "# %s: %u %u %u %u %u\n",
+	    pName,
+	    stats.ui32Count,
+	    stats.ui32Min,
+	    stats.ui32Mean,
+	    stats.ui32Max,
+	    stats.ui32P99);
+  }
+}
+#endif
+
+/*!
+ * @brief Add the event packet statistics of a stream to the totals
+ *
+ * @param[in] pTotal Pointer to the totals
+ * @param[in] pStats Pointer to the statistics of the stream
+ *
+ * @return None
+ */
+static void replay_merge_batch_stats(event_batch_stats_t *pTotal, const event_batch_stats_t *pStats)
+{
+
+  uint32_t i;
+  uint64_t ui64Sum;
+
+  if(pStats->ui32EventCount == 0)
+    return;
+
+  if(pTotal->ui32EventCount == 0 || pStats->ui32LatencyMin < pTotal->ui32LatencyMin)
+    pTotal->ui32LatencyMin = pStats->ui32LatencyMin;
+  if(pStats->ui32LatencyMax > pTotal->ui32LatencyMax)
+    pTotal->ui32LatencyMax = pStats->ui32LatencyMax;
+
+  ui64Sum = (uint64_t)pTotal->ui32LatencyMean * pTotal->ui32EventCount +
+    (uint64_t)pStats->ui32LatencyMean * pStats->ui32EventCount;
+
+  pTotal->ui32PacketCount += pStats->ui32PacketCount;
+  pTotal->ui32EventCount += pStats->ui32EventCount;
+  pTotal->ui32FullCount += pStats->ui32FullCount;
+  pTotal->ui32TimeoutCount += pStats->ui32TimeoutCount;
+  pTotal->ui32UrgentCount += pStats->ui32UrgentCount;
+  pTotal->ui32ForcedCount += pStats->ui32ForcedCount;
+  pTotal->ui32LatencyMean = (uint32_t)(ui64Sum / pTotal->ui32EventCount);
+
+  for(i = 0; i < EVENT_BATCH_LATENCY_BINS; ++i)
+    pTotal->latencyHist[i] += pStats->latencyHist[i];
+}
+
+static void replay_usage(const char *pName)
+{
+
+  fprintf(stderr,
+	  "Usage: %s [-j workers] [-o outdir] [-a algmask] [-r rate] [-b] [-l ms] log ...\n"
+	  "  -j  number of worker threads, default: number of cores\n"
+	  "  -o  directory of the .events files, default: .\n"
+	  "  -a  bit-or of motion_algorithm_t to enable, default: 0x%x\n"
+	  "  -r  data rate of the logs in Hz, 12.5, 25, 50 or 100, default: %d\n"
+	  "  -b  write the events as telemetry frames, .tlm files\n"
+	  "  -l  write the events in packets of max latency ms, .tlm files,\n"
+	  "      and print the packet statistics\n",
+	  pName, REPLAY_ALG_DEFAULT, MOTION_ALG_DATA_RATE_HZ);
+}
+
+int main(int argc, char *argv[])
+{
+
+  int opt;
+  uint32_t i, ui32Failed = 0;
+#if MOTION_ALG_PROFILE
+  uint32_t j;
+#endif
+  uint64_t ui64Samples = 0;
+  event_batch_stats_t batchStats;
+  const char *pName;
+  double dStart, dWall, dRate;
+  long lCores = sysconf(_SC_NPROCESSORS_ONLN);
+
+  ui32WorkerCount = (lCores > 0) ? (uint32_t)lCores : 1;
+
+  while((opt = getopt(argc, argv, "j:o:a:r:bl:h")) != -1){
+
+    switch(opt){
+    case 'j':
+      ui32WorkerCount = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      pOutDir = optarg;
+      break;
+    case 'a':
+      i32AlgMask = (int32_t)strtol(optarg, NULL, 0);
+      break;
+    case 'r':
+      //sample period in ms
+      dRate = strtod(optarg, NULL);
+      rate = (motion_alg_rate_t)((dRate > 0.0) ? (int32_t)(1000.0 / dRate + 0.5) : 0);
+      if(rate != MOTION_ALG_RATE_12_5HZ && rate != MOTION_ALG_RATE_25HZ &&
+	 rate != MOTION_ALG_RATE_50HZ && rate != MOTION_ALG_RATE_100HZ){
+	fprintf(stderr, "Unsupported rate %s\n", optarg);
+	return 1;
+      }
+      break;
+    case 'b':
+      i8Binary = 1;
+      break;
+    case 'l':
+      i32BatchLatencyMs = (int32_t)strtol(optarg, NULL, 0);
+      if(i32BatchLatencyMs < 0){
+	fprintf(stderr, "Invalid latency %s\n", optarg);
+	return 1;
+      }
+      i8Binary = 1;
+      break;
+    default:
+      replay_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(optind >= argc){
+    replay_usage(argv[0]);
+    return 1;
+  }
+
+  if((i32AlgMask & REPLAY_ALG_UNSAFE) && ui32WorkerCount > 1){
+    fprintf(stderr, "Pedo, calorie and activity run on a single worker\n");
+    ui32WorkerCount = 1;
+  }
+
+  ui32StreamCount = (uint32_t)(argc - optind);
+
+  if(ui32WorkerCount < 1) ui32WorkerCount = 1;
+  if(ui32WorkerCount > REPLAY_MAX_WORKERS) ui32WorkerCount = REPLAY_MAX_WORKERS;
+  if(ui32WorkerCount > ui32StreamCount) ui32WorkerCount = ui32StreamCount;
+
+  pStreams = calloc(ui32StreamCount, sizeof(replay_stream_t));
+  pWorkers = calloc(ui32WorkerCount, sizeof(replay_worker_t));
+  if(pStreams == NULL || pWorkers == NULL){
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  for(i = 0; i < ui32StreamCount; ++i){
+
+    pStreams[i].pInPath = argv[optind + i];
+    pName = strrchr(pStreams[i].pInPath, '/');
+    pName = (pName != NULL) ? pName + 1 : pStreams[i].pInPath;
+    snprintf(pStreams[i].outPath, sizeof(pStreams[i].outPath), "%s/%s.%s",
+	     pOutDir, pName, i8Binary ? "tlm" : "events");
+  }
+
+  //Deal the streams round robin, stealing balances the uneven lengths
+  for(i = 0; i < ui32WorkerCount; ++i){
+
+    pWorkers[i].ui32Id = i;
+#if MOTION_ALG_PROFILE
+    for(j = 0; j < MOTION_ALG_MAX_ENTRIES + 1; ++j)
+      profileInit(&pWorkers[i].profiles[j]);
+#endif
+    pthread_mutex_init(&pWorkers[i].deque.lock, NULL);
+    pWorkers[i].deque.pItems = malloc(sizeof(uint32_t) * (ui32StreamCount / ui32WorkerCount + 1));
+    if(pWorkers[i].deque.pItems == NULL){
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+    }
+  }
+
+  for(i = 0; i < ui32StreamCount; ++i){
+    replay_deque_t *pDeque = &pWorkers[i % ui32WorkerCount].deque;
+    pDeque->pItems[pDeque->ui32Tail++] = i;
+  }
+
+  memset(&batchStats, 0, sizeof(batchStats));
+  dStart = replay_time_s();
+
+  for(i = 0; i < ui32WorkerCount; ++i)
+    pthread_create(&pWorkers[i].thread, NULL, replay_worker_main, &pWorkers[i]);
+
+  for(i = 0; i < ui32WorkerCount; ++i)
+    pthread_join(pWorkers[i].thread, NULL);
+
+  dWall = replay_time_s() - dStart;
+
+#if MOTION_ALG_PROFILE
+  replay_report_profile();
+#endif
+
+  //Per-stream report: log, samples, events, sec, samples/sec
+  for(i = 0; i < ui32StreamCount; ++i){
+
+    if(pStreams[i].i32Error){
+      fprintf(stderr, "%s: cannot open the log or the output\n", pStreams[i].pInPath);
+      ++ui32Failed;
+      continue;
+    }
+
+    printf("%s %u %u %.3f %.0f\n",
+	   pStreams[i].pInPath,
+	   pStreams[i].ui32SampleCount,
+	   pStreams[i].ui32EventCount,
+	   pStreams[i].dSeconds,
+	   (pStreams[i].dSeconds > 0.0) ? pStreams[i].ui32SampleCount / pStreams[i].dSeconds : 0.0);
+
+    ui64Samples += pStreams[i].ui32SampleCount;
+
+    replay_merge_batch_stats(&batchStats, &pStreams[i].batchStats);
+  }
+
+  printf("# %u streams, %u workers, %llu samples in %.3f s, %.0f samples/s\n",
+	 ui32StreamCount - ui32Failed,
+	 ui32WorkerCount,
+	 (unsigned long long)ui64Samples,
+	 dWall,
+	 (dWall > 0.0) ? ui64Samples / dWall : 0.0);
+
+  if(i32BatchLatencyMs >= 0){
+
+    printf("# %u events in %u packets, %.2f events/packet, full:%u timeout:%u urgent:%u end:%u\n",
+	   batchStats.ui32EventCount,
+	   batchStats.ui32PacketCount,
+	   (batchStats.ui32PacketCount > 0) ?
+	   (double)batchStats.ui32EventCount / batchStats.ui32PacketCount : 0.0,
+	   batchStats.ui32FullCount,
+	   batchStats.ui32TimeoutCount,
+	   batchStats.ui32UrgentCount,
+	   batchStats.ui32ForcedCount);
+    printf("# latency ms min:%u mean:%u max:%u, histogram:",
+	   batchStats.ui32LatencyMin,
+	   batchStats.ui32LatencyMean,
+	   batchStats.ui32LatencyMax);
+    for(i = 0; i < EVENT_BATCH_LATENCY_BINS; ++i)
+      printf(" %u", batchStats.latencyHist[i]);
+    printf("\n");
+  }
+
+  for(i = 0; i < ui32WorkerCount; ++i){
+    pthread_mutex_destroy(&pWorkers[i].deque.lock);
+    free(pWorkers[i].deque.pItems);
+  }
+  free(pWorkers);
+  free(pStreams);
+
+  return (ui32Failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : orient_bench.c
+ *
+ * Usage: Equivalence and cost of the integer orientation classifier
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "motion_features.h"
+#include "motion_orientation.h"
+
+//
+// Reference: the acos based processOrient() the integer classifier
+// replaces. Both get samples on the ORIENT_CODES_PER_G grid, as the g
+// values of main.c are. On that grid the only differences allowed are
+// exact ties, a sample right on a switch angle, where the reference
+// decides by the rounding of acos.
+//
+#define Rad2Deg (57.29578)
+#define SWITCH_THRESHOLD_DEG 45.f
+#define SWITCH_HYSTERESIS_DEG 15.f
+
+#define MAX_SAMPLES   (1 << 20)
+#define BENCH_REPEAT  (4)
+
+//not inlined, a call per sample like processOrient()
+__attribute__((noinline)) static motion_orient_t ref_process(motion_orient_param_t *pParam, motion_features_t *pFeat)
+{
+
+  const float_xyzt_t *pgVal = pFeat->pgVal;
+  float xi = acos(getFeatureCosTilt(pFeat)) * Rad2Deg;
+  float psi = acos(pgVal->u.x / getFeatureXyMag(pFeat)) * Rad2Deg;
+  float thZ, thX;
+
+  switch(pParam->orientation){
+  case ORIENT_NA:
+    thZ = SWITCH_THRESHOLD_DEG;
+    thX = SWITCH_THRESHOLD_DEG;
+    break;
+  case ORIENT_Z_POS:
+  case ORIENT_Z_NEG:
+    thZ = SWITCH_THRESHOLD_DEG + SWITCH_HYSTERESIS_DEG;
+    thX = SWITCH_THRESHOLD_DEG;
+    break;
+  case ORIENT_Y_POS:
+  case ORIENT_Y_NEG:
+    thZ = SWITCH_THRESHOLD_DEG - SWITCH_HYSTERESIS_DEG;
+    thX = SWITCH_THRESHOLD_DEG - SWITCH_HYSTERESIS_DEG;
+    break;
+  default:
+    thZ = SWITCH_THRESHOLD_DEG - SWITCH_HYSTERESIS_DEG;
+    thX = SWITCH_THRESHOLD_DEG + SWITCH_HYSTERESIS_DEG;
+    break;
+  }
+
+  if(xi < thZ || xi > 180 - thZ){
+    pParam->orientation = pgVal->u.z > 0 ? ORIENT_Z_POS : ORIENT_Z_NEG;
+  }
+  else{
+    if(psi < thX || psi > 180 - thX){
+      pParam->orientation = pgVal->u.x > 0 ? ORIENT_X_POS : ORIENT_X_NEG;
+    }
+    else{
+      pParam->orientation = pgVal->u.y > 0 ? ORIENT_Y_POS : ORIENT_Y_NEG;
+    }
+  }
+
+  return pParam->orientation;
+}
+
+/*!
+ * @brief Check whether codes are on a switch angle of an orientation
+ *
+ * @param x, y, z Codes
+ * @param orient Orientation before the sample
+ *
+ * @return 1 on a tie, 0 otherwise
+ */
+static int32_t is_tie(int64_t x, int64_t y, int64_t z, motion_orient_t orient)
+{
+
+  //cos^2 of the switch angles to Z and X, as in motion_orientation.c
+  static const int64_t cos2[7][4] = {
+    {1, 2, 1, 2}, {3, 4, 1, 4}, {3, 4, 1, 4}, {3, 4, 3, 4},
+    {3, 4, 3, 4}, {1, 4, 1, 2}, {1, 4, 1, 2}
+  };
+  const int64_t *c = cos2[orient];
+  int64_t xy2 = x * x + y * y;
+
+  return c[1] * z * z == c[0] * (xy2 + z * z) || c[3] * x * x == c[2] * xy2;
+}
+
+static float_xyzt_t samples[MAX_SAMPLES];
+static motion_orient_t refOut[MAX_SAMPLES];
+
+static double now_ns(void)
+{
+
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/*!
+ * @brief Compare both on every code of a cube, from every orientation
+ *
+ * @param range Codes in [-range, range]
+ * @param step Code step
+ * @param pTies Incremented by the number of ties
+ *
+ * @return Number of differences which are not ties
+ */
+static uint32_t sweep(int32_t range, int32_t step, uint32_t *pTies)
+{
+
+  int32_t x, y, z, o;
+  uint32_t ui32Diff = 0;
+  float_xyzt_t g;
+  motion_features_t feat;
+  motion_orient_param_t ref, orient;
+
+  featuresInit(&feat, 40);
+
+  for(x = -range; x <= range; x += step)
+    for(y = -range; y <= range; y += step)
+      for(z = -range; z <= range; z += step){
+
+	//no direction, the reference gives ORIENT_Y_NEG out of NaN
+	if(x == 0 && y == 0 && z == 0)
+	  continue;
+
+	g.u.x = (float)x / ORIENT_CODES_PER_G;
+	g.u.y = (float)y / ORIENT_CODES_PER_G;
+	g.u.z = (float)z / ORIENT_CODES_PER_G;
+
+	for(o = ORIENT_NA; o <= ORIENT_Z_NEG; ++o){
+
+	  ref.orientation = orient.orientation = (motion_orient_t)o;
+	  featuresUpdate(&feat, &g);
+	  ref_process(&ref, &feat);
+	  featuresUpdate(&feat, &g);
+	  processOrient(&orient, &feat);
+
+	  if(ref.orientation != orient.orientation){
+	    if(is_tie(x, y, z, (motion_orient_t)o))
+	      ++*pTies;
+	    else
+	      ++ui32Diff;
+	  }
+	}
+      }
+
+  return ui32Diff;
+}
+
+int main(int argc, char **argv)
+{
+
+  uint32_t n = 0, i, ui32Diff, ui32Ties, ui32Failed = 0;
+  uint32_t ui32Sink = 0;
+  int k;
+  float x, y, z;
+  FILE *fp;
+  motion_features_t feat;
+  motion_orient_param_t ref, orient;
+  double t0, dRefNs, dNewNs;
+
+  //every code of +/-0.25g, then +/-4g on a coarser grid
+  ui32Ties = 0;
+  ui32Diff = sweep(128, 1, &ui32Ties);
+  printf("sweep +/-128 codes: %u differences, %u ties\n", ui32Diff, ui32Ties);
+  ui32Failed += ui32Diff;
+
+  ui32Ties = 0;
+  ui32Diff = sweep(2048, 31, &ui32Ties);
+  printf("sweep +/-2048 codes, step 31: %u differences, %u ties\n", ui32Diff, ui32Ties);
+  ui32Failed += ui32Diff;
+
+  //logs back to back, X,Y,Z in g at 25Hz, on the code grid
+  for(k = 1; k < argc; ++k){
+
+    if((fp = fopen(argv[k], "r")) == NULL){
+      fprintf(stderr, "can't read %s\n", argv[k]);
+      return 1;
+    }
+    while(n < MAX_SAMPLES && fscanf(fp, " %f , %f , %f", &x, &y, &z) == 3){
+      samples[n].u.x = roundf(x * ORIENT_CODES_PER_G) / ORIENT_CODES_PER_G;
+      samples[n].u.y = roundf(y * ORIENT_CODES_PER_G) / ORIENT_CODES_PER_G;
+      samples[n].u.z = roundf(z * ORIENT_CODES_PER_G) / ORIENT_CODES_PER_G;
+      ++n;
+    }
+    fclose(fp);
+  }
+
+  if(n == 0)
+    return ui32Failed != 0;
+
+  //the orientation carried along the logs
+  featuresInit(&feat, 40);
+  orientInit(&ref);
+  orientInit(&orient);
+  ui32Diff = ui32Ties = 0;
+  for(i = 0; i < n; ++i){
+
+    motion_orient_t prev = ref.orientation;
+
+    featuresUpdate(&feat, &samples[i]);
+    refOut[i] = ref_process(&ref, &feat);
+    featuresUpdate(&feat, &samples[i]);
+    if(processOrient(&orient, &feat) != refOut[i]){
+      if(is_tie(lrintf(samples[i].u.x * ORIENT_CODES_PER_G),
+		lrintf(samples[i].u.y * ORIENT_CODES_PER_G),
+		lrintf(samples[i].u.z * ORIENT_CODES_PER_G), prev))
+	++ui32Ties;
+      else
+	++ui32Diff;
+      //carry on from the same orientation
+      orient.orientation = refOut[i];
+    }
+  }
+
+  //cost per sample, features included
+  t0 = now_ns();
+  for(k = 0; k < BENCH_REPEAT; ++k){
+    orientInit(&ref);
+    for(i = 0; i < n; ++i){
+      featuresUpdate(&feat, &samples[i]);
+      ui32Sink += ref_process(&ref, &feat);
+    }
+  }
+  dRefNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+  t0 = now_ns();
+  for(k = 0; k < BENCH_REPEAT; ++k){
+    orientInit(&orient);
+    for(i = 0; i < n; ++i){
+      featuresUpdate(&feat, &samples[i]);
+      ui32Sink += processOrient(&orient, &feat);
+    }
+  }
+  dNewNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+  printf("logs: %u samples, %u differences, %u ties, ref %.2f ns, integer %.2f ns per sample\n",
+	 n, ui32Diff, ui32Ties, dRefNs, dNewNs);
+  ui32Failed += ui32Diff;
+
+  return (ui32Failed != 0 || ui32Sink == 0);
+}
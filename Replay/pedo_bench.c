@@ -0,0 +1,190 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : pedo_bench.c
+ *
+ * Usage: Step count and cost of the PEDO_* step detector on recorded logs
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "iir_filter.h"
+#include "motion_pedo.h"
+
+//
+// Same front end as the pedo algorithm of motion_main_ctrl.c at 25Hz:
+// first order high-pass filter, then codes of PEDO_CODES_PER_G.
+// Built against motion_step_detector.c for the host, or against
+// libpedo.a for the Cortex-M0 and run with qemu-arm, see the Makefile.
+// Each log runs through processPedoBlock() one sample at a time, then in
+// blocks of a sensor FIFO read, the steps must be on the same samples.
+//
+#define ALPHA_PEDO    (0.8f)
+#define MAX_SAMPLES   (1 << 18)
+#define BENCH_BLOCK   (32)      //samples per block, a full GMA303 FIFO
+#define BENCH_HEIGHT_M  (1.7f)
+#define BENCH_WEIGHT_KG (65.0f)
+
+static pedo_sample_t samples[MAX_SAMPLES];
+static uint32_t stepSamples[MAX_SAMPLES]; //sample of each step count change, one sample blocks
+
+/*!
+ * @brief Load a log of X,Y,Z in g, filtered and scaled for PEDO_*
+ *
+ * @param pFile Log file
+ *
+ * @return Number of samples, -1 if the file can't be read
+ */
+static int32_t load_log(const char *pFile)
+{
+
+  FILE *fp = fopen(pFile, "r");
+  iir_hpf_xyz_t hpf;
+  float x[3], y[3];
+  int32_t n = 0, i;
+
+  if(fp == NULL)
+    return -1;
+
+  iirHpfXyzInit(&hpf);
+
+  while(n < MAX_SAMPLES && fscanf(fp, " %f , %f , %f", &x[0], &x[1], &x[2]) == 3){
+    filterHpfXyz(x, y, ALPHA_PEDO, &hpf);
+    for(i = 0; i < 3; ++i)
+      samples[n].v[i] = (int16_t)lrintf(y[i] * PEDO_CODES_PER_G);
+    ++n;
+  }
+
+  fclose(fp);
+
+  return n;
+}
+
+/*!
+ * @brief Elapsed time in ns
+ *
+ * @param pT0 Start time
+ * @param pT1 End time
+ *
+ * @return Time in ns
+ */
+static double elapsed_ns(const struct timespec *pT0, const struct timespec *pT1)
+{
+
+  return (pT1->tv_sec - pT0->tv_sec) * 1e9 + (pT1->tv_nsec - pT0->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+
+  int32_t i, n, total = 0;
+  uint32_t j, k, c, ui32Len, ui32StepChanges, ui32Mismatch, ui32TotalMismatch = 0;
+  uint32_t activityTime[4];
+  unsigned long steps, totalSteps = 0;
+  motion_pedo_param_t param;
+  pedo_change_t changes[BENCH_BLOCK];
+  pedo_block_result_t result;
+  struct timespec t0, t1;
+  double ns = 0.0, nsBlock = 0.0;
+  float fCalories;
+
+  if(argc < 2){
+    fprintf(stderr, "usage: %s LOG.csv...\n", argv[0]);
+    return 1;
+  }
+
+  printf("%-24s %8s %8s %8s %8s %8s %8s\n", "log", "samples", "steps", "still_s", "walk_s", "run_s", "block");
+
+  for(i = 1; i < argc; ++i){
+
+    if((n = load_log(argv[i])) < 0){
+      fprintf(stderr, "can't read %s\n", argv[i]);
+      return 1;
+    }
+
+    //One sample per block, the activity of each sample
+    pedoInit(&param, PEDO_SAMPLE_PERIOD_MS);
+    pedoSetParam(&param, BENCH_HEIGHT_M, BENCH_WEIGHT_KG);
+    activityTime[0] = activityTime[1] = activityTime[2] = activityTime[3] = 0;
+    result.ui32StepCount = 0;
+    result.fCalories = 0.f;
+    ui32StepChanges = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < (uint32_t)n; ++j){
+      processPedoBlock(&param, &samples[j], 1, changes, 1, &result);
+      if(result.ui32ChangeCount > 0 && (changes[0].ui8Changed & PEDO_CHANGE_STEP))
+	stepSamples[ui32StepChanges++] = j;
+      ++activityTime[result.ui8Activity & 3];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns += elapsed_ns(&t0, &t1);
+
+    steps = result.ui32StepCount;
+    fCalories = result.fCalories;
+
+    //Blocks of a FIFO read, the step count changes on the same samples
+    pedoInit(&param, PEDO_SAMPLE_PERIOD_MS);
+    pedoSetParam(&param, BENCH_HEIGHT_M, BENCH_WEIGHT_KG);
+    result.ui32StepCount = 0;
+    result.fCalories = 0.f;
+    ui32Mismatch = 0;
+    k = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < (uint32_t)n; j += ui32Len){
+      ui32Len = ((uint32_t)n - j < BENCH_BLOCK) ? (uint32_t)n - j : BENCH_BLOCK;
+      processPedoBlock(&param, &samples[j], ui32Len, changes, BENCH_BLOCK, &result);
+      for(c = 0; c < result.ui32ChangeCount; ++c){
+	if(!(changes[c].ui8Changed & PEDO_CHANGE_STEP)) continue;
+	if(k >= ui32StepChanges || stepSamples[k] != j + changes[c].ui16Offset)
+	  ++ui32Mismatch;
+	++k;
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    nsBlock += elapsed_ns(&t0, &t1);
+
+    if(k != ui32StepChanges || result.ui32StepCount != steps || result.fCalories != fCalories)
+      ++ui32Mismatch;
+
+    ui32TotalMismatch += ui32Mismatch;
+    totalSteps += steps;
+    total += n;
+
+    printf("%-24s %8d %8lu %8.1f %8.1f %8.1f %8s\n", argv[i], n, steps,
+	   activityTime[PEDO_ACTIVITY_STATIONARY] * PEDO_SAMPLE_PERIOD_MS / 1000.0,
+	   activityTime[PEDO_ACTIVITY_WALK] * PEDO_SAMPLE_PERIOD_MS / 1000.0,
+	   activityTime[PEDO_ACTIVITY_RUN] * PEDO_SAMPLE_PERIOD_MS / 1000.0,
+	   ui32Mismatch ? "MISMATCH" : "same");
+  }
+
+  printf("total: %d samples, %lu steps, %.1f ns/sample, %.1f ns/sample in blocks of %d, %u mismatches\n",
+	 total, totalSteps, total ? ns / total : 0.0, total ? nsBlock / total : 0.0,
+	 BENCH_BLOCK, (unsigned int)ui32TotalMismatch);
+
+  return ui32TotalMismatch ? 1 : 0;
+}
@@ -0,0 +1,502 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : raise_bench.c
+ *
+ * Usage: Raise hand latency and false raises on synthetic gestures
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "motion_main_ctrl.h"
+
+//
+// Raise hand events of the motion algorithms on synthetic wrist gestures at
+// 25Hz, quantized to the GMA303 1/512 g:
+//  - raises from several poses to the Z axis within 10 to 25 degrees of the
+//    vertical, over 400 to 1000 ms with a minimum jerk profile and the
+//    hand lifted along the vertical, latency from the gesture start to the
+//    raise, and misses
+//  - gestures which are not a raise, raises per hour
+// and raises per hour along the logs, X,Y,Z in g, one stream each.
+// The raise events are compared with the raises on the orientation only,
+// ORIENT_Z_POS entered, as without MOTION_ALG_RAISE_PREDICT. A predicted
+// raise lowered again before ORIENT_Z_POS is a cancelled one. On the logs
+// the recorded raises are the ORIENT_Z_POS entries held LOG_RAISE_HOLD_MS,
+// looking at the watch, the gain of one is the time from the predicted
+// raise before it.
+//
+#define RATE_HZ        (25)
+#define PERIOD_MS      (1000 / RATE_HZ)
+#define MAX_SAMPLES    (1 << 20)
+#define PRE_MS         (2000)   //still at the start pose
+#define HOLD_MS        (2000)   //at the end pose, a raise after it is a miss
+#define SETTLE_MS      (2000)   //start of the streams, not counted
+#define TRIALS         (8)      //per pose and duration
+#define Deg2Rad        (0.017453292519943295)
+#define MAX_GAINS      (1 << 16)
+#define LOG_RAISE_HOLD_MS (1000)
+
+typedef struct{
+
+  const char *name;
+  double tilt, azimuth;         //start pose, up vector in degrees
+
+} raise_pose_t;
+
+typedef struct{
+
+  const char *name;
+  void (*gen)(double t, double *pUp, double *pLin);
+
+} raise_move_t;
+
+static const raise_pose_t poses[] = {
+  {"hanging", 95.0, 0.0},       //arm down, forearm along the up vector
+  {"side", 80.0, 20.0},
+  {"desk_y", 90.0, 90.0},       //forearm flat, watch facing sideways
+  {"lap", 70.0, 150.0},
+  {"desk_-y", 90.0, -90.0},
+  {"chest", 110.0, 0.0}         //hand on the chest, face toward the body
+};
+
+static const uint32_t durationsMs[] = {400, 500, 600, 800, 1000};
+
+static float_xyzt_t samples[MAX_SAMPLES];
+static uint32_t ui32Seed = 12345;
+static uint32_t ui32SampleCount;
+static uint32_t ui32CountFrom;   //first sample index counted
+
+//raises counted by run()
+static struct{
+
+  int32_t i32First;      //sample index of the first raise, -1 if none
+  uint32_t ui32Count;
+
+} raiseEvent, raiseOrient;
+static uint32_t ui32Cancelled;   //predicted raises never confirmed
+//recorded raises and gain in ms of the predicted ones, added by run()
+static uint32_t ui32LogRaiseCount;
+static int32_t logGain[MAX_GAINS];
+static uint32_t ui32LogGainCount;
+
+static double rnd(void)
+{
+
+  ui32Seed = ui32Seed * 1103515245u + 12345u;
+
+  return ((ui32Seed >> 8) & 0xFFFF) / 65536.0;
+}
+
+static void sph(double tilt, double azimuth, double *v)
+{
+
+  v[0] = sin(tilt * Deg2Rad) * cos(azimuth * Deg2Rad);
+  v[1] = sin(tilt * Deg2Rad) * sin(azimuth * Deg2Rad);
+  v[2] = cos(tilt * Deg2Rad);
+}
+
+//rotate v about the unit axis k by a, Rodrigues
+static void rot(const double *v, const double *k, double a, double *r)
+{
+
+  double c = cos(a), s = sin(a);
+  double d = k[0] * v[0] + k[1] * v[1] + k[2] * v[2];
+
+  r[0] = v[0] * c + (k[1] * v[2] - k[2] * v[1]) * s + k[0] * d * (1 - c);
+  r[1] = v[1] * c + (k[2] * v[0] - k[0] * v[2]) * s + k[1] * d * (1 - c);
+  r[2] = v[2] * c + (k[0] * v[1] - k[1] * v[0]) * s + k[2] * d * (1 - c);
+}
+
+//sample: up vector in g, linear acceleration, tremor, 1/512 g codes
+static void push(const double *up, const double *lin)
+{
+
+  int32_t i;
+  double v;
+
+  if(ui32SampleCount >= MAX_SAMPLES)
+    return;
+
+  for(i = 0; i < 3; ++i){
+    v = up[i] + lin[i] + (rnd() - 0.5) * 0.04;
+    samples[ui32SampleCount].v[i] = (float)(lrint(v * 512.0) / 512.0);
+  }
+  samples[ui32SampleCount].u.t = 0.f;
+  ++ui32SampleCount;
+}
+
+static void hold(const double *up, uint32_t ms)
+{
+
+  static const double lin[3] = {0.0, 0.0, 0.0};
+  uint32_t i;
+
+  for(i = 0; i < ms / PERIOD_MS; ++i)
+    push(up, lin);
+}
+
+//minimum jerk rotation from u0 to u1, hand lifted with a peak of linG
+static void turn(const double *u0, const double *u1, uint32_t ms, double linG)
+{
+
+  double k[3], u[3], lin[3], d, a, tau, s, acc;
+  uint32_t i, n = ms / PERIOD_MS;
+
+  k[0] = u0[1] * u1[2] - u0[2] * u1[1];
+  k[1] = u0[2] * u1[0] - u0[0] * u1[2];
+  k[2] = u0[0] * u1[1] - u0[1] * u1[0];
+  d = sqrt(k[0] * k[0] + k[1] * k[1] + k[2] * k[2]);
+  a = atan2(d, u0[0] * u1[0] + u0[1] * u1[1] + u0[2] * u1[2]);
+  for(i = 0; i < 3; ++i)
+    k[i] /= d;
+
+  for(i = 1; i <= n; ++i){
+    tau = (double)i / n;
+    s = tau * tau * tau * (10 - 15 * tau + 6 * tau * tau);
+    //s'' of the minimum jerk, peak 5.77 at tau = 0.21
+    acc = (60 * tau - 180 * tau * tau + 120 * tau * tau * tau) / 5.77;
+    rot(u0, k, s * a, u);
+    //hand lifted, along the vertical
+    lin[0] = u[0] * acc * linG;
+    lin[1] = u[1] * acc * linG;
+    lin[2] = u[2] * acc * linG;
+    push(u, lin);
+  }
+}
+
+//
+// Gestures which are not a raise, up vector and linear acceleration at t in s
+//
+static void gen_walk(double t, double *up, double *lin)
+{
+
+  //arm swing about the axis of the watch face, bounce along the vertical
+  static const double k[3] = {0.0, 0.0, 1.0};
+  double u0[3];
+
+  sph(95.0, 10.0, u0);
+  rot(u0, k, 25.0 * Deg2Rad * sin(2 * M_PI * 0.9 * t), up);
+  lin[0] = 0.25 * sin(2 * M_PI * 1.8 * t) * up[0];
+  lin[1] = 0.25 * sin(2 * M_PI * 1.8 * t) * up[1];
+  lin[2] = 0.25 * sin(2 * M_PI * 1.8 * t) * up[2];
+}
+
+static void gen_run(double t, double *up, double *lin)
+{
+
+  //forearm bent, watch facing sideways
+  static const double k[3] = {0.0, 0.0, 1.0};
+  double u0[3];
+
+  sph(90.0, 60.0, u0);
+  rot(u0, k, 40.0 * Deg2Rad * sin(2 * M_PI * 1.4 * t), up);
+  lin[0] = 0.7 * sin(2 * M_PI * 2.8 * t) * up[0] + 0.3 * sin(2 * M_PI * 1.4 * t);
+  lin[1] = 0.7 * sin(2 * M_PI * 2.8 * t) * up[1];
+  lin[2] = 0.7 * sin(2 * M_PI * 2.8 * t) * up[2];
+}
+
+static void gen_shake(double t, double *up, double *lin)
+{
+
+  sph(90.0, 0.0, up);
+  lin[0] = 1.5 * sin(2 * M_PI * 3.0 * t);
+  lin[1] = 0.5 * sin(2 * M_PI * 3.0 * t + 1.0);
+  lin[2] = 0.8 * sin(2 * M_PI * 3.0 * t + 2.0);
+}
+
+static void gen_desk(double t, double *up, double *lin)
+{
+
+  //typing, face up, small moves
+  sph(35.0 + 10.0 * sin(2 * M_PI * 0.2 * t), 180.0 + 20.0 * sin(2 * M_PI * 0.13 * t), up);
+  lin[0] = 0.05 * sin(2 * M_PI * 4.0 * t);
+  lin[1] = 0.05 * sin(2 * M_PI * 5.0 * t);
+  lin[2] = 0.0;
+}
+
+static void gen_wrist_roll(double t, double *up, double *lin)
+{
+
+  //turning a door knob, forearm flat, +/-30 to 60 degrees about the
+  //forearm at 0.5 and 1Hz, 100 s each
+  static const double k[3] = {1.0, 0.0, 0.0};
+  static const double amp[] = {30.0, 45.0, 60.0};
+  int32_t seg = (int32_t)(t / 100.0) % 6;
+  double u0[3];
+
+  sph(90.0, 90.0, u0);
+  rot(u0, k, -amp[seg % 3] * Deg2Rad * sin(2 * M_PI * (seg < 3 ? 0.5 : 1.0) * t), up);
+  lin[0] = lin[1] = lin[2] = 0.0;
+}
+
+static void gen_sleep(double t, double *up, double *lin)
+{
+
+  //turning over in bed every 20 s, between the side and the back
+  double ph = fmod(t, 20.0);
+  double s = ph < 1.0 ? ph : ph < 10.0 ? 1.0 : ph < 11.0 ? 11.0 - ph : 0.0;
+
+  sph(90.0 - 40.0 * s, 90.0, up);
+  lin[0] = lin[1] = lin[2] = 0.0;
+}
+
+static const raise_move_t moves[] = {
+  {"walk", gen_walk},
+  {"run", gen_run},
+  {"shake", gen_shake},
+  {"desk", gen_desk},
+  {"wrist_roll", gen_wrist_roll},
+  {"sleep", gen_sleep}
+};
+
+static void bench_event_handler(motion_algorithm_t event, int32_t i32Data)
+{
+
+}
+
+//ORIENT_Z_POS left after ui32Samples, gain -1 if not predicted
+static void log_raise(uint32_t ui32Samples, int32_t i32Gain)
+{
+
+  if(ui32Samples * PERIOD_MS < LOG_RAISE_HOLD_MS)
+    return;
+
+  ++ui32LogRaiseCount;
+  if(i32Gain >= 0 && ui32LogGainCount < MAX_GAINS)
+    logGain[ui32LogGainCount++] = i32Gain;
+}
+
+//run a fresh context over the samples, raises from ui32CountFrom
+static void run(void)
+{
+
+  static motion_ctx_t ctx;
+  motion_event_t event;
+  motion_orient_t orient_pre = ORIENT_NA;
+  int8_t isConfirmed = 0;
+  int32_t i32Predicted = -1;     //sample of the pending predicted raise
+  int32_t i32Entry = -1, i32EntryGain = -1;
+  uint32_t i;
+
+  motion_alg_init_ctx(&ctx, bench_event_handler);
+  motion_alg_enable_ctx(&ctx, MOTION_ALG_RAISE_HAND, 1);
+
+  raiseEvent.i32First = raiseOrient.i32First = -1;
+  raiseEvent.ui32Count = raiseOrient.ui32Count = 0;
+  ui32Cancelled = 0;
+
+  for(i = 0; i < ui32SampleCount; ++i){
+
+    motion_alg_process_data_ctx(&ctx, samples[i]);
+
+    if(ctx.orientState == ORIENT_Z_POS){
+      isConfirmed = 1;
+      if(orient_pre != ORIENT_Z_POS && i >= ui32CountFrom){
+	if(raiseOrient.i32First < 0)
+	  raiseOrient.i32First = (int32_t)i;
+	++raiseOrient.ui32Count;
+	i32Entry = (int32_t)i;
+	i32EntryGain = (i32Predicted >= 0) ? ((int32_t)i - i32Predicted) * PERIOD_MS : -1;
+      }
+      i32Predicted = -1;
+    }
+    else if(orient_pre == ORIENT_Z_POS && i32Entry >= 0){
+      log_raise(i - (uint32_t)i32Entry, i32EntryGain);
+      i32Entry = -1;
+    }
+    orient_pre = ctx.orientState;
+
+    while(motion_alg_pop_event_ctx(&ctx, &event)){
+
+      if(event.alg != MOTION_ALG_RAISE_HAND)
+	continue;
+
+      if(event.i32Data == 1){
+	isConfirmed = (ctx.orientState == ORIENT_Z_POS);
+	if(!isConfirmed)
+	  i32Predicted = (int32_t)i;
+	if(i >= ui32CountFrom){
+	  if(raiseEvent.i32First < 0)
+	    raiseEvent.i32First = (int32_t)i;
+	  ++raiseEvent.ui32Count;
+	}
+      }
+      else{
+	if(!isConfirmed && i >= ui32CountFrom)
+	  ++ui32Cancelled;
+	i32Predicted = -1;
+      }
+    }
+  }
+
+  if(i32Entry >= 0)
+    log_raise(ui32SampleCount - (uint32_t)i32Entry, i32EntryGain);
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+
+  return *(const int32_t*)a - *(const int32_t*)b;
+}
+
+//median and 90th percentile, sorts the values
+static void print_pct(int32_t *pVal, uint32_t n)
+{
+
+  qsort(pVal, n, sizeof(pVal[0]), cmp_int);
+  printf("  %5d %5d", n ? pVal[n / 2] : -1, n ? pVal[n * 9 / 10] : -1);
+}
+
+int main(int argc, char **argv)
+{
+
+#define RAISE_TRIALS (sizeof(poses) / sizeof(poses[0]) * sizeof(durationsMs) / sizeof(durationsMs[0]) * TRIALS)
+  static int32_t latOrient[RAISE_TRIALS], latEvent[RAISE_TRIALS], gain[RAISE_TRIALS];
+  static int32_t allOrient[RAISE_TRIALS], allEvent[RAISE_TRIALS], allGain[RAISE_TRIALS];
+  uint32_t p, d, j, n, m, nLat, nMiss, nExtra, nAll = 0, nAllMiss = 0;
+  uint32_t ui32Samples, ui32Raises, ui32Orients, ui32Cancels;
+  int32_t i32End;
+  double u0[3], u1[3], u[3], lin[3], dHours;
+  float x, y, z;
+  int k;
+  FILE *fp;
+
+  printf("prediction %s, latency from the gesture start in ms\n",
+	 MOTION_ALG_RAISE_PREDICT ? "on" : "off");
+
+  //raises
+  printf("%-10s %4s %4s  %11s  %11s  %11s\n", "raise", "n", "miss",
+	 "orient", "event", "gain");
+  printf("%-10s %4s %4s  %5s %5s  %5s %5s  %5s %5s\n", "", "", "",
+	 "med", "p90", "med", "p90", "med", "p90");
+  for(p = 0; p < sizeof(poses) / sizeof(poses[0]); ++p){
+
+    nLat = nMiss = nExtra = 0;
+    for(d = 0; d < sizeof(durationsMs) / sizeof(durationsMs[0]); ++d)
+      for(j = 0; j < TRIALS; ++j){
+
+	ui32SampleCount = 0;
+	sph(poses[p].tilt + 10.0 * (rnd() - 0.5), poses[p].azimuth + 30.0 * (rnd() - 0.5), u0);
+	sph(10.0 + 15.0 * rnd(), 180.0 + 60.0 * (rnd() - 0.5), u1);
+	hold(u0, PRE_MS);
+	ui32CountFrom = ui32SampleCount;
+	turn(u0, u1, durationsMs[d], 0.1 + 0.3 * rnd());
+	hold(u1, HOLD_MS);
+	i32End = (int32_t)ui32SampleCount;
+	//lowered back, a second raise is an extra one
+	turn(u1, u0, 600, 0.2);
+	hold(u0, HOLD_MS);
+
+	run();
+	if(raiseEvent.i32First < 0 || raiseEvent.i32First >= i32End ||
+	   raiseOrient.i32First < 0 || raiseOrient.i32First >= i32End)
+	  ++nMiss;
+	else{
+	  latOrient[nLat] = (raiseOrient.i32First - (int32_t)ui32CountFrom + 1) * PERIOD_MS;
+	  latEvent[nLat] = (raiseEvent.i32First - (int32_t)ui32CountFrom + 1) * PERIOD_MS;
+	  gain[nLat] = latOrient[nLat] - latEvent[nLat];
+	  allOrient[nAll] = latOrient[nLat];
+	  allEvent[nAll] = latEvent[nLat];
+	  allGain[nAll] = gain[nLat];
+	  ++nLat;
+	  ++nAll;
+	}
+	if(raiseEvent.ui32Count > 1)
+	  nExtra += raiseEvent.ui32Count - 1;
+      }
+
+    printf("%-10s %4u %4u", poses[p].name, nLat + nMiss, nMiss);
+    print_pct(latOrient, nLat);
+    print_pct(latEvent, nLat);
+    print_pct(gain, nLat);
+    printf("  extra raises %u\n", nExtra);
+    nAllMiss += nMiss;
+  }
+
+  printf("%-10s %4u %4u", "all", nAll + nAllMiss, nAllMiss);
+  print_pct(allOrient, nAll);
+  print_pct(allEvent, nAll);
+  print_pct(allGain, nAll);
+  printf("\n");
+
+  //not a raise, 10 minutes each
+  printf("%-10s %8s %8s %9s  per hour\n", "not_raise", "orient", "event", "cancelled");
+  for(m = 0; m < sizeof(moves) / sizeof(moves[0]); ++m){
+
+    ui32SampleCount = 0;
+    for(n = 0; n < 600 * RATE_HZ; ++n){
+      moves[m].gen((double)n / RATE_HZ, u, lin);
+      push(u, lin);
+    }
+
+    ui32CountFrom = SETTLE_MS / PERIOD_MS;
+    run();
+    printf("%-10s %8.1f %8.1f %9.1f\n", moves[m].name,
+	   raiseOrient.ui32Count * 6.0, raiseEvent.ui32Count * 6.0, ui32Cancelled * 6.0);
+  }
+
+  //logs, one stream each
+  ui32Samples = ui32Raises = ui32Orients = ui32Cancels = 0;
+  ui32LogRaiseCount = ui32LogGainCount = 0;
+  for(k = 1; k < argc; ++k){
+
+    if((fp = fopen(argv[k], "r")) == NULL){
+      fprintf(stderr, "can't read %s\n", argv[k]);
+      return 1;
+    }
+    ui32SampleCount = 0;
+    while(ui32SampleCount < MAX_SAMPLES && fscanf(fp, " %f , %f , %f", &x, &y, &z) == 3){
+      samples[ui32SampleCount].u.x = x;
+      samples[ui32SampleCount].u.y = y;
+      samples[ui32SampleCount].u.z = z;
+      samples[ui32SampleCount].u.t = 0.f;
+      ++ui32SampleCount;
+    }
+    fclose(fp);
+
+    ui32CountFrom = 0;
+    run();
+    ui32Samples += ui32SampleCount;
+    ui32Orients += raiseOrient.ui32Count;
+    ui32Raises += raiseEvent.ui32Count;
+    ui32Cancels += ui32Cancelled;
+  }
+
+  if(ui32Samples > 0){
+    dHours = (double)ui32Samples / RATE_HZ / 3600.0;
+    printf("%-10s %8.1f %8.1f %9.1f  %.2f h\n", "logs",
+	   ui32Orients / dHours, ui32Raises / dHours, ui32Cancels / dHours, dHours);
+    printf("recorded raises %u, predicted %u (%.1f%%), gain med p90 in ms",
+	   ui32LogRaiseCount, ui32LogGainCount,
+	   ui32LogRaiseCount ? 100.0 * ui32LogGainCount / ui32LogRaiseCount : 0.0);
+    print_pct(logGain, ui32LogGainCount);
+    printf("\n");
+  }
+
+  return 0;
+}
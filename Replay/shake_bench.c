@@ -0,0 +1,345 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : shake_bench.c
+ *
+ * Usage: Shake detector core against the per-axis reference, bit-exactness and cost
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "iir_filter.h"
+#include "motion_period.h"
+#include "motion_shake.h"
+#include "motion_mag_run.h"
+
+//
+// The three uses of the shake detector in motion_main_ctrl.c and
+// motion_sleep_cycle.c at 25Hz: shake on the high-pass filtered data,
+// sedentary and sleep movement on the magnitude^2 of the activity
+// high-pass output, in the X only, which the threshold run detector of
+// motion_mag_run.c replaces.
+// processShake(), the six faces as branch-free lanes on integer keys,
+// runs against the original per-axis detector on floats.
+//
+#define ALPHA_SHAKE     (0.4f)
+#define ALPHA_ACTIVITY  (0.9f)
+#define MAX_SAMPLES     (1 << 20)
+#define BENCH_REPEAT    (4)
+
+typedef struct{
+
+  const char *name;
+  float th[3];
+  int32_t dur[3], cnt[3], tmo[3], en[3];
+  int8_t isMag2;
+
+} shake_bench_config_t;
+
+static const shake_bench_config_t benchConfigs[] = {
+  {"shake", {0.7f, 0.7f, 0.7f}, {1, 1, 1}, {2, 2, 2}, {38, 38, 38}, {1, 1, 1}, 0},
+  {"sedentary", {0.8f * 0.8f, 0, 0}, {2, 0, 0}, {40, 0, 0}, {750, 0, 0}, {1, 0, 0}, 1},
+  {"sleep", {0.4f * 0.4f, 0, 0}, {2, 0, 0}, {1, 0, 0}, {MAX_DURATION, 0, 0}, {1, 0, 0}, 1}
+};
+
+#define BENCH_CONFIG_COUNT (sizeof(benchConfigs) / sizeof(benchConfigs[0]))
+
+//
+// Reference: the per-axis shake detector the lanes replace, 3 axes x
+// 2 faces with a branch per state, same layout as the original
+// motion_shake_param_t
+//
+typedef struct{
+
+  float_xyzt_t shakeThresholdInG;
+  raw_data_xyzt_t shakeDuration;
+  raw_data_xyzt_t shakeCount;
+  raw_data_xyzt_t shakeTimeOutDuration;
+  raw_data_xyzt_t shakeEnable;
+  int32_t shakeEvent;
+
+  raw_data_xyzt_t stateDuration[2];
+  raw_data_xyzt_t stateCount[2];
+  raw_data_xyzt_t stateTimeOutDuration[2];
+  raw_data_xyzt_t flagToCount[2];
+
+} shake_ref_t;
+
+static void ref_reset_states(shake_ref_t *pParam, int32_t face, int32_t axis)
+{
+
+  pParam->stateDuration[face].v[axis] = 0;
+  pParam->stateCount[face].v[axis] = 0;
+  pParam->stateTimeOutDuration[face].v[axis] = 0;
+  pParam->flagToCount[face].v[axis] = 0;
+}
+
+//not inlined, a call per sample like processShake()
+__attribute__((noinline)) static int32_t ref_process(shake_ref_t *pParam, float_xyzt_t gVal)
+{
+
+  int32_t i, j, i32Event = EVENT_SHAKE_NONE;
+
+  for(i = 0; i < 3; ++i){
+
+    if(pParam->shakeEnable.v[i] == 0) continue;
+
+    if(gVal.v[i] >= pParam->shakeThresholdInG.v[i])
+      pParam->stateDuration[0].v[i] += 1;
+    else
+      pParam->stateDuration[0].v[i] = 0;
+
+    if(gVal.v[i] <= -pParam->shakeThresholdInG.v[i])
+      pParam->stateDuration[1].v[i] += 1;
+    else
+      pParam->stateDuration[1].v[i] = 0;
+
+    for(j = 0; j < 2; ++j){
+
+      if((pParam->stateDuration[j].v[i] == 1) && (pParam->stateCount[j].v[i] == 0))
+	pParam->stateTimeOutDuration[j].v[i] = 0;
+
+      if(pParam->stateDuration[j].v[i] == 1)
+	pParam->flagToCount[j].v[i] = 1;
+
+      if(pParam->stateDuration[j].v[i] >= pParam->shakeDuration.v[i]
+	 && pParam->flagToCount[j].v[i] == 1){
+	pParam->stateCount[j].v[i] += 1;
+	pParam->flagToCount[j].v[i] = 0;
+      }
+
+      if(pParam->stateCount[j].v[i] >= pParam->shakeCount.v[i]
+	 && pParam->stateDuration[j].v[i] == 0){
+	i32Event |= 1 << (2 * i + j);
+	ref_reset_states(pParam, j, i);
+      }
+
+      if(pParam->stateTimeOutDuration[j].v[i] >= pParam->shakeTimeOutDuration.v[i])
+	ref_reset_states(pParam, j, i);
+      else
+	pParam->stateTimeOutDuration[j].v[i] += 1;
+    }
+  }
+
+  pParam->shakeEvent = i32Event;
+
+  return i32Event;
+}
+
+static void ref_init(shake_ref_t *pParam, const shake_bench_config_t *pConfig)
+{
+
+  int32_t i;
+
+  memset(pParam, 0, sizeof(*pParam));
+  for(i = 0; i < 3; ++i){
+    pParam->shakeThresholdInG.v[i] = pConfig->th[i];
+    pParam->shakeDuration.v[i] = pConfig->dur[i];
+    pParam->shakeCount.v[i] = pConfig->cnt[i];
+    pParam->shakeTimeOutDuration.v[i] = pConfig->tmo[i];
+    pParam->shakeEnable.v[i] = pConfig->en[i];
+  }
+}
+
+//reference counter as seen by the 16-bit saturating counters
+static int32_t sat16(int32_t val)
+{
+
+  return (val > SHAKE_COUNTER_MAX) ? SHAKE_COUNTER_MAX : val;
+}
+
+static void shake_init(motion_shake_param_t *pParam, const shake_bench_config_t *pConfig)
+{
+
+  shakeInit(pParam, MOTION_ALG_REF_PERIOD_MS);
+  setShakeThreshold(pParam, pConfig->th[0], pConfig->th[1], pConfig->th[2], X_AXIS | Y_AXIS | Z_AXIS);
+  setShakeDuration(pParam, pConfig->dur[0], pConfig->dur[1], pConfig->dur[2], X_AXIS | Y_AXIS | Z_AXIS);
+  setShakeCount(pParam, pConfig->cnt[0], pConfig->cnt[1], pConfig->cnt[2], X_AXIS | Y_AXIS | Z_AXIS);
+  setShakeTimeOutDuration(pParam, pConfig->tmo[0], pConfig->tmo[1], pConfig->tmo[2], X_AXIS | Y_AXIS | Z_AXIS);
+  setShakeEnable(pParam, pConfig->en[0], pConfig->en[1], pConfig->en[2], X_AXIS | Y_AXIS | Z_AXIS);
+}
+
+static void mag_run_init(motion_mag_run_t *pParam, const shake_bench_config_t *pConfig)
+{
+
+  magRunInit(pParam, pConfig->th[0], pConfig->dur[0], pConfig->cnt[0], pConfig->tmo[0]);
+}
+
+//0 if the states of one lane match the reference
+static int32_t lane_cmp(const shake_ref_t *pRef, int32_t lane,
+			int32_t dur, int32_t cnt, int32_t tmo, int32_t flag)
+{
+
+  int32_t face = lane & 1, axis = lane >> 1;
+
+  return dur != sat16(pRef->stateDuration[face].v[axis]) ||
+    cnt != sat16(pRef->stateCount[face].v[axis]) ||
+    tmo != sat16(pRef->stateTimeOutDuration[face].v[axis]) ||
+    flag != pRef->flagToCount[face].v[axis];
+}
+
+static float_xyzt_t rawSamples[MAX_SAMPLES];
+static float_xyzt_t inputs[MAX_SAMPLES];
+static int32_t refEvents[MAX_SAMPLES];
+
+static double now_ns(void)
+{
+
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+
+  uint32_t c, n = 0, i, j, ui32Events, ui32Mismatch, ui32Failed = 0;
+  int32_t i32Sink = 0, i32Event;
+  int k;
+  FILE *fp;
+  iir_hpf_xyz_t hpf;
+  float_xyzt_t hp;
+  shake_ref_t ref;
+  motion_shake_param_t shake;
+  motion_mag_run_t magRun;
+  double t0, dRefNs, dShakeNs, dMagNs;
+
+  if(argc < 2){
+    fprintf(stderr, "usage: %s LOG.csv...\n", argv[0]);
+    return 1;
+  }
+
+  //all the logs back to back, X,Y,Z in g at 25Hz
+  for(k = 1; k < argc; ++k){
+
+    if((fp = fopen(argv[k], "r")) == NULL){
+      fprintf(stderr, "can't read %s\n", argv[k]);
+      return 1;
+    }
+    while(n < MAX_SAMPLES &&
+	  fscanf(fp, " %f , %f , %f", &rawSamples[n].v[0], &rawSamples[n].v[1], &rawSamples[n].v[2]) == 3)
+      ++n;
+    fclose(fp);
+  }
+
+  printf("%u samples\n%-10s %8s %10s %10s %10s %9s\n", n,
+	 "config", "events", "ref_ns", "shake_ns", "mag_ns", "mismatch");
+
+  for(c = 0; c < BENCH_CONFIG_COUNT; ++c){
+
+    const shake_bench_config_t *pConfig = &benchConfigs[c];
+
+    iirHpfXyzInit(&hpf);
+    for(i = 0; i < n; ++i){
+      filterHpfXyz(rawSamples[i].v, hp.v, pConfig->isMag2 ? ALPHA_ACTIVITY : ALPHA_SHAKE, &hpf);
+      if(pConfig->isMag2){
+	inputs[i].v[0] = hp.v[0] * hp.v[0] + hp.v[1] * hp.v[1] + hp.v[2] * hp.v[2];
+	inputs[i].v[1] = inputs[i].v[2] = 0.f;
+      }
+      else
+	inputs[i] = hp;
+    }
+
+    //bit-exactness, event and states on every sample, the magnitude
+    //configs run the threshold run detector too, against the X positive
+    //face
+    ref_init(&ref, pConfig);
+    shake_init(&shake, pConfig);
+    mag_run_init(&magRun, pConfig);
+    ui32Events = ui32Mismatch = 0;
+    for(i = 0; i < n; ++i){
+
+      refEvents[i] = ref_process(&ref, inputs[i]);
+      ui32Events += (refEvents[i] != EVENT_SHAKE_NONE);
+
+      if(pConfig->isMag2){
+	i32Event = processMagRun(&magRun, inputs[i].v[0]) ? EVENT_SHAKE_X_POS : EVENT_SHAKE_NONE;
+	if(i32Event != refEvents[i] ||
+	   lane_cmp(&ref, 0, magRun.stateDuration, magRun.stateCount,
+		    magRun.stateTimeOutDuration, magRun.flagToCount))
+	  ++ui32Mismatch;
+      }
+
+      i32Event = processShake(&shake, inputs[i]);
+      if(i32Event != refEvents[i])
+	++ui32Mismatch;
+      for(j = 0; j < SHAKE_FACES; ++j)
+	if(lane_cmp(&ref, j, shake.stateDuration[j], shake.stateCount[j],
+		    shake.stateTimeOutDuration[j], (shake.flagToCount >> j) & 1)){
+	  ++ui32Mismatch;
+	  break;
+	}
+    }
+
+    //cost per sample
+    t0 = now_ns();
+    for(k = 0; k < BENCH_REPEAT; ++k){
+      ref_init(&ref, pConfig);
+      for(i = 0; i < n; ++i)
+	i32Sink += ref_process(&ref, inputs[i]);
+    }
+    dRefNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+    t0 = now_ns();
+    for(k = 0; k < BENCH_REPEAT; ++k){
+      shake_init(&shake, pConfig);
+      for(i = 0; i < n; ++i)
+	i32Sink += processShake(&shake, inputs[i]);
+    }
+    dShakeNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+    printf("%-10s %8u %10.2f %10.2f ", pConfig->name, ui32Events, dRefNs, dShakeNs);
+
+    if(pConfig->isMag2){
+      t0 = now_ns();
+      for(k = 0; k < BENCH_REPEAT; ++k){
+	mag_run_init(&magRun, pConfig);
+	for(i = 0; i < n; ++i)
+	  i32Sink += processMagRun(&magRun, inputs[i].v[0]);
+      }
+      dMagNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+      printf("%10.2f ", dMagNs);
+    }
+    else
+      printf("%10s ", "-");
+
+    printf("%9u\n", ui32Mismatch);
+    ui32Failed += ui32Mismatch;
+  }
+
+  //RAM of the three detectors of a context: shake, sedentary and sleep
+  printf("\nRAM (bytes)       before  after\n"
+	 "shake             %6u %6u\n"
+	 "sedentary, sleep  %6u %6u (each)\n"
+	 "total             %6u %6u\n",
+	 (unsigned)sizeof(shake_ref_t), (unsigned)sizeof(motion_shake_param_t),
+	 (unsigned)sizeof(shake_ref_t), (unsigned)sizeof(motion_mag_run_t),
+	 (unsigned)(3 * sizeof(shake_ref_t)),
+	 (unsigned)(sizeof(motion_shake_param_t) + 2 * sizeof(motion_mag_run_t)));
+
+  return (ui32Failed != 0 || i32Sink == 0x7FFFFFFF);
+}
@@ -0,0 +1,277 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : telemetry_decode.c
+ *
+ * Usage: Host decoder of the binary telemetry frames
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file telemetry_decode.c
+ *  @brief Decode a telemetry capture back to text, one line per frame
+ *
+ *  Usage: telemetry_decode [capture], reads the stdin without argument.
+ *  Bytes outside valid frames, like the text printed before the motion
+ *  demo starts, are skipped. Frames with a bad CRC are counted and skipped.
+ *  Raw sample blocks are printed one "tick Raw:x,y,z" line per sample, event
+ *  packets one line per event, like the single event frames. Fall captures
+ *  are printed one "tick Capture:x,y,z" line per sample, after a line giving
+ *  the size and the trigger tick of the capture.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "telemetry.h"
+#include "sample_codec.h"
+#include "event_batch.h"
+#include "sample_capture.h"
+
+static const char* algName[] = {
+  "Step", "Calorie", "Activity", "Fall", "Shake",
+  "Raise hand", "Flip", "Sedentary", "Sleep cycle", "Step cadence", "Tilt"
+};
+
+#define ALG_NAME_COUNT (sizeof(algName) / sizeof(algName[0]))
+
+static uint32_t ui32FrameCount = 0;
+static uint32_t ui32CrcErrorCount = 0;
+static uint32_t ui32MalformedCount = 0;
+static uint32_t ui32SkippedBytes = 0;
+static uint32_t ui32SampleCount = 0;
+static uint32_t ui32SampleBytes = 0;
+static uint32_t ui32EventPacketCount = 0;
+static uint32_t ui32EventCount = 0;
+static uint32_t ui32CaptureCount = 0;
+static uint32_t ui32CaptureSampleCount = 0;
+
+/*!
+ * @brief Print one event
+ *
+ * @param ui32Alg Algorithm bit index
+ * @param i32Data Event value
+ * @param ui32Index Sample index
+ *
+ * @return None
+ */
+static void print_event(uint32_t ui32Alg, int32_t i32Data, uint32_t ui32Index)
+{
+
+  if(ui32Alg < ALG_NAME_COUNT)
+    printf("%u %s:%d\n", ui32Index, algName[ui32Alg], i32Data);
+  else
+    printf("%u Unknown event %u:%d\n", ui32Index, ui32Alg, i32Data);
+}
+
+/*!
+ * @brief Print one frame
+ *
+ * @param ui8Type Frame type
+ * @param pPayload Payload
+ * @param ui32Len Payload bytes
+ *
+ * @return 1 for success, 0 if the payload is malformed
+ */
+static int8_t decode_frame(uint8_t ui8Type, const uint8_t *pPayload, uint32_t ui32Len)
+{
+
+  uint32_t ui32Pos = 0, ui32Alg, ui32Index, ui32Val, i;
+  int32_t i32Data;
+  int16_t samples[SAMPLE_CODEC_BLOCK][3];
+  motion_event_t events[EVENT_BATCH_MAX_EVENTS];
+  sample_capture_header_t header;
+  sample_capture_xyz_t captured[SAMPLE_CAPTURE_FRAME_SAMPLES];
+
+  switch(ui8Type){
+  case TELEMETRY_TYPE_EVENT:
+    if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Alg) ||
+       !telemetryGetS32(pPayload, ui32Len, &ui32Pos, &i32Data) ||
+       !telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Index))
+      return 0;
+    print_event(ui32Alg, i32Data, ui32Index);
+    ++ui32EventCount;
+    break;
+
+  case TELEMETRY_TYPE_STATE:
+    if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Index))
+      return 0;
+    printf("%u State", ui32Index);
+    for(i = 0; ui32Pos < ui32Len; ++i){
+      if(!telemetryGetS32(pPayload, ui32Len, &ui32Pos, &i32Data))
+	return 0;
+      printf(" %s:%d", (i < ALG_NAME_COUNT) ? algName[i] : "?", i32Data);
+    }
+    printf("\n");
+    break;
+
+  case TELEMETRY_TYPE_METRICS:
+    if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Val))
+      return 0;
+    if(ui32Val == TELEMETRY_METRICS_SAMPLE_FIFO)
+      printf("Metrics samples capacity,tick,pending,high water,overrun,missed,max lag,period ms:");
+    else if(ui32Val == TELEMETRY_METRICS_EVENT_QUEUE)
+      printf("Metrics events capacity,pending,high water,overflow,max push cycles:");
+    else if(ui32Val == TELEMETRY_METRICS_TELEMETRY)
+      printf("Metrics telemetry dropped:");
+    else if(ui32Val == TELEMETRY_METRICS_EVENT_BATCH)
+      printf("Metrics event packets packets,events,full,timeout,urgent,forced,"
+	     "min,mean,max latency ms,latency histogram:");
+    else if(ui32Val == TELEMETRY_METRICS_CAPTURE)
+      printf("Metrics capture capacity,bytes,samples/KB,pre,post,captures,busy,held,clamped:");
+    else
+      printf("Metrics %u:", ui32Val);
+    while(ui32Pos < ui32Len){
+      if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Val))
+	return 0;
+      printf(" %u", ui32Val);
+    }
+    printf("\n");
+    break;
+
+  case TELEMETRY_TYPE_SAMPLES:
+    i32Data = sampleCodecDecode(pPayload, ui32Len, &ui32Index, samples);
+    if(i32Data < 0)
+      return 0;
+    for(i = 0; i < (uint32_t)i32Data; ++i)
+      printf("%u Raw:%d,%d,%d\n", ui32Index + i, samples[i][0], samples[i][1], samples[i][2]);
+    ui32SampleCount += (uint32_t)i32Data;
+    ui32SampleBytes += ui32Len + 4;
+    break;
+
+  case TELEMETRY_TYPE_EVENT_BATCH:
+    i32Data = eventBatchDecode(pPayload, ui32Len, events);
+    if(i32Data < 0)
+      return 0;
+    for(i = 0; i < (uint32_t)i32Data; ++i)
+      print_event((uint32_t)__builtin_ctz(events[i].alg), events[i].i32Data, events[i].ui32SampleIndex);
+    ++ui32EventPacketCount;
+    ui32EventCount += (uint32_t)i32Data;
+    break;
+
+  case TELEMETRY_TYPE_CAPTURE:
+    i32Data = sampleCaptureDecode(pPayload, ui32Len, &header, captured);
+    if(i32Data < 0)
+      return 0;
+    if(header.ui32Offset == 0){
+      printf("%u Capture:%u samples, trigger at %u\n",
+	     header.ui32FirstTick, header.ui32Count, header.ui32TriggerTick);
+      ++ui32CaptureCount;
+    }
+    for(i = 0; i < (uint32_t)i32Data; ++i)
+      printf("%u Capture:%d,%d,%d\n", header.ui32FirstTick + header.ui32Offset + i,
+	     captured[i].x, captured[i].y, captured[i].z);
+    ui32CaptureSampleCount += (uint32_t)i32Data;
+    break;
+
+  default:
+    printf("Unknown frame type %u, %u bytes\n", ui8Type, ui32Len);
+    break;
+  }
+
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+
+  FILE *pIn = stdin;
+  uint8_t *pData = NULL, *pTmp;
+  size_t size = 0, capacity = 0, n;
+  size_t pos = 0, frameLen;
+
+  if(argc > 1){
+    pIn = fopen(argv[1], "rb");
+    if(pIn == NULL){
+      fprintf(stderr, "Cannot open %s\n", argv[1]);
+      return 1;
+    }
+  }
+
+  //Load the whole capture
+  do{
+
+    if(size == capacity){
+      capacity = (capacity == 0) ? 65536 : capacity * 2;
+      pTmp = realloc(pData, capacity);
+      if(pTmp == NULL){
+	fprintf(stderr, "Out of memory\n");
+	free(pData);
+	return 1;
+      }
+      pData = pTmp;
+    }
+
+    n = fread(pData + size, 1, capacity - size, pIn);
+    size += n;
+
+  }while(n > 0);
+
+  if(pIn != stdin)
+    fclose(pIn);
+
+  while(pos + 4 <= size){
+
+    if(pData[pos] != TELEMETRY_SYNC || pData[pos + 2] > TELEMETRY_PAYLOAD_MAX){
+      ++ui32SkippedBytes;
+      ++pos;
+      continue;
+    }
+
+    frameLen = pData[pos + 2] + 4;
+    if(pos + frameLen > size)
+      break;
+
+    if(telemetryCrc8(&pData[pos + 1], frameLen - 2) != pData[pos + frameLen - 1]){
+      //not a frame or a damaged one, resync on the next sync byte
+      ++ui32CrcErrorCount;
+      ++ui32SkippedBytes;
+      ++pos;
+      continue;
+    }
+
+    ++ui32FrameCount;
+    if(!decode_frame(pData[pos + 1], &pData[pos + 3], pData[pos + 2]))
+      ++ui32MalformedCount;
+
+    pos += frameLen;
+  }
+
+  ui32SkippedBytes += size - pos;
+
+  fprintf(stderr, "# frames:%u crc errors:%u malformed:%u skipped bytes:%u\n",
+	  ui32FrameCount, ui32CrcErrorCount, ui32MalformedCount, ui32SkippedBytes);
+
+  if(ui32SampleCount > 0)
+    fprintf(stderr, "# raw samples:%u frame bytes:%u, %.2f bytes/sample\n",
+	    ui32SampleCount, ui32SampleBytes, (double)ui32SampleBytes / ui32SampleCount);
+
+  if(ui32EventPacketCount > 0)
+    fprintf(stderr, "# events:%u event packets:%u, %.2f events/packet\n",
+	    ui32EventCount, ui32EventPacketCount, (double)ui32EventCount / ui32EventPacketCount);
+
+  if(ui32CaptureCount > 0)
+    fprintf(stderr, "# captures:%u captured samples:%u\n", ui32CaptureCount, ui32CaptureSampleCount);
+
+  free(pData);
+
+  return 0;
+}
@@ -0,0 +1,209 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : tilt_bench.c
+ *
+ * Usage: Accuracy and cost of the CORDIC tilt angles
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "motion_features.h"
+#include "motion_tilt.h"
+
+//
+// Pitch, roll and tilt of processTilt() against libm in double, over
+// directions on the sphere at several magnitudes and along the logs,
+// and the cost of both per call. The roll is not checked within 1 degree
+// of a pitch of +/-90, where it has no meaning.
+//
+#define SWEEP_STEPS    (360)
+#define MAX_SAMPLES    (1 << 20)
+#define BENCH_REPEAT   (4)
+#define Rad2Deg        (57.29577951308232)
+
+typedef struct{
+
+  double maxErr[3];
+  double sumErr2[3];
+  uint32_t count[3];
+
+} tilt_err_t;
+
+static float_xyzt_t samples[MAX_SAMPLES];
+
+static double now_ns(void)
+{
+
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void err_add(tilt_err_t *pErr, int32_t i, double dRef, int16_t i16Angle)
+{
+
+  double d = (double)i16Angle / TILT_ANGLE_SCALE - dRef;
+
+  //roll wraps around at +/-180
+  if(d > 180.0)
+    d -= 360.0;
+  else if(d < -180.0)
+    d += 360.0;
+
+  d = fabs(d);
+  if(d > pErr->maxErr[i])
+    pErr->maxErr[i] = d;
+  pErr->sumErr2[i] += d * d;
+  ++pErr->count[i];
+}
+
+static void check(tilt_err_t *pErr, const float_xyzt_t *pgVal)
+{
+
+  double x = pgVal->u.x, y = pgVal->u.y, z = pgVal->u.z;
+  double dPitch = atan2(x, sqrt(y * y + z * z)) * Rad2Deg;
+  motion_features_t feat;
+  motion_tilt_param_t tilt;
+
+  featuresInit(&feat, 40);
+  featuresUpdate(&feat, pgVal);
+  tiltInit(&tilt);
+  if(!processTilt(&tilt, &feat))
+    return;
+
+  err_add(pErr, 0, dPitch, tilt.tilt.i16Pitch);
+  if(fabs(dPitch) < 89.0)
+    err_add(pErr, 1, atan2(y, z) * Rad2Deg, tilt.tilt.i16Roll);
+  err_add(pErr, 2, atan2(sqrt(x * x + y * y), z) * Rad2Deg, tilt.tilt.i16Tilt);
+}
+
+static void err_print(const char *pName, const tilt_err_t *pErr)
+{
+
+  static const char *angleName[] = {"pitch", "roll", "tilt"};
+  int32_t i;
+
+  for(i = 0; i < 3; ++i)
+    printf("%-10s %-6s %9u %10.4f %10.4f\n", pName, angleName[i], pErr->count[i],
+	   pErr->maxErr[i], pErr->count[i] ? sqrt(pErr->sumErr2[i] / pErr->count[i]) : 0.0);
+}
+
+//libm in float, what the CORDIC replaces
+__attribute__((noinline)) static void ref_tilt(const float_xyzt_t *pgVal, motion_tilt_t *pTilt)
+{
+
+  float x = pgVal->u.x, y = pgVal->u.y, z = pgVal->u.z;
+
+  pTilt->i16Pitch = (int16_t)lrintf(atan2f(x, sqrtf(y * y + z * z)) * (float)Rad2Deg * TILT_ANGLE_SCALE);
+  pTilt->i16Roll = (int16_t)lrintf(atan2f(y, z) * (float)Rad2Deg * TILT_ANGLE_SCALE);
+  pTilt->i16Tilt = (int16_t)lrintf(atan2f(sqrtf(x * x + y * y), z) * (float)Rad2Deg * TILT_ANGLE_SCALE);
+}
+
+int main(int argc, char **argv)
+{
+
+  static const float mags[] = {0.01f, 0.1f, 1.0f, 8.0f};
+  uint32_t n = 0, i, j, m;
+  int32_t i32Sink = 0;
+  int k;
+  double theta, phi;
+  float x, y, z;
+  FILE *fp;
+  tilt_err_t err;
+  float_xyzt_t g;
+  motion_features_t feat;
+  motion_tilt_param_t tilt;
+  motion_tilt_t ref;
+  double t0, dRefNs, dNewNs;
+
+  printf("%-10s %-6s %9s %10s %10s\n", "input", "angle", "samples", "max_deg", "rms_deg");
+
+  //directions on the sphere
+  memset(&err, 0, sizeof(err));
+  for(m = 0; m < sizeof(mags) / sizeof(mags[0]); ++m)
+    for(i = 0; i <= SWEEP_STEPS; ++i)
+      for(j = 0; j < 2 * SWEEP_STEPS; ++j){
+	theta = M_PI * i / SWEEP_STEPS;
+	phi = M_PI * j / SWEEP_STEPS;
+	g.u.x = mags[m] * sin(theta) * cos(phi);
+	g.u.y = mags[m] * sin(theta) * sin(phi);
+	g.u.z = mags[m] * cos(theta);
+	check(&err, &g);
+      }
+  err_print("sphere", &err);
+
+  //logs back to back, X,Y,Z in g
+  for(k = 1; k < argc; ++k){
+
+    if((fp = fopen(argv[k], "r")) == NULL){
+      fprintf(stderr, "can't read %s\n", argv[k]);
+      return 1;
+    }
+    while(n < MAX_SAMPLES && fscanf(fp, " %f , %f , %f", &x, &y, &z) == 3){
+      samples[n].u.x = x;
+      samples[n].u.y = y;
+      samples[n].u.z = z;
+      ++n;
+    }
+    fclose(fp);
+  }
+
+  if(n == 0)
+    return 0;
+
+  memset(&err, 0, sizeof(err));
+  for(i = 0; i < n; ++i)
+    check(&err, &samples[i]);
+  err_print("logs", &err);
+
+  //cost per call
+  featuresInit(&feat, 40);
+  tiltInit(&tilt);
+  t0 = now_ns();
+  for(k = 0; k < BENCH_REPEAT; ++k)
+    for(i = 0; i < n; ++i){
+      ref_tilt(&samples[i], &ref);
+      i32Sink += ref.i16Tilt;
+    }
+  dRefNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+  t0 = now_ns();
+  for(k = 0; k < BENCH_REPEAT; ++k)
+    for(i = 0; i < n; ++i){
+      featuresUpdate(&feat, &samples[i]);
+      processTilt(&tilt, &feat);
+      i32Sink += tilt.tilt.i16Tilt;
+    }
+  dNewNs = (now_ns() - t0) / ((double)n * BENCH_REPEAT);
+
+  printf("cost per call: libm float %.2f ns, CORDIC %.2f ns\n", dRefNs, dNewNs);
+
+  return i32Sink == 0x7FFFFFFF;
+}
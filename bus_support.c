@@ -54,6 +54,7 @@ s8 bus_init_I2C(bus_support_t* pbus, app_twi_t* p_app_twi, u8 u8DevAddr){
   pbus->u8DevAddr = u8DevAddr;
   pbus->bus_read = app_twi_perform_multi_read; 
   pbus->bus_write = app_twi_perform_multi_write;
+  pbus->bus_schedule_read = app_twi_schedule_multi_read;
   return 0;
 
 }
@@ -44,6 +44,7 @@
 //I2C bus read write function definition
 #define BUS_RD_FUNC_PTR ret_code_t(*bus_read)(app_twi_t*, u8, u8, u8*, u8)
 #define BUS_WR_FUNC_PTR ret_code_t(*bus_write)(app_twi_t*, u8, u8, u8*, u8)
+#define BUS_SCHED_RD_FUNC_PTR ret_code_t(*bus_schedule_read)(app_twi_t*, u8, u8, u8*, u8, app_twi_callback_t, void*)
 #define BUS_READ_FUNC(p_app_twi, u8DevAddr, u8RegAddr, pu8RegData, u8Len) bus_read(p_app_twi, u8DevAddr, u8RegAddr, pu8RegData, u8Len)
 #define BUS_WRITE_FUNC(p_app_twi, u8DevAddr, u8RegAddr, pu8RegData, u8Len) bus_write(p_app_twi, u8DevAddr, u8RegAddr, pu8RegData, u8Len)
 
@@ -52,6 +53,7 @@ typedef struct {
   u8 u8DevAddr;
   BUS_WR_FUNC_PTR;
   BUS_RD_FUNC_PTR;
+  BUS_SCHED_RD_FUNC_PTR; //non-blocking read, the callback runs in the TWI interrupt
 } bus_support_t;
 
 /*!
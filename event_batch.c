@@ -0,0 +1,316 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : event_batch.c
+ *
+ * Usage: Batching of motion events into telemetry packets
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "event_batch.h"
+
+//Worst case payload: first index, then 3 varints of up to 5 bytes per event
+#define EVENT_BYTES_MAX (15)
+_Static_assert(5 + EVENT_BATCH_MAX_EVENTS * EVENT_BYTES_MAX <= TELEMETRY_PAYLOAD_MAX,
+	       "EVENT_BATCH_MAX_EVENTS too large for TELEMETRY_PAYLOAD_MAX");
+
+/*!
+ * @brief Histogram bin of a latency
+ *
+ * @param ui32Ms Latency in ms
+ *
+ * @return Bin index
+ */
+static uint32_t latencyBin(uint32_t ui32Ms)
+{
+
+  uint32_t ui32Bin;
+
+  if(ui32Ms == 0)
+    return 0;
+
+  ui32Bin = 32 - (uint32_t)__builtin_clz(ui32Ms);
+
+  return (ui32Bin < EVENT_BATCH_LATENCY_BINS) ? ui32Bin : EVENT_BATCH_LATENCY_BINS - 1;
+}
+
+/*!
+ * @brief Initialize an empty batch, all algorithms at normal priority
+ *
+ * @param pBatch Pointer to the batch
+ * @param ui32MaxEvents Events per packet, 1 to EVENT_BATCH_MAX_EVENTS
+ * @param ui32MaxLatencyMs Longest time an event waits in the batch, in ms
+ *
+ * @return None
+ */
+void eventBatchInit(event_batch_t *pBatch, uint32_t ui32MaxEvents, uint32_t ui32MaxLatencyMs)
+{
+
+  uint32_t i;
+
+  if(ui32MaxEvents < 1) ui32MaxEvents = 1;
+  if(ui32MaxEvents > EVENT_BATCH_MAX_EVENTS) ui32MaxEvents = EVENT_BATCH_MAX_EVENTS;
+
+  pBatch->ui32MaxEvents = ui32MaxEvents;
+  pBatch->ui32MaxLatencyMs = ui32MaxLatencyMs;
+  pBatch->ui32UrgentMask = 0;
+  pBatch->ui32Count = 0;
+  pBatch->isUrgent = 0;
+  pBatch->ui64LatencySum = 0;
+
+  pBatch->stats.ui32PacketCount = 0;
+  pBatch->stats.ui32EventCount = 0;
+  pBatch->stats.ui32FullCount = 0;
+  pBatch->stats.ui32TimeoutCount = 0;
+  pBatch->stats.ui32UrgentCount = 0;
+  pBatch->stats.ui32ForcedCount = 0;
+  pBatch->stats.ui32LatencyMin = UINT32_MAX;
+  pBatch->stats.ui32LatencyMean = 0;
+  pBatch->stats.ui32LatencyMax = 0;
+  for(i = 0; i < EVENT_BATCH_LATENCY_BINS; ++i)
+    pBatch->stats.latencyHist[i] = 0;
+}
+
+/*!
+ * @brief Set the priority of algorithms
+ *
+ * @param pBatch Pointer to the batch
+ * @param algMask A bit-or (|) combination of motion_algorithm_t
+ * @param priority Priority of their events
+ *
+ * @return None
+ */
+void eventBatchSetPriority(event_batch_t *pBatch, int32_t algMask, event_batch_priority_t priority)
+{
+
+  if(priority == EVENT_BATCH_PRIORITY_URGENT)
+    pBatch->ui32UrgentMask |= (uint32_t)algMask;
+  else
+    pBatch->ui32UrgentMask &= ~(uint32_t)algMask;
+}
+
+/*!
+ * @brief Add an event to the pending packet
+ *
+ * @param pBatch Pointer to the batch, the pending packet not full
+ * @param pEvent Pointer to the event
+ * @param ui32NowMs Current time in ms
+ *
+ * @return 1 if the packet is to be sent now, full or urgent, 0 otherwise
+ */
+int8_t eventBatchAdd(event_batch_t *pBatch, const motion_event_t *pEvent, uint32_t ui32NowMs)
+{
+
+  pBatch->events[pBatch->ui32Count] = *pEvent;
+  pBatch->addedMs[pBatch->ui32Count] = ui32NowMs;
+  ++pBatch->ui32Count;
+
+  if((uint32_t)pEvent->alg & pBatch->ui32UrgentMask)
+    pBatch->isUrgent = 1;
+
+  return (pBatch->isUrgent || pBatch->ui32Count >= pBatch->ui32MaxEvents);
+}
+
+/*!
+ * @brief Check if the oldest pending event has waited the max latency
+ *
+ * @param pBatch Pointer to the batch
+ * @param ui32NowMs Current time in ms
+ *
+ * @return 1 if the packet is to be sent now, 0 otherwise
+ */
+int8_t eventBatchIsDue(const event_batch_t *pBatch, uint32_t ui32NowMs)
+{
+
+  return (pBatch->ui32Count > 0 && ui32NowMs - pBatch->addedMs[0] >= pBatch->ui32MaxLatencyMs);
+}
+
+/*!
+ * @brief Check if the pending packet holds the max number of events
+ *
+ * @param pBatch Pointer to the batch
+ *
+ * @return 1 if no event can be added, 0 otherwise
+ */
+int8_t eventBatchIsFull(const event_batch_t *pBatch)
+{
+
+  return (pBatch->ui32Count >= pBatch->ui32MaxEvents);
+}
+
+/*!
+ * @brief Encode the pending packet into a TELEMETRY_TYPE_EVENT_BATCH frame,
+ *        the packet stays pending until eventBatchCommit()
+ *
+ * @param pBatch Pointer to the batch
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ *
+ * @return Number of events in the frame, 0 if none was pending and no
+ *         frame was started
+ */
+uint32_t eventBatchEncode(const event_batch_t *pBatch, telemetry_frame_t *pFrame)
+{
+
+  uint32_t i, ui32Count = pBatch->ui32Count, ui32Index;
+
+  if(ui32Count == 0)
+    return 0;
+
+  telemetryBegin(pFrame, TELEMETRY_TYPE_EVENT_BATCH);
+  ui32Index = pBatch->events[0].ui32SampleIndex;
+  telemetryPutU32(pFrame, ui32Index);
+
+  for(i = 0; i < ui32Count; ++i){
+
+    telemetryPutU32(pFrame, (uint32_t)__builtin_ctz(pBatch->events[i].alg));
+    telemetryPutS32(pFrame, pBatch->events[i].i32Data);
+    telemetryPutU32(pFrame, pBatch->events[i].ui32SampleIndex - ui32Index);
+    ui32Index = pBatch->events[i].ui32SampleIndex;
+  }
+
+  return ui32Count;
+}
+
+/*!
+ * @brief Count the pending packet as sent and empty it
+ *
+ * @param pBatch Pointer to the batch
+ * @param ui32NowMs Current time in ms
+ *
+ * @return Number of events sent
+ */
+uint32_t eventBatchCommit(event_batch_t *pBatch, uint32_t ui32NowMs)
+{
+
+  event_batch_stats_t *pStats = &pBatch->stats;
+  uint32_t i, ui32Count = pBatch->ui32Count, ui32Latency;
+
+  if(ui32Count == 0)
+    return 0;
+
+  //Reason, in order of precedence
+  if(pBatch->isUrgent)
+    ++pStats->ui32UrgentCount;
+  else if(ui32Count >= pBatch->ui32MaxEvents)
+    ++pStats->ui32FullCount;
+  else if(eventBatchIsDue(pBatch, ui32NowMs))
+    ++pStats->ui32TimeoutCount;
+  else
+    ++pStats->ui32ForcedCount;
+
+  for(i = 0; i < ui32Count; ++i){
+
+    ui32Latency = ui32NowMs - pBatch->addedMs[i];
+    if(ui32Latency < pStats->ui32LatencyMin) pStats->ui32LatencyMin = ui32Latency;
+    if(ui32Latency > pStats->ui32LatencyMax) pStats->ui32LatencyMax = ui32Latency;
+    pBatch->ui64LatencySum += ui32Latency;
+    ++pStats->latencyHist[latencyBin(ui32Latency)];
+  }
+
+  ++pStats->ui32PacketCount;
+  pStats->ui32EventCount += ui32Count;
+
+  pBatch->ui32Count = 0;
+  pBatch->isUrgent = 0;
+
+  return ui32Count;
+}
+
+/*!
+ * @brief Encode the pending packet into a TELEMETRY_TYPE_EVENT_BATCH frame
+ *        and empty it
+ *
+ * @param pBatch Pointer to the batch
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ * @param ui32NowMs Current time in ms
+ *
+ * @return Number of events in the frame, 0 if none was pending and no
+ *         frame was started
+ */
+uint32_t eventBatchFlush(event_batch_t *pBatch, telemetry_frame_t *pFrame, uint32_t ui32NowMs)
+{
+
+  if(eventBatchEncode(pBatch, pFrame) == 0)
+    return 0;
+
+  return eventBatchCommit(pBatch, ui32NowMs);
+}
+
+/*!
+ * @brief Get the batching statistics
+ *
+ * @param pBatch Pointer to the batch
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getEventBatchStats(const event_batch_t *pBatch, event_batch_stats_t *pStats)
+{
+
+  *pStats = pBatch->stats;
+
+  if(pStats->ui32EventCount == 0)
+    pStats->ui32LatencyMin = 0;
+  else
+    pStats->ui32LatencyMean = (uint32_t)(pBatch->ui64LatencySum / pStats->ui32EventCount);
+}
+
+/*!
+ * @brief Decode the payload of a TELEMETRY_TYPE_EVENT_BATCH frame
+ *
+ * @param pPayload Payload
+ * @param ui32Len Payload bytes
+ * @param events Array to store the events
+ *
+ * @return Number of events, -1 if the payload is malformed
+ */
+int32_t eventBatchDecode(const uint8_t *pPayload,
+			 uint32_t ui32Len,
+			 motion_event_t events[EVENT_BATCH_MAX_EVENTS])
+{
+
+  uint32_t ui32Pos = 0, ui32Index, ui32Alg, ui32Delta;
+  int32_t i32Count = 0;
+
+  if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Index))
+    return -1;
+
+  while(ui32Pos < ui32Len){
+
+    if(i32Count >= EVENT_BATCH_MAX_EVENTS)
+      return -1;
+
+    if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Alg) ||
+       !telemetryGetS32(pPayload, ui32Len, &ui32Pos, &events[i32Count].i32Data) ||
+       !telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Delta) ||
+       ui32Alg > 30)
+      return -1;
+
+    ui32Index += ui32Delta;
+    events[i32Count].alg = (int32_t)(1u << ui32Alg);
+    events[i32Count].ui32SampleIndex = ui32Index;
+    ++i32Count;
+  }
+
+  return (i32Count > 0) ? i32Count : -1;
+}
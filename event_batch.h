@@ -0,0 +1,209 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : event_batch.h
+ *
+ * Usage: Batching of motion events into telemetry packets
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file event_batch.h
+ *  @brief Motion events collected into TELEMETRY_TYPE_EVENT_BATCH frames,
+ *         so a burst of events costs one transmission
+ *
+ *  A packet is sent when it holds the configured number of events, when its
+ *  oldest event has waited the configured latency, or right away with an
+ *  urgent event, the events before it going out in the same packet.
+ *
+ *  Payload of a packet:
+ *  - sample index of the first event, unsigned varint
+ *  - each event: algorithm bit index (unsigned), data (signed), sample
+ *    index minus the one of the previous event (unsigned, 0 for the first)
+ */
+
+#ifndef __EVENT_BATCH_H__
+#define __EVENT_BATCH_H__
+
+#include <stdint.h>
+#include "telemetry.h"
+#include "motion_event_queue.h"
+
+//Max events per packet, the worst case payload fits TELEMETRY_PAYLOAD_MAX
+#define EVENT_BATCH_MAX_EVENTS     (8)
+
+//Latency histogram, bin 0 holds below 1ms, bin i holds [2^(i-1), 2^i) ms,
+//the last bin holds 2^(EVENT_BATCH_LATENCY_BINS-2) ms and above
+#define EVENT_BATCH_LATENCY_BINS   (12)
+
+typedef enum {
+  EVENT_BATCH_PRIORITY_NORMAL = 0,  //batched, sent within the max latency
+  EVENT_BATCH_PRIORITY_URGENT = 1   //sent right away
+} event_batch_priority_t;
+
+typedef struct{
+
+  uint32_t ui32PacketCount;
+  uint32_t ui32EventCount;
+  uint32_t ui32FullCount;       //packets sent full
+  uint32_t ui32TimeoutCount;    //packets sent on the max latency
+  uint32_t ui32UrgentCount;     //packets sent for an urgent event
+  uint32_t ui32ForcedCount;     //packets sent early by the caller
+  uint32_t ui32LatencyMin;      //ms from adding to sending an event
+  uint32_t ui32LatencyMean;
+  uint32_t ui32LatencyMax;
+  uint32_t latencyHist[EVENT_BATCH_LATENCY_BINS];
+
+} event_batch_stats_t;
+
+typedef struct{
+
+  //settings
+  uint32_t ui32MaxEvents;       //events per packet
+  uint32_t ui32MaxLatencyMs;    //longest wait of an event
+  uint32_t ui32UrgentMask;      //bit-or of the urgent algorithms
+
+  //pending packet
+  uint32_t ui32Count;
+  int8_t isUrgent;              //an urgent event is pending
+  motion_event_t events[EVENT_BATCH_MAX_EVENTS];
+  uint32_t addedMs[EVENT_BATCH_MAX_EVENTS];  //time each event was added
+
+  //statistics
+  uint64_t ui64LatencySum;
+  event_batch_stats_t stats;
+
+} event_batch_t;
+
+/*!
+ * @brief Initialize an empty batch, all algorithms at normal priority
+ *
+ * @param pBatch Pointer to the batch
+ * @param ui32MaxEvents Events per packet, 1 to EVENT_BATCH_MAX_EVENTS
+ * @param ui32MaxLatencyMs Longest time an event waits in the batch, in ms
+ *
+ * @return None
+ */
+void eventBatchInit(event_batch_t *pBatch, uint32_t ui32MaxEvents, uint32_t ui32MaxLatencyMs);
+
+/*!
+ * @brief Set the priority of algorithms
+ *
+ * @param pBatch Pointer to the batch
+ * @param algMask A bit-or (|) combination of motion_algorithm_t
+ * @param priority Priority of their events
+ *
+ * @return None
+ */
+void eventBatchSetPriority(event_batch_t *pBatch, int32_t algMask, event_batch_priority_t priority);
+
+/*!
+ * @brief Add an event to the pending packet
+ *
+ * @param pBatch Pointer to the batch, the pending packet not full
+ * @param pEvent Pointer to the event
+ * @param ui32NowMs Current time in ms
+ *
+ * @return 1 if the packet is to be sent now, full or urgent, 0 otherwise
+ */
+int8_t eventBatchAdd(event_batch_t *pBatch, const motion_event_t *pEvent, uint32_t ui32NowMs);
+
+/*!
+ * @brief Check if the oldest pending event has waited the max latency
+ *
+ * @param pBatch Pointer to the batch
+ * @param ui32NowMs Current time in ms
+ *
+ * @return 1 if the packet is to be sent now, 0 otherwise
+ */
+int8_t eventBatchIsDue(const event_batch_t *pBatch, uint32_t ui32NowMs);
+
+/*!
+ * @brief Check if the pending packet holds the max number of events
+ *
+ * @param pBatch Pointer to the batch
+ *
+ * @return 1 if no event can be added, 0 otherwise
+ */
+int8_t eventBatchIsFull(const event_batch_t *pBatch);
+
+/*!
+ * @brief Encode the pending packet into a TELEMETRY_TYPE_EVENT_BATCH frame,
+ *        the packet stays pending until eventBatchCommit()
+ *        For a link which may not take the whole frame: commit once it is
+ *        sent, else encode it again later
+ *
+ * @param pBatch Pointer to the batch
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ *
+ * @return Number of events in the frame, 0 if none was pending and no
+ *         frame was started
+ */
+uint32_t eventBatchEncode(const event_batch_t *pBatch, telemetry_frame_t *pFrame);
+
+/*!
+ * @brief Count the pending packet as sent and empty it
+ *
+ * @param pBatch Pointer to the batch
+ * @param ui32NowMs Current time in ms
+ *
+ * @return Number of events sent
+ */
+uint32_t eventBatchCommit(event_batch_t *pBatch, uint32_t ui32NowMs);
+
+/*!
+ * @brief Encode the pending packet into a TELEMETRY_TYPE_EVENT_BATCH frame
+ *        and empty it, eventBatchEncode() then eventBatchCommit()
+ *
+ * @param pBatch Pointer to the batch
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ * @param ui32NowMs Current time in ms
+ *
+ * @return Number of events in the frame, 0 if none was pending and no
+ *         frame was started
+ */
+uint32_t eventBatchFlush(event_batch_t *pBatch, telemetry_frame_t *pFrame, uint32_t ui32NowMs);
+
+/*!
+ * @brief Get the batching statistics
+ *
+ * @param pBatch Pointer to the batch
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getEventBatchStats(const event_batch_t *pBatch, event_batch_stats_t *pStats);
+
+/*!
+ * @brief Decode the payload of a TELEMETRY_TYPE_EVENT_BATCH frame
+ *
+ * @param pPayload Payload
+ * @param ui32Len Payload bytes
+ * @param events Array to store the events
+ *
+ * @return Number of events, -1 if the payload is malformed
+ */
+int32_t eventBatchDecode(const uint8_t *pPayload,
+			 uint32_t ui32Len,
+			 motion_event_t events[EVENT_BATCH_MAX_EVENTS]);
+
+#endif //__EVENT_BATCH_H__
@@ -42,8 +42,9 @@ void iirFilterInit(iir_filter_param_t *pParam)
 
   int32_t i;
 
-  pParam->isFirstY = pParam->lenCoeffA;
-  pParam->isFirstX = pParam->lenCoeffB - 1;
+  //Warm start the history from the first data
+  pParam->isFirstY = 1;
+  pParam->isFirstX = 1;
 
   //Initialize the history
   for(i = 0; i < pParam->dof * (pParam->lenCoeffB - 1); ++i)
@@ -70,23 +71,33 @@ void filterData(float *X_n, float *Y_n, iir_filter_param_t *pParam)
   int32_t lenB = pParam->lenCoeffB;
   int32_t colhY = lenA;
   int32_t colhX = lenB - 1;
+  float sumA, sumB, gainDC;
 
-  //Initialize the first colhX datas to histX
-  if(pParam->isFirstX > 0){
+  //Warm start, fill the history with the steady state of the first data
+  //as if the filter had been fed with it for ever
+  if(pParam->isFirstX > 0 || pParam->isFirstY > 0){
 
-    for(i = 0; i < pParam->dof; ++i)
-      pParam->histX[i * colhX] = X_n[i];
+    //DC gain = (b0 + b1 + ...) / (1 - a1 - a2 - ...)
+    sumB = 0.0f;
+    for(j = 0; j < lenB; ++j)
+      sumB += pParam->coeffB[j];
 
-    pParam->isFirstX -= 1;
-  }
+    sumA = 0.0f;
+    for(j = 0; j < lenA; ++j)
+      sumA += pParam->coeffA[j];
+
+    gainDC = (sumA != 1.0f) ? sumB / (1.0f - sumA) : 1.0f;
 
-  //Initialize the first colhY datas to histY
-  if(pParam->isFirstY > 0){
+    for(i = 0; i < pParam->dof; ++i){
 
-    for(i = 0; i < pParam->dof; ++i)
-      pParam->histY[i * colhY] = X_n[i];
+      for(j = 0; j < colhX; ++j)
+	pParam->histX[i * colhX + j] = X_n[i];
 
-    pParam->isFirstY -= 1;
+      for(j = 0; j < colhY; ++j)
+	pParam->histY[i * colhY + j] = gainDC * X_n[i];
+    }
+
+    pParam->isFirstX = pParam->isFirstY = 0;
   }
 
   // Data filtering
@@ -115,3 +126,23 @@ void filterData(float *X_n, float *Y_n, iir_filter_param_t *pParam)
     if(colhY > 0) pParam->histY[i * colhY] = Y_n[i];
   }
 }
+
+/*!
+ * @brief Intialize the XYZ first order high-pass filter
+ *
+ * @param pParam Pointer to the high-pass filter struct
+ *
+ * @return None
+ */
+void iirHpfXyzInit(iir_hpf_xyz_t *pParam)
+{
+
+  int32_t i;
+
+  //Warm start the history from the first data
+  pParam->isFirst = 1;
+
+  //Initialize the history
+  for(i = 0; i < 3; ++i)
+    pParam->histX[i] = pParam->histY[i] = 0.0;
+}
@@ -30,6 +30,8 @@
 #ifndef __IIR_FILTER_H__
 #define __IIR_FILTER_H__
 
+#include <stdint.h>
+
 typedef struct{
 
   int32_t isFirstX;
@@ -45,6 +47,18 @@ typedef struct{
 
 } iir_filter_param_t;
 
+//
+// First order high-pass filter on XYZ data, specialized for
+//   coeffA = {alpha}, coeffB = {alpha, -alpha}, dof = 3
+//
+typedef struct{
+
+  int32_t isFirst;
+  float histX[3];  //{x_n-1} of each axis
+  float histY[3];  //{y_n-1} of each axis
+
+} iir_hpf_xyz_t;
+
 /*!
  * @brief Intialize IIR filter
  *
@@ -56,6 +70,9 @@ void iirFilterInit(iir_filter_param_t *pParam);
 
 /*!
  * @brief Filtering data
+ *        Generic filter of any order and number of axes. The tree filters
+ *        through filterHpfXyz(); this stays for other filters and as the
+ *        reference Replay/filter_bench checks filterHpfXyz() against.
  *
  * @param pData_in data input to the filter
  * @param pData_out data output form the filter
@@ -65,4 +82,64 @@ void iirFilterInit(iir_filter_param_t *pParam);
  */
 void filterData(float *pData_in, float *pData_out, iir_filter_param_t *pParam);
 
+/*!
+ * @brief Intialize the XYZ first order high-pass filter
+ *
+ * @param pParam Pointer to the high-pass filter struct
+ *
+ * @return None
+ */
+void iirHpfXyzInit(iir_hpf_xyz_t *pParam);
+
+/*!
+ * @brief Filtering XYZ data with the first order high-pass filter
+ *        Same result as filterData() with coeffA = {alpha} and
+ *        coeffB = {alpha, -alpha}, bit for bit, but the axis loop has a
+ *        constant bound and no coefficient arrays, so the kernel is fully
+ *        unrolled and inlined at the call site. alpha is the runtime value
+ *        of the processing rate, see MOTION_ALG_PERIOD_ALPHA().
+ *
+ * @param X_n data input to the filter, 3 floats
+ * @param Y_n data output form the filter, 3 floats
+ * @param alpha filter coefficient
+ * @param pParam Pointer to the high-pass filter struct
+ *
+ * @return None
+ */
+static inline void filterHpfXyz(const float *X_n,
+				float *Y_n,
+				const float alpha,
+				iir_hpf_xyz_t *pParam)
+{
+
+  int32_t i;
+  float x;
+
+  //Warm start, the steady state for a constant input x is
+  //x_n-1 = x and y_n-1 = 0, so the output is settled from the first data
+  if(pParam->isFirst){
+
+    for(i = 0; i < 3; ++i){
+      pParam->histX[i] = X_n[i];
+      pParam->histY[i] = 0.0f;
+    }
+
+    pParam->isFirst = 0;
+  }
+
+  for(i = 0; i < 3; ++i){
+
+    x = X_n[i];
+
+    //y_n = alpha * x_n - alpha * x_n-1 + alpha * y_n-1
+    Y_n[i] = alpha * x;
+    Y_n[i] += (-alpha) * pParam->histX[i];
+    Y_n[i] += alpha * pParam->histY[i];
+
+    //Update the history value
+    pParam->histX[i] = x;
+    pParam->histY[i] = Y_n[i];
+  }
+}
+
 #endif //__IIR_FILTER_H__
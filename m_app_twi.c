@@ -53,7 +53,7 @@ void app_twi_schedule_multi_device_multi_read(app_twi_t *p_app_twi,
 }
 
 //Schedule I2C multi read
-void app_twi_schedule_multi_read(app_twi_t *p_app_twi,
+ret_code_t app_twi_schedule_multi_read(app_twi_t *p_app_twi,
 				 uint8_t dev_addr,
 				 uint8_t reg_addr,
 				 uint8_t m_buffer[],
@@ -88,7 +88,8 @@ void app_twi_schedule_multi_read(app_twi_t *p_app_twi,
   transaction.p_transfers = transfers;
   transaction.number_of_transfers = sizeof(transfers)/sizeof(transfers[0]);
 
-  APP_ERROR_CHECK(app_twi_schedule(p_app_twi, &transaction));
+  //Called from interrupt handlers, let the caller handle a full queue
+  return app_twi_schedule(p_app_twi, &transaction);
 }
 
 //Schedule I2C multi write
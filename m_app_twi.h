@@ -17,7 +17,7 @@ void app_twi_schedule_multi_device_multi_read(app_twi_t *p_app_twi,
 					      app_twi_callback_t cb_fcn,
 					      void* p_user_data);
 
-void app_twi_schedule_multi_read(app_twi_t *p_app_twi,
+ret_code_t app_twi_schedule_multi_read(app_twi_t *p_app_twi,
 				 uint8_t dev_addr,
 				 uint8_t reg_addr,
 				 uint8_t m_buffer[],
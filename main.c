@@ -44,25 +44,75 @@
 #include "gSensor_autoNil.h"
 #include "motion_main_ctrl.h"
 #include "misc_util.h"
+#include "sample_fifo.h"
+#include "telemetry.h"
+#include "sample_codec.h"
+#include "event_batch.h"
+#include "sample_capture.h"
 
 #define STOP_NRT_TIMER(m_timer) (nrf_drv_timer_disable(&m_timer);nrf_drv_timer_uninit(&m_timer);)
 
 #define UART_TX_BUF_SIZE            256                  // UART TX buffer size
 #define UART_RX_BUF_SIZE            1                    // UART RX buffer size
+#define UART_TX_BYTES_PER_MS        11                   // 115200 baud, 10 bits per byte
 #define MAX_PENDING_TRANSACTIONS    5                    // TWI (I2C)
 #define APP_TIMER_PRESCALER_BSP     0                    // BSP buttons APP timer          
 #define APP_TIMER_OP_QUEUE_SIZE_BSP 2                    // BSP buttons APP timer
 #define DELAY_MS(ms)	            nrf_delay_ms(ms)
-#define SAMPLING_RATE_HZ            MOTION_ALG_DATA_RATE_HZ     //sensor sampling rate
+#define SAMPLING_RATE               MOTION_ALG_RATE_25HZ  //default sensor sampling rate
 #define ACC_LAYOUT_PATTERN          PAT6                 //accelerometer layout pattern
 
+//Report events, states and metrics as binary telemetry frames instead of text
+#ifndef TELEMETRY_BINARY
+#define TELEMETRY_BINARY            1
+#endif
+
+//Event packets: events per packet, max latency of an event
+#define EVENT_BATCH_EVENTS          EVENT_BATCH_MAX_EVENTS
+#define EVENT_BATCH_LATENCY_MS      (1000)
+
+//Raw samples sent after a fall: before and after the impact
+#define CAPTURE_PRE_MS              (4000)
+#define CAPTURE_POST_MS             (2000)
+_Static_assert(CAPTURE_POST_MS >= FALL_WAIT_MS + FALL_STILL_MS,
+	       "the post-trigger window must reach back to the impact");
+//Ticks of the last processed samples by sample index, low 16 bits, a power
+//of 2 reaching back to the impact of a fall popped behind a full sample FIFO
+#define MOTION_TICK_HISTORY         (256)
+_Static_assert(MOTION_TICK_HISTORY >= (FALL_WAIT_MS + FALL_STILL_MS) / MOTION_ALG_RATE_100HZ + SAMPLE_FIFO_SIZE,
+	       "the tick history must reach back to the impact");
+//Longest text capture lines, header and sample
+#define CAPTURE_TEXT_HEADER_MAX     (72)
+#define CAPTURE_TEXT_LINE_MAX       (48)
+
 
 const nrf_drv_timer_t m_timer_periodic_measure = NRF_DRV_TIMER_INSTANCE(0);
 static app_twi_t m_app_twi = APP_TWI_INSTANCE(0);
 static uint8_t ui8StartAutoNilFlag = 0;
-static uint8_t ui8PeriodicMeasureFlag = 0;
-static uint32_t ui32SamplingRateHz = SAMPLING_RATE_HZ;
-static float fTimeMs = 0.0f, fDeltaTus = 1000000.0f / SAMPLING_RATE_HZ;
+static uint8_t ui8ReportStatsFlag = 0;
+static uint8_t ui8ReportProfileFlag = 0;
+static uint8_t ui8ReportStateFlag = 0;
+static uint8_t ui8StreamRawFlag = 0;
+static uint8_t ui8RateChangeFlag = 0;
+static motion_alg_rate_t samplingRate = SAMPLING_RATE;
+static sample_fifo_t sampleFifo;
+static sample_codec_block_t rawBlock;
+static uint8_t ui8SampleReadBuf[GMA303_DATA_XYZT_LEN];
+static volatile uint8_t ui8SampleReadBusy = 0;
+static uint32_t ui32SampleReadTick = 0;
+static volatile uint32_t ui32ClockMs = 0;      //time in ms, at the sampling resolution
+#if TELEMETRY_BINARY
+static uint32_t ui32TelemetryDropCount = 0;
+static event_batch_t eventBatch;
+static uint8_t ui8EventBatchRetryFlag = 0;     //the pending packet was cut
+static uint32_t ui32EventBatchRetryMs = 0;     //time of the cut send
+#endif
+static sample_capture_t fallCapture;
+static uint32_t ui32CaptureOffset = 0;          //samples of the frozen capture sent
+static uint32_t ui32CaptureBudget = 0;          //UART bytes the capture may send now
+static uint32_t ui32CaptureBudgetMs = 0;        //time of the last budget update
+static uint8_t ui8CaptureSendFlag = 0;
+static uint16_t ui16MotionTicks[MOTION_TICK_HISTORY];
 static const char* activityStr[] = {"Stationary", "Walk", "?", "Run"};
 
 static void event_handler_uart(app_uart_evt_t * p_event){
@@ -78,6 +128,21 @@ static void event_handler_uart(app_uart_evt_t * p_event){
       if(cr == 'y' || cr == 'Y'){
 	ui8StartAutoNilFlag = 1;
       }
+      else if(cr == 's' || cr == 'S'){
+	ui8ReportStatsFlag = 1;
+      }
+      else if(cr == 'p' || cr == 'P'){
+	ui8ReportProfileFlag = 1;
+      }
+      else if(cr == 'g' || cr == 'G'){
+	ui8ReportStateFlag = 1;
+      }
+      else if(cr == 'r' || cr == 'R'){
+	ui8StreamRawFlag = !ui8StreamRawFlag;
+      }
+      else if(cr == 'f' || cr == 'F'){
+	ui8RateChangeFlag = 1;
+      }
     }
 
     break;
@@ -96,13 +161,460 @@ static void event_handler_uart(app_uart_evt_t * p_event){
   }
 }
 
+static void event_handler_sample_read(ret_code_t result, void* p_user_data)
+{
+
+  raw_data_xyzt_t rawData;
+
+  if(result == NRF_SUCCESS){
+    gma303_decode_data_xyzt(ui8SampleReadBuf, &rawData);
+    sampleFifoPush(&sampleFifo, &rawData, ui32SampleReadTick);
+  }
+  else
+    sampleFifoMissTick(&sampleFifo);
+
+  ui8SampleReadBusy = 0;
+}
+
 static void event_handler_timer_periodic_measure(nrf_timer_event_t event_type, void* p_context)
 {
-  //raise the flag
-  ui8PeriodicMeasureFlag = 1;
 
-  //update the time
-  fTimeMs += fDeltaTus / 1000.0F;
+  uint32_t ui32Tick = sampleFifoTick(&sampleFifo);
+
+  ui32ClockMs += (uint32_t)samplingRate;
+
+  //Start reading the sample of this tick, one read in flight at most
+  if(ui8SampleReadBusy){
+    sampleFifoMissTick(&sampleFifo);
+    return;
+  }
+
+  ui8SampleReadBusy = 1;
+  ui32SampleReadTick = ui32Tick;
+  if(gma303_schedule_read_data_xyzt(ui8SampleReadBuf, event_handler_sample_read, NULL) < 0){
+    ui8SampleReadBusy = 0;
+    sampleFifoMissTick(&sampleFifo);
+  }
+}
+
+static void event_handler_motion_alg(motion_algorithm_t event, int32_t i32Data);
+
+#if TELEMETRY_BINARY
+/*!
+ * @brief Send a telemetry frame over the UART
+ *        A frame not fitting in the UART FIFO is cut and counted as dropped,
+ *        the receiver skips it on the CRC
+ *
+ * @param pFrame Pointer to the frame
+ *
+ * @return 1 if the whole frame was queued, 0 otherwise
+ */
+static int8_t telemetry_send(telemetry_frame_t *pFrame)
+{
+
+  uint32_t i, ui32Len = telemetryEnd(pFrame);
+
+  for(i = 0; i < ui32Len; ++i){
+
+    if(app_uart_put(pFrame->buf[i]) != NRF_SUCCESS){
+      ++ui32TelemetryDropCount;
+      return 0;
+    }
+  }
+
+  return (ui32Len > 0) ? 1 : 0;
+}
+
+/*!
+ * @brief Send the pending event packet, empty it once the whole frame is
+ *        queued, a frame cut by a full FIFO is sent again on the next tick
+ *
+ * @return None
+ */
+static void event_batch_send(void)
+{
+
+  telemetry_frame_t frame;
+
+  if(eventBatchEncode(&eventBatch, &frame) == 0)
+    return;
+
+  if(telemetry_send(&frame)){
+    eventBatchCommit(&eventBatch, ui32ClockMs);
+    ui8EventBatchRetryFlag = 0;
+  }
+  else{
+    ui8EventBatchRetryFlag = 1;
+    ui32EventBatchRetryMs = ui32ClockMs;
+  }
+}
+
+/*!
+ * @brief Check if the pending event packet is to be sent, on the max
+ *        latency, or on the tick after a cut send
+ *
+ * @return 1 if the packet is to be sent now, 0 otherwise
+ */
+static int8_t event_batch_is_due(void)
+{
+
+  if(ui8EventBatchRetryFlag)
+    return (ui32ClockMs != ui32EventBatchRetryMs);
+
+  return eventBatchIsDue(&eventBatch, ui32ClockMs);
+}
+#endif
+
+/*!
+ * @brief Check if a motion event can be reported now, it waits in the
+ *        motion event queue while a full packet is not sent
+ *
+ * @return 1 if an event can be reported, 0 otherwise
+ */
+static int8_t event_report_ready(void)
+{
+
+#if TELEMETRY_BINARY
+  return !eventBatchIsFull(&eventBatch);
+#else
+  return 1;
+#endif
+}
+
+/*!
+ * @brief Set the capture windows in samples of the sampling rate
+ *
+ * @param rate Sampling rate
+ *
+ * @return None
+ */
+static void capture_set_window(motion_alg_rate_t rate)
+{
+
+  sampleCaptureSetWindow(&fallCapture,
+			 CAPTURE_PRE_MS / (uint32_t)rate,
+			 CAPTURE_POST_MS / (uint32_t)rate);
+  ui32CaptureOffset = 0;
+}
+
+/*!
+ * @brief Update the UART bytes the capture may send, at the UART rate up
+ *        to the size of the TX FIFO
+ *
+ * @return None
+ */
+static void capture_budget_update(void)
+{
+
+  uint32_t ui32Now = ui32ClockMs;
+  uint32_t ui32Ms = ui32Now - ui32CaptureBudgetMs;
+
+  ui32CaptureBudgetMs = ui32Now;
+
+  if(ui32Ms >= UART_TX_BUF_SIZE / UART_TX_BYTES_PER_MS)
+    ui32CaptureBudget = UART_TX_BUF_SIZE;
+  else
+    ui32CaptureBudget += ui32Ms * UART_TX_BYTES_PER_MS;
+
+  if(ui32CaptureBudget > UART_TX_BUF_SIZE)
+    ui32CaptureBudget = UART_TX_BUF_SIZE;
+}
+
+/*!
+ * @brief Send the next part of the frozen capture, release it when done
+ *        Paced by the UART rate, the offset only moves past the samples
+ *        queued whole, a frame cut by a full FIFO is sent again
+ *
+ * @return None
+ */
+static void capture_send(void)
+{
+
+  sample_capture_header_t header;
+  uint32_t ui32Count;
+#if TELEMETRY_BINARY
+  telemetry_frame_t frame;
+  uint32_t ui32Len;
+
+  capture_budget_update();
+
+  ui32Count = sampleCaptureEncode(&fallCapture, ui32CaptureOffset, &frame);
+  if(ui32Count > 0){
+
+    ui32Len = telemetryEnd(&frame);
+    if(ui32Len > ui32CaptureBudget)
+      return;
+
+    ui32CaptureBudget -= ui32Len;
+    if(!telemetry_send(&frame))
+      return;
+  }
+#else
+  const sample_capture_xyz_t *pSamples;
+  uint32_t i;
+  int iLen;
+
+  capture_budget_update();
+
+  sampleCaptureGetWindow(&fallCapture, &header);
+  if(ui32CaptureOffset == 0){
+
+    if(ui32CaptureBudget < CAPTURE_TEXT_HEADER_MAX + CAPTURE_TEXT_LINE_MAX)
+      return;
+
+    iLen = printf("Capture:%u samples from tick %u, fall at %u\n",
+		  (unsigned int)header.ui32Count,
+		  (unsigned int)header.ui32FirstTick,
+		  (unsigned int)header.ui32TriggerTick);
+    ui32CaptureBudget -= (iLen > 0) ? (uint32_t)iLen : 0;
+  }
+
+  ui32Count = sampleCaptureGetBlock(&fallCapture, ui32CaptureOffset, &pSamples);
+
+  //as many lines as the budget takes
+  for(i = 0; i < ui32Count && ui32CaptureBudget >= CAPTURE_TEXT_LINE_MAX; ++i){
+    iLen = printf("%u Capture:%d,%d,%d\n",
+		  (unsigned int)(header.ui32FirstTick + ui32CaptureOffset + i),
+		  (int)pSamples[i].x,
+		  (int)pSamples[i].y,
+		  (int)pSamples[i].z);
+    ui32CaptureBudget -= (iLen > 0) ? (uint32_t)iLen : 0;
+  }
+  ui32Count = i;
+#endif
+
+  ui32CaptureOffset += ui32Count;
+
+  if(ui32CaptureOffset >= sampleCaptureGetWindow(&fallCapture, &header)){
+    sampleCaptureRelease(&fallCapture);
+    ui32CaptureOffset = 0;
+  }
+}
+
+/*!
+ * @brief Trigger the fall capture on the impact
+ *        The fall is reported once the faller is still, the latency in
+ *        samples before the event sample, and the event is popped after the
+ *        samples queued behind it are processed. The capture holds one
+ *        sample per tick, so the trigger goes back by the ticks from the
+ *        impact sample to the last sample, missed ticks included.
+ *
+ * @param pEvent Fall event
+ *
+ * @return None
+ */
+static void capture_trigger_fall(const motion_event_t *pEvent)
+{
+
+  uint32_t ui32Last = motion_alg_get_sample_index();
+  uint32_t ui32Impact = pEvent->ui32SampleIndex -
+    (uint32_t)motion_alg_get_fall_latency() / (uint32_t)samplingRate;
+  uint32_t ui32Back = ui32Last - ui32Impact;
+
+  //Ticks from the impact sample, the samples when older than the history
+  if(ui32Back < MOTION_TICK_HISTORY)
+    ui32Back = (uint16_t)(ui16MotionTicks[ui32Last & (MOTION_TICK_HISTORY - 1)] -
+			  ui16MotionTicks[ui32Impact & (MOTION_TICK_HISTORY - 1)]);
+
+  sampleCaptureTrigger(&fallCapture, ui32Back);
+}
+
+static void report_motion_event(const motion_event_t *pEvent)
+{
+
+  if(pEvent->alg == MOTION_ALG_FALL)
+    capture_trigger_fall(pEvent);
+
+#if TELEMETRY_BINARY
+  //Sent in packets, when full, on the max latency, or with an urgent event
+  if(eventBatchAdd(&eventBatch, pEvent, ui32ClockMs))
+    event_batch_send();
+#else
+  event_handler_motion_alg((motion_algorithm_t)pEvent->alg, pEvent->i32Data);
+#endif
+}
+
+#if TELEMETRY_BINARY
+static void stream_raw_flush(void)
+{
+
+  telemetry_frame_t frame;
+
+  sampleCodecEncode(&rawBlock, &frame);
+  telemetry_send(&frame);
+}
+#endif
+
+static void stream_raw_sample(const sample_fifo_entry_t *pSample)
+{
+
+#if TELEMETRY_BINARY
+  //Send the block when full or on a missed tick, then start the next one
+  if(!sampleCodecAdd(&rawBlock, &pSample->rawData, pSample->ui32Tick)){
+    stream_raw_flush();
+    sampleCodecAdd(&rawBlock, &pSample->rawData, pSample->ui32Tick);
+  }
+
+  if(rawBlock.ui32Count == SAMPLE_CODEC_BLOCK)
+    stream_raw_flush();
+#else
+  printf("%u Raw:%d,%d,%d\n",
+	 (unsigned int)pSample->ui32Tick,
+	 (int)pSample->rawData.u.x,
+	 (int)pSample->rawData.u.y,
+	 (int)pSample->rawData.u.z);
+#endif
+}
+
+static void report_motion_state(void)
+{
+
+  uint32_t i;
+#if TELEMETRY_BINARY
+  telemetry_frame_t frame;
+  sample_fifo_stats_t stats;
+
+  getSampleFifoStats(&sampleFifo, &stats);
+
+  telemetryBegin(&frame, TELEMETRY_TYPE_STATE);
+  telemetryPutU32(&frame, stats.ui32Tick);
+  for(i = 0; i < MOTION_ALG_COUNT; ++i)
+    telemetryPutS32(&frame, motion_alg_get_state((motion_algorithm_t)(1 << i)));
+  telemetry_send(&frame);
+#else
+  for(i = 0; i < MOTION_ALG_COUNT; ++i)
+    printf("State %d:%d\n", 1 << i, (int)motion_alg_get_state((motion_algorithm_t)(1 << i)));
+#endif
+}
+
+static void report_sample_stats(void)
+{
+
+  sample_fifo_stats_t stats;
+  motion_event_queue_stats_t eventStats;
+  sample_capture_stats_t captureStats;
+#if TELEMETRY_BINARY
+  telemetry_frame_t frame;
+  event_batch_stats_t batchStats;
+  uint32_t i;
+#endif
+
+  getSampleFifoStats(&sampleFifo, &stats);
+  motion_alg_get_event_stats(&eventStats);
+  getSampleCaptureStats(&fallCapture, &captureStats);
+
+#if TELEMETRY_BINARY
+  telemetryBegin(&frame, TELEMETRY_TYPE_METRICS);
+  telemetryPutU32(&frame, TELEMETRY_METRICS_SAMPLE_FIFO);
+  telemetryPutU32(&frame, stats.ui32Capacity);
+  telemetryPutU32(&frame, stats.ui32Tick);
+  telemetryPutU32(&frame, stats.ui32Pending);
+  telemetryPutU32(&frame, stats.ui32HighWater);
+  telemetryPutU32(&frame, stats.ui32OverrunCount);
+  telemetryPutU32(&frame, stats.ui32MissedTickCount);
+  telemetryPutU32(&frame, stats.ui32LagMax);
+  telemetryPutU32(&frame, (uint32_t)samplingRate);
+  telemetry_send(&frame);
+
+  telemetryBegin(&frame, TELEMETRY_TYPE_METRICS);
+  telemetryPutU32(&frame, TELEMETRY_METRICS_EVENT_QUEUE);
+  telemetryPutU32(&frame, eventStats.ui32Capacity);
+  telemetryPutU32(&frame, eventStats.ui32Pending);
+  telemetryPutU32(&frame, eventStats.ui32HighWater);
+  telemetryPutU32(&frame, eventStats.ui32OverflowCount);
+  telemetryPutU32(&frame, eventStats.ui32EnqueueTimeMax);
+  telemetry_send(&frame);
+
+  telemetryBegin(&frame, TELEMETRY_TYPE_METRICS);
+  telemetryPutU32(&frame, TELEMETRY_METRICS_TELEMETRY);
+  telemetryPutU32(&frame, ui32TelemetryDropCount);
+  telemetry_send(&frame);
+
+  getEventBatchStats(&eventBatch, &batchStats);
+  telemetryBegin(&frame, TELEMETRY_TYPE_METRICS);
+  telemetryPutU32(&frame, TELEMETRY_METRICS_EVENT_BATCH);
+  telemetryPutU32(&frame, batchStats.ui32PacketCount);
+  telemetryPutU32(&frame, batchStats.ui32EventCount);
+  telemetryPutU32(&frame, batchStats.ui32FullCount);
+  telemetryPutU32(&frame, batchStats.ui32TimeoutCount);
+  telemetryPutU32(&frame, batchStats.ui32UrgentCount);
+  telemetryPutU32(&frame, batchStats.ui32ForcedCount);
+  telemetryPutU32(&frame, batchStats.ui32LatencyMin);
+  telemetryPutU32(&frame, batchStats.ui32LatencyMean);
+  telemetryPutU32(&frame, batchStats.ui32LatencyMax);
+  for(i = 0; i < EVENT_BATCH_LATENCY_BINS; ++i)
+    telemetryPutU32(&frame, batchStats.latencyHist[i]);
+  telemetry_send(&frame);
+
+  telemetryBegin(&frame, TELEMETRY_TYPE_METRICS);
+  telemetryPutU32(&frame, TELEMETRY_METRICS_CAPTURE);
+  telemetryPutU32(&frame, captureStats.ui32Capacity);
+  telemetryPutU32(&frame, captureStats.ui32Bytes);
+  telemetryPutU32(&frame, captureStats.ui32PerKb);
+  telemetryPutU32(&frame, captureStats.ui32PreSamples);
+  telemetryPutU32(&frame, captureStats.ui32PostSamples);
+  telemetryPutU32(&frame, captureStats.ui32CaptureCount);
+  telemetryPutU32(&frame, captureStats.ui32BusyCount);
+  telemetryPutU32(&frame, captureStats.ui32HeldCount);
+  telemetryPutU32(&frame, captureStats.ui32ClampCount);
+  telemetry_send(&frame);
+#else
+  printf("Events pending:%u/%u high water:%u overflow:%u max push:%u%s\n",
+	 (unsigned int)eventStats.ui32Pending,
+	 (unsigned int)eventStats.ui32Capacity,
+	 (unsigned int)eventStats.ui32HighWater,
+	 (unsigned int)eventStats.ui32OverflowCount,
+	 (unsigned int)eventStats.ui32EnqueueTimeMax,
+	 MOTION_PROFILE_UNIT);
+
+  printf("Samples tick:%u pending:%u/%u high water:%u overrun:%u missed:%u max lag:%u period:%ums\n",
+	 (unsigned int)stats.ui32Tick,
+	 (unsigned int)stats.ui32Pending,
+	 (unsigned int)stats.ui32Capacity,
+	 (unsigned int)stats.ui32HighWater,
+	 (unsigned int)stats.ui32OverrunCount,
+	 (unsigned int)stats.ui32MissedTickCount,
+	 (unsigned int)stats.ui32LagMax,
+	 (unsigned int)samplingRate);
+
+  printf("Capture capacity:%u samples in %u bytes, %u/KB window:%u+%u captures:%u busy:%u held:%u clamped:%u\n",
+	 (unsigned int)captureStats.ui32Capacity,
+	 (unsigned int)captureStats.ui32Bytes,
+	 (unsigned int)captureStats.ui32PerKb,
+	 (unsigned int)captureStats.ui32PreSamples,
+	 (unsigned int)captureStats.ui32PostSamples,
+	 (unsigned int)captureStats.ui32CaptureCount,
+	 (unsigned int)captureStats.ui32BusyCount,
+	 (unsigned int)captureStats.ui32HeldCount,
+	 (unsigned int)captureStats.ui32ClampCount);
+#endif
+}
+
+static void report_profile(void)
+{
+
+#if MOTION_ALG_PROFILE
+  uint32_t i;
+  const char *pName;
+  motion_profile_stats_t stats;
+
+  printf("Profile (%s): count min mean max p99\n", MOTION_PROFILE_UNIT);
+
+  for(i = 0; motion_alg_get_profile(i, &pName, &stats); ++i){
+
+    if(stats.ui32Count == 0) continue;
+
+    printf("%s: %u %u %u %u %u\n",
+	   pName,
+	   (unsigned int)stats.ui32Count,
+	   (unsigned int)stats.ui32Min,
+	   (unsigned int)stats.ui32Mean,
+	   (unsigned int)stats.ui32Max,
+	   (unsigned int)stats.ui32P99);
+  }
+#else
+  printf("Profiling disabled, build with MOTION_ALG_PROFILE=1\n");
+#endif
 }
 
 static void event_handler_motion_alg(motion_algorithm_t event, int32_t i32Data)
@@ -122,9 +634,8 @@ static void event_handler_motion_alg(motion_algorithm_t event, int32_t i32Data)
     printf("Activity:%d\n", i32Data);
     break;
   case MOTION_ALG_FALL:
-    //0: No falldown
-    //1: Falldown occur
-    printf("Fall:%d\n", i32Data);
+    //1: Falldown occur, once per fall
+    printf("Fall:%d, %dms after the impact\n", i32Data, (int)motion_alg_get_fall_latency());
     break;
   case MOTION_ALG_SHAKE:
     //1: X+
@@ -159,6 +670,10 @@ static void event_handler_motion_alg(motion_algorithm_t event, int32_t i32Data)
     //5: MOTION_SLEEP_CYCLE_NONE
     printf("Sleep cycle:%d\n", i32Data);
     break;
+  case MOTION_ALG_STEP:
+    //cadence in steps/min, 0: unknown
+    printf("Step cadence:%d\n", i32Data);
+    break;
   default:
     printf("Unknown event:%d\n", i32Data);
     break;
@@ -255,6 +770,55 @@ void init_timer_periodic_measure(uint32_t time_us,
 
 }
 
+/*!
+ * @brief Change the sampling rate, the samples taken at the old rate are
+ *        dropped and the motion algorithms start over at the new rate
+ *
+ * @param rate Sampling rate
+ *
+ * @return 1 for success, 0 if the motion algorithms do not support the rate,
+ *         the sampling rate is unchanged
+ */
+static int8_t set_sampling_rate(motion_alg_rate_t rate)
+{
+
+  uint32_t time_ticks;
+  sample_fifo_entry_t sample;
+
+  //Processing runs in the main loop, no sample is processed until we return
+  if(!motion_alg_set_rate(rate))
+    return 0;
+
+  nrf_drv_timer_disable(&m_timer_periodic_measure);
+
+  //Let the read in flight complete, then drop what is left
+  while(ui8SampleReadBusy);
+  while(sampleFifoPop(&sampleFifo, &sample));
+
+#if TELEMETRY_BINARY
+  if(rawBlock.ui32Count > 0)
+    stream_raw_flush();
+#endif
+
+  samplingRate = rate;
+  capture_set_window(rate);
+
+  time_ticks = nrf_drv_timer_us_to_ticks(&m_timer_periodic_measure, (uint32_t)rate * 1000);
+  nrf_drv_timer_extended_compare(&m_timer_periodic_measure,
+				 NRF_TIMER_CC_CHANNEL0,
+				 time_ticks,
+				 NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK,
+				 true);
+  nrf_drv_timer_clear(&m_timer_periodic_measure);
+  nrf_drv_timer_enable(&m_timer_periodic_measure);
+
+#if !TELEMETRY_BINARY
+  printf("Sampling period:%ums\n", (unsigned int)rate);
+#endif
+
+  return 1;
+}
+
 /*---------------------------------------------------------------------------------------------------------*/
 /*  Main Function                                                                                          */
 /*---------------------------------------------------------------------------------------------------------*/
@@ -263,7 +827,8 @@ int main(void)
 
   uint8_t i;
   bus_support_t gma303_bus;
-  raw_data_xyzt_t rawData;
+  sample_fifo_entry_t sample;
+  motion_event_t event;
   raw_data_xyzt_t offsetData;
   float_xyzt_t gVal;
   uint32_t ui32StepCount = 0, ui32StepCount_pre = 0;
@@ -306,10 +871,13 @@ int main(void)
   printf("Offset_XYZ=%d,%d,%d\n", offsetData.u.x, offsetData.u.y, offsetData.u.z);
 
   // Pedometer Demo
-  printf("Motion demo\n\n");
+  printf("Motion demo\n");
+  printf("Press s for the sampling statistics, p for the profile, g for the states\n");
+  printf("Press r to start or stop the raw sample streaming, f to change the sampling rate\n\n");
 
   //Initialize the motion algorithm main control
   motion_alg_init(event_handler_motion_alg);
+  motion_alg_set_rate(samplingRate);
   
   //Enable the algorithm
   motion_alg_enable(MOTION_ALG_PEDO | 
@@ -320,39 +888,111 @@ int main(void)
 		    MOTION_ALG_RAISE_HAND | 
 		    MOTION_ALG_FLIP | 
 		    MOTION_ALG_SEDENTARY | 
-		    MOTION_ALG_SLEEP_CYCLE
+		    MOTION_ALG_SLEEP_CYCLE |
+		    MOTION_ALG_STEP |
+		    MOTION_ALG_TILT
 		    , 1);
 
   //set calorie parameters: height(m) and weight(kg)
   motion_calorie_set_param(1.8, 75.0);
 
-  //set shake parameters: threshold(g), peak duration, peak count, time-out, axes enable
-  motion_shake_set_param(0.7, 1, 2, 1.5, X_AXIS|Y_AXIS|Z_AXIS);	
+  //set shake parameters: threshold(g), peak duration(ms), peak count, time-out(ms), axes enable
+  motion_shake_set_param(0.7, 40, 2, 1500, X_AXIS|Y_AXIS|Z_AXIS);	
 
   //set sedentary time: monitor time(min), snooze time(min)
   motion_sedentary_set_param(30, 10);
 
-  //init the timer
-  init_timer_periodic_measure(fDeltaTus, event_handler_timer_periodic_measure, NULL);
+#if TELEMETRY_BINARY
+  //Events in packets, falls are sent right away
+  eventBatchInit(&eventBatch, EVENT_BATCH_EVENTS, EVENT_BATCH_LATENCY_MS);
+  eventBatchSetPriority(&eventBatch, MOTION_ALG_FALL, EVENT_BATCH_PRIORITY_URGENT);
+#endif
+
+  //init the sampling, the timer reads the samples into the FIFO
+  sampleFifoInit(&sampleFifo);
+  sampleCodecInit(&rawBlock);
+  sampleCaptureInit(&fallCapture,
+		    CAPTURE_PRE_MS / (uint32_t)samplingRate,
+		    CAPTURE_POST_MS / (uint32_t)samplingRate);
+  init_timer_periodic_measure((uint32_t)samplingRate * 1000, event_handler_timer_periodic_measure, NULL);
 
   while(1){
       
-    if(ui8PeriodicMeasureFlag){
+    if(sampleFifoPop(&sampleFifo, &sample)){
 
-      ui8PeriodicMeasureFlag = 0;
+      //raw samples before the offset compensation, lossless
+      if(ui8StreamRawFlag)
+	stream_raw_sample(&sample);
 
-      // Read XYZT raw data
-      gma303_read_data_xyzt(&rawData);
+      //kept for a fall, one part of a frozen capture sent per sample
+      sampleCaptureAdd(&fallCapture, &sample.rawData, sample.ui32Tick);
+      ui8CaptureSendFlag = 1;
 
       //offset compensation and code to g
       for(i = 0; i < 3; ++i)
-	gVal.v[i] = (float)(rawData.v[i] - offsetData.v[i]) / GMA303_RAW_DATA_SENSITIVITY;
+	gVal.v[i] = (float)(sample.rawData.v[i] - offsetData.v[i]) / GMA303_RAW_DATA_SENSITIVITY;
 
       //Rotate to the Android Coordinate
       coord_rotate_f(ACC_LAYOUT_PATTERN, &gVal);
 
-      //feed to motion process
+      //feed to motion process, the tick kept for the events of the sample
       motion_alg_process_data(gVal);
+      ui16MotionTicks[motion_alg_get_sample_index() & (MOTION_TICK_HISTORY - 1)] = (uint16_t)sample.ui32Tick;
+
+    }
+#if TELEMETRY_BINARY
+    else if(!ui8StreamRawFlag && rawBlock.ui32Count > 0){
+
+      //streaming stopped, send the partial block
+      stream_raw_flush();
+
+    }
+    else if(event_batch_is_due()){
+
+      event_batch_send();
+
+    }
+#endif
+    else if(ui8RateChangeFlag){
+
+      ui8RateChangeFlag = 0;
+
+      //12.5Hz -> 25Hz -> 50Hz -> 100Hz -> 12.5Hz, no 12.5Hz with the pedometer
+      if(samplingRate == MOTION_ALG_RATE_100HZ){
+	if(!set_sampling_rate(MOTION_ALG_RATE_12_5HZ))
+	  set_sampling_rate(MOTION_ALG_RATE_25HZ);
+      }
+      else
+	set_sampling_rate((motion_alg_rate_t)(samplingRate / 2));
+
+    }
+    else if(ui8ReportStatsFlag){
+
+      ui8ReportStatsFlag = 0;
+      report_sample_stats();
+
+    }
+    else if(ui8ReportProfileFlag){
+
+      ui8ReportProfileFlag = 0;
+      report_profile();
+
+    }
+    else if(ui8ReportStateFlag){
+
+      ui8ReportStateFlag = 0;
+      report_motion_state();
+
+    }
+    else if(ui8CaptureSendFlag && sampleCaptureIsFrozen(&fallCapture)){
+
+      ui8CaptureSendFlag = 0;
+      capture_send();
+
+    }
+    else if(event_report_ready() && motion_alg_pop_event(&event)){ //report one event between samples
+
+      report_motion_event(&event);
 
     }
     else{
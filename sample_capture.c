@@ -0,0 +1,413 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : sample_capture.c
+ *
+ * Usage: Raw sample capture around a trigger
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "sample_capture.h"
+
+_Static_assert(sizeof(sample_capture_xyz_t) == SAMPLE_CAPTURE_SAMPLE_BYTES,
+	       "sample_capture_xyz_t is not packed");
+
+/*!
+ * @brief Write a sample to the ring, count down the post-trigger window
+ *
+ * @param pCapture Pointer to the capture, not frozen
+ * @param pSample Pointer to the sample
+ *
+ * @return None
+ */
+static void capturePut(sample_capture_t *pCapture, const sample_capture_xyz_t *pSample)
+{
+
+  pCapture->samples[pCapture->ui32Head] = *pSample;
+
+  if(++pCapture->ui32Head == SAMPLE_CAPTURE_SIZE)
+    pCapture->ui32Head = 0;
+
+  if(pCapture->ui32Count < SAMPLE_CAPTURE_SIZE)
+    ++pCapture->ui32Count;
+
+  if(pCapture->state == SAMPLE_CAPTURE_POST_TRIGGER && --pCapture->ui32PostLeft == 0){
+    pCapture->state = SAMPLE_CAPTURE_FROZEN;
+    ++pCapture->ui32CaptureCount;
+  }
+}
+
+/*!
+ * @brief Initialize the capture, empty and armed
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32PreSamples Pre-trigger window in samples, trigger sample included
+ * @param ui32PostSamples Post-trigger window in samples
+ *
+ * @return None
+ */
+void sampleCaptureInit(sample_capture_t *pCapture, uint32_t ui32PreSamples, uint32_t ui32PostSamples)
+{
+
+  pCapture->ui32CaptureCount = 0;
+  pCapture->ui32BusyCount = 0;
+  pCapture->ui32HeldCount = 0;
+  pCapture->ui32ClampCount = 0;
+
+  sampleCaptureSetWindow(pCapture, ui32PreSamples, ui32PostSamples);
+}
+
+/*!
+ * @brief Set the windows, like on a sampling rate change
+ *        The ring is emptied and armed, the statistics are kept.
+ *        Windows larger than the ring together are fitted by shrinking the
+ *        pre-trigger window, the post-trigger window is kept for a trigger
+ *        detected late, with 1 pre-trigger sample at least.
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32PreSamples Pre-trigger window in samples, trigger sample included
+ * @param ui32PostSamples Post-trigger window in samples
+ *
+ * @return None
+ */
+void sampleCaptureSetWindow(sample_capture_t *pCapture, uint32_t ui32PreSamples, uint32_t ui32PostSamples)
+{
+
+  if(ui32PostSamples > SAMPLE_CAPTURE_SIZE - 1)
+    ui32PostSamples = SAMPLE_CAPTURE_SIZE - 1;
+
+  if(ui32PreSamples > SAMPLE_CAPTURE_SIZE - ui32PostSamples)
+    ui32PreSamples = SAMPLE_CAPTURE_SIZE - ui32PostSamples;
+
+  if(ui32PreSamples == 0)
+    ui32PreSamples = 1;
+
+  pCapture->ui32PreSamples = ui32PreSamples;
+  pCapture->ui32PostSamples = ui32PostSamples;
+
+  sampleCaptureRelease(pCapture);
+}
+
+/*!
+ * @brief Add a sample, clamped to 16 bits
+ *
+ * @param pCapture Pointer to the capture
+ * @param pRawData Sensor raw data
+ * @param ui32Tick Sampling tick of the data
+ *
+ * @return 1 if the capture is frozen, 0 otherwise
+ */
+int8_t sampleCaptureAdd(sample_capture_t *pCapture, const raw_data_xyzt_t *pRawData, uint32_t ui32Tick)
+{
+
+  int32_t i, i32Val[3];
+  uint32_t ui32Missed, ui32Last;
+  sample_capture_xyz_t sample;
+
+  if(pCapture->state == SAMPLE_CAPTURE_FROZEN)
+    return 1;
+
+  //Keep one sample per tick, repeat the previous sample on missed ticks
+  if(pCapture->ui32Count > 0){
+
+    ui32Missed = ui32Tick - pCapture->ui32LastTick - 1;
+
+    if(pCapture->state == SAMPLE_CAPTURE_ARMED && ui32Missed >= SAMPLE_CAPTURE_SIZE){
+
+      //Nothing left of the history, start over
+      pCapture->ui32Head = 0;
+      pCapture->ui32Count = 0;
+    }
+    else{
+
+      ui32Last = (pCapture->ui32Head == 0) ? SAMPLE_CAPTURE_SIZE - 1 : pCapture->ui32Head - 1;
+      sample = pCapture->samples[ui32Last];
+
+      //The post-trigger window is shorter than the ring, it ends the fill
+      while(ui32Missed > 0){
+
+	capturePut(pCapture, &sample);
+	++pCapture->ui32HeldCount;
+	++pCapture->ui32LastTick;
+	--ui32Missed;
+
+	if(pCapture->state == SAMPLE_CAPTURE_FROZEN)
+	  return 1;
+      }
+    }
+  }
+
+  pCapture->ui32LastTick = ui32Tick;
+
+  for(i = 0; i < 3; ++i){
+    i32Val[i] = pRawData->v[i];
+    if(i32Val[i] > INT16_MAX) i32Val[i] = INT16_MAX;
+    if(i32Val[i] < INT16_MIN) i32Val[i] = INT16_MIN;
+  }
+
+  sample.x = (int16_t)i32Val[0];
+  sample.y = (int16_t)i32Val[1];
+  sample.z = (int16_t)i32Val[2];
+
+  capturePut(pCapture, &sample);
+
+  return (pCapture->state == SAMPLE_CAPTURE_FROZEN) ? 1 : 0;
+}
+
+/*!
+ * @brief Trigger the capture
+ *        The trigger sample is the last sample added, or an older one when
+ *        the trigger is detected late, at most the post-trigger window back
+ *        and within the ring, a trigger moved to fit is counted
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32SamplesAgo Samples between the trigger sample and the last sample added
+ *
+ * @return 1 for success, 0 if the ring is empty or a capture is in progress
+ */
+int8_t sampleCaptureTrigger(sample_capture_t *pCapture, uint32_t ui32SamplesAgo)
+{
+
+  if(pCapture->state != SAMPLE_CAPTURE_ARMED){
+    ++pCapture->ui32BusyCount;
+    return 0;
+  }
+
+  if(pCapture->ui32Count == 0)
+    return 0;
+
+  if(ui32SamplesAgo > pCapture->ui32PostSamples ||
+     ui32SamplesAgo > pCapture->ui32Count - 1){
+
+    ++pCapture->ui32ClampCount;
+    if(ui32SamplesAgo > pCapture->ui32PostSamples)
+      ui32SamplesAgo = pCapture->ui32PostSamples;
+    if(ui32SamplesAgo > pCapture->ui32Count - 1)
+      ui32SamplesAgo = pCapture->ui32Count - 1;
+  }
+
+  pCapture->ui32TriggerTick = pCapture->ui32LastTick - ui32SamplesAgo;
+  pCapture->ui32PostLeft = pCapture->ui32PostSamples - ui32SamplesAgo;
+
+  if(pCapture->ui32PostLeft == 0){
+    pCapture->state = SAMPLE_CAPTURE_FROZEN;
+    ++pCapture->ui32CaptureCount;
+  }
+  else
+    pCapture->state = SAMPLE_CAPTURE_POST_TRIGGER;
+
+  return 1;
+}
+
+/*!
+ * @brief Check if the capture is frozen, ready to be read
+ *
+ * @param pCapture Pointer to the capture
+ *
+ * @return 1 if frozen, 0 otherwise
+ */
+int8_t sampleCaptureIsFrozen(const sample_capture_t *pCapture)
+{
+
+  return (pCapture->state == SAMPLE_CAPTURE_FROZEN) ? 1 : 0;
+}
+
+/*!
+ * @brief Get the frozen capture
+ *
+ * @param pCapture Pointer to the capture
+ * @param pHeader Pointer to store the ticks and size of the capture, offset 0
+ *
+ * @return Number of samples, 0 if not frozen
+ */
+uint32_t sampleCaptureGetWindow(const sample_capture_t *pCapture, sample_capture_header_t *pHeader)
+{
+
+  uint32_t ui32Count = pCapture->ui32PreSamples + pCapture->ui32PostSamples;
+
+  if(pCapture->state != SAMPLE_CAPTURE_FROZEN)
+    return 0;
+
+  //Shorter pre-trigger window when the ring was not full yet
+  if(ui32Count > pCapture->ui32Count)
+    ui32Count = pCapture->ui32Count;
+
+  pHeader->ui32FirstTick = pCapture->ui32LastTick - (ui32Count - 1);
+  pHeader->ui32TriggerTick = pCapture->ui32TriggerTick;
+  pHeader->ui32Count = ui32Count;
+  pHeader->ui32Offset = 0;
+
+  return ui32Count;
+}
+
+/*!
+ * @brief Get the contiguous run of samples from an offset of the frozen
+ *        capture, in the ring without copy
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32Offset Offset of the first sample in the capture
+ * @param ppSamples Pointer to store the address of the first sample
+ *
+ * @return Number of contiguous samples, 0 past the end or if not frozen
+ */
+uint32_t sampleCaptureGetBlock(const sample_capture_t *pCapture,
+			       uint32_t ui32Offset,
+			       const sample_capture_xyz_t **ppSamples)
+{
+
+  sample_capture_header_t header;
+  uint32_t ui32Index, ui32Run;
+
+  if(ui32Offset >= sampleCaptureGetWindow(pCapture, &header))
+    return 0;
+
+  //The capture ends with the last sample written, right before the head
+  ui32Index = pCapture->ui32Head + SAMPLE_CAPTURE_SIZE - header.ui32Count + ui32Offset;
+  if(ui32Index >= SAMPLE_CAPTURE_SIZE)
+    ui32Index -= SAMPLE_CAPTURE_SIZE;
+
+  ui32Run = header.ui32Count - ui32Offset;
+  if(ui32Run > SAMPLE_CAPTURE_SIZE - ui32Index)
+    ui32Run = SAMPLE_CAPTURE_SIZE - ui32Index;
+
+  *ppSamples = &pCapture->samples[ui32Index];
+
+  return ui32Run;
+}
+
+/*!
+ * @brief Release the frozen capture, the ring is emptied and armed
+ *
+ * @param pCapture Pointer to the capture
+ *
+ * @return None
+ */
+void sampleCaptureRelease(sample_capture_t *pCapture)
+{
+
+  pCapture->state = SAMPLE_CAPTURE_ARMED;
+  pCapture->ui32Head = 0;
+  pCapture->ui32Count = 0;
+  pCapture->ui32PostLeft = 0;
+}
+
+/*!
+ * @brief Encode the samples from an offset of the frozen capture into a
+ *        TELEMETRY_TYPE_CAPTURE frame
+ *
+ * @param pCapture Pointer to the capture, frozen
+ * @param ui32Offset Offset of the first sample in the capture
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ *
+ * @return Number of samples in the frame, 0 past the end or if not frozen
+ */
+uint32_t sampleCaptureEncode(const sample_capture_t *pCapture, uint32_t ui32Offset, telemetry_frame_t *pFrame)
+{
+
+  sample_capture_header_t header;
+  const sample_capture_xyz_t *pSamples;
+  uint32_t ui32Count;
+
+  if(ui32Offset >= sampleCaptureGetWindow(pCapture, &header))
+    return 0;
+
+  ui32Count = sampleCaptureGetBlock(pCapture, ui32Offset, &pSamples);
+  if(ui32Count > SAMPLE_CAPTURE_FRAME_SAMPLES)
+    ui32Count = SAMPLE_CAPTURE_FRAME_SAMPLES;
+
+  telemetryBegin(pFrame, TELEMETRY_TYPE_CAPTURE);
+  telemetryPutU32(pFrame, header.ui32FirstTick);
+  telemetryPutU32(pFrame, header.ui32TriggerTick);
+  telemetryPutU32(pFrame, header.ui32Count);
+  telemetryPutU32(pFrame, ui32Offset);
+
+  //The ring is little endian 16 bits already, as on the wire
+  telemetryPutBytes(pFrame, (const uint8_t *)pSamples, ui32Count * SAMPLE_CAPTURE_SAMPLE_BYTES);
+
+  return ui32Count;
+}
+
+/*!
+ * @brief Decode the payload of a TELEMETRY_TYPE_CAPTURE frame
+ *
+ * @param pPayload Payload
+ * @param ui32Len Payload bytes
+ * @param pHeader Pointer to store the capture ticks, size and frame offset
+ * @param samples Array to store the samples of the frame
+ *
+ * @return Number of samples, -1 if the payload is malformed
+ */
+int32_t sampleCaptureDecode(const uint8_t *pPayload,
+			    uint32_t ui32Len,
+			    sample_capture_header_t *pHeader,
+			    sample_capture_xyz_t samples[SAMPLE_CAPTURE_FRAME_SAMPLES])
+{
+
+  uint32_t ui32Pos = 0, ui32Count, i;
+  const uint8_t *p;
+
+  if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, &pHeader->ui32FirstTick) ||
+     !telemetryGetU32(pPayload, ui32Len, &ui32Pos, &pHeader->ui32TriggerTick) ||
+     !telemetryGetU32(pPayload, ui32Len, &ui32Pos, &pHeader->ui32Count) ||
+     !telemetryGetU32(pPayload, ui32Len, &ui32Pos, &pHeader->ui32Offset))
+    return -1;
+
+  if((ui32Len - ui32Pos) % SAMPLE_CAPTURE_SAMPLE_BYTES != 0)
+    return -1;
+
+  ui32Count = (ui32Len - ui32Pos) / SAMPLE_CAPTURE_SAMPLE_BYTES;
+  if(ui32Count == 0 || ui32Count > SAMPLE_CAPTURE_FRAME_SAMPLES ||
+     pHeader->ui32Offset + ui32Count > pHeader->ui32Count)
+    return -1;
+
+  for(i = 0; i < ui32Count; ++i){
+    p = &pPayload[ui32Pos + i * SAMPLE_CAPTURE_SAMPLE_BYTES];
+    samples[i].x = (int16_t)(p[0] | (p[1] << 8));
+    samples[i].y = (int16_t)(p[2] | (p[3] << 8));
+    samples[i].z = (int16_t)(p[4] | (p[5] << 8));
+  }
+
+  return (int32_t)ui32Count;
+}
+
+/*!
+ * @brief Get the capture statistics
+ *
+ * @param pCapture Pointer to the capture
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getSampleCaptureStats(const sample_capture_t *pCapture, sample_capture_stats_t *pStats)
+{
+
+  pStats->ui32Capacity = SAMPLE_CAPTURE_SIZE;
+  pStats->ui32Bytes = sizeof(pCapture->samples);
+  pStats->ui32PerKb = SAMPLE_CAPTURE_PER_KB;
+  pStats->ui32PreSamples = pCapture->ui32PreSamples;
+  pStats->ui32PostSamples = pCapture->ui32PostSamples;
+  pStats->ui32CaptureCount = pCapture->ui32CaptureCount;
+  pStats->ui32BusyCount = pCapture->ui32BusyCount;
+  pStats->ui32HeldCount = pCapture->ui32HeldCount;
+  pStats->ui32ClampCount = pCapture->ui32ClampCount;
+}
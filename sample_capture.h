@@ -0,0 +1,262 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : sample_capture.h
+ *
+ * Usage: Raw sample capture around a trigger
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file sample_capture.h
+ *  @brief Ring of the recent raw samples, packed as 16 bits XYZ, frozen
+ *         around a trigger like a fall to be uploaded as
+ *         TELEMETRY_TYPE_CAPTURE frames
+ *
+ *  The ring keeps SAMPLE_CAPTURE_PER_KB samples per KB of RAM, a sample is
+ *  6 bytes instead of the 16 bytes of a float_xyzt_t. On a trigger, the ring
+ *  keeps filling for the post-trigger window, then it is frozen: the capture
+ *  is the pre-trigger window, ending with the trigger sample, followed by the
+ *  post-trigger window. A frozen capture is read in place, as at most two
+ *  contiguous runs of samples, and released to arm the next trigger.
+ *
+ *  Payload of a TELEMETRY_TYPE_CAPTURE frame:
+ *  - tick of the first sample of the capture, unsigned varint
+ *  - tick of the trigger sample, unsigned varint
+ *  - number of samples of the capture, unsigned varint
+ *  - offset of the first sample of the frame in the capture, unsigned varint
+ *  - up to SAMPLE_CAPTURE_FRAME_SAMPLES samples, X, Y, Z of each sample as
+ *    16 bits little endian, copied as they are in the ring
+ *
+ *  The samples of a capture are consecutive ticks. A missed tick repeats
+ *  the previous sample, counted in the statistics.
+ */
+
+#ifndef __SAMPLE_CAPTURE_H__
+#define __SAMPLE_CAPTURE_H__
+
+#include <stdint.h>
+#include "type_support.h"
+#include "telemetry.h"
+
+//Bytes of a packed sample, sizeof(sample_capture_xyz_t)
+#define SAMPLE_CAPTURE_SAMPLE_BYTES   (6)
+
+//Samples per KB of RAM
+#define SAMPLE_CAPTURE_PER_KB         (1024 / SAMPLE_CAPTURE_SAMPLE_BYTES)
+
+//RAM of the ring in KB
+#ifndef SAMPLE_CAPTURE_KB
+#define SAMPLE_CAPTURE_KB             (2)
+#endif
+
+//Ring capacity in samples
+#define SAMPLE_CAPTURE_SIZE           (SAMPLE_CAPTURE_KB * SAMPLE_CAPTURE_PER_KB)
+
+//Samples per TELEMETRY_TYPE_CAPTURE frame, the 4 varints take 20 bytes at most
+#define SAMPLE_CAPTURE_FRAME_SAMPLES  ((TELEMETRY_PAYLOAD_MAX - 20) / SAMPLE_CAPTURE_SAMPLE_BYTES)
+
+typedef struct{
+
+  int16_t x;
+  int16_t y;
+  int16_t z;
+
+} sample_capture_xyz_t;
+
+typedef enum {
+  SAMPLE_CAPTURE_ARMED = 0,        //filling, waiting for a trigger
+  SAMPLE_CAPTURE_POST_TRIGGER,     //filling the post-trigger window
+  SAMPLE_CAPTURE_FROZEN            //capture ready, samples are not added
+} sample_capture_state_t;
+
+typedef struct{
+
+  uint32_t ui32FirstTick;          //tick of the first sample of the capture
+  uint32_t ui32TriggerTick;        //tick of the trigger sample
+  uint32_t ui32Count;              //samples of the capture
+  uint32_t ui32Offset;             //offset of the first sample of the frame
+
+} sample_capture_header_t;
+
+typedef struct{
+
+  uint32_t ui32Capacity;           //ring capacity in samples
+  uint32_t ui32Bytes;              //ring size in bytes
+  uint32_t ui32PerKb;              //samples per KB of RAM
+  uint32_t ui32PreSamples;         //pre-trigger window, trigger sample included
+  uint32_t ui32PostSamples;        //post-trigger window
+  uint32_t ui32CaptureCount;       //captures frozen
+  uint32_t ui32BusyCount;          //triggers ignored, a capture in progress
+  uint32_t ui32HeldCount;          //missed ticks filled with the previous sample
+  uint32_t ui32ClampCount;         //triggers older than the post-trigger window or the ring
+
+} sample_capture_stats_t;
+
+typedef struct{
+
+  sample_capture_state_t state;
+  uint32_t ui32Head;               //next slot to write
+  uint32_t ui32Count;              //samples in the ring
+  uint32_t ui32LastTick;           //tick of the last sample
+  uint32_t ui32TriggerTick;        //tick of the trigger sample
+  uint32_t ui32PreSamples;
+  uint32_t ui32PostSamples;
+  uint32_t ui32PostLeft;           //samples to add before freezing
+  uint32_t ui32CaptureCount;
+  uint32_t ui32BusyCount;
+  uint32_t ui32HeldCount;
+  uint32_t ui32ClampCount;
+  sample_capture_xyz_t samples[SAMPLE_CAPTURE_SIZE];
+
+} sample_capture_t;
+
+/*!
+ * @brief Initialize the capture, empty and armed
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32PreSamples Pre-trigger window in samples, trigger sample included
+ * @param ui32PostSamples Post-trigger window in samples
+ *
+ * @return None
+ */
+void sampleCaptureInit(sample_capture_t *pCapture, uint32_t ui32PreSamples, uint32_t ui32PostSamples);
+
+/*!
+ * @brief Set the windows, like on a sampling rate change
+ *        The ring is emptied and armed, the statistics are kept.
+ *        Windows larger than the ring together are fitted by shrinking the
+ *        pre-trigger window, the post-trigger window is kept for a trigger
+ *        detected late, with 1 pre-trigger sample at least.
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32PreSamples Pre-trigger window in samples, trigger sample included
+ * @param ui32PostSamples Post-trigger window in samples
+ *
+ * @return None
+ */
+void sampleCaptureSetWindow(sample_capture_t *pCapture, uint32_t ui32PreSamples, uint32_t ui32PostSamples);
+
+/*!
+ * @brief Add a sample, clamped to 16 bits
+ *
+ * @param pCapture Pointer to the capture
+ * @param pRawData Sensor raw data
+ * @param ui32Tick Sampling tick of the data
+ *
+ * @return 1 if the capture is frozen, 0 otherwise
+ */
+int8_t sampleCaptureAdd(sample_capture_t *pCapture, const raw_data_xyzt_t *pRawData, uint32_t ui32Tick);
+
+/*!
+ * @brief Trigger the capture
+ *        The trigger sample is the last sample added, or an older one when
+ *        the trigger is detected late, at most the post-trigger window back
+ *        and within the ring, a trigger moved to fit is counted
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32SamplesAgo Samples between the trigger sample and the last sample added
+ *
+ * @return 1 for success, 0 if the ring is empty or a capture is in progress
+ */
+int8_t sampleCaptureTrigger(sample_capture_t *pCapture, uint32_t ui32SamplesAgo);
+
+/*!
+ * @brief Check if the capture is frozen, ready to be read
+ *
+ * @param pCapture Pointer to the capture
+ *
+ * @return 1 if frozen, 0 otherwise
+ */
+int8_t sampleCaptureIsFrozen(const sample_capture_t *pCapture);
+
+/*!
+ * @brief Get the frozen capture
+ *
+ * @param pCapture Pointer to the capture
+ * @param pHeader Pointer to store the ticks and size of the capture, offset 0
+ *
+ * @return Number of samples, 0 if not frozen
+ */
+uint32_t sampleCaptureGetWindow(const sample_capture_t *pCapture, sample_capture_header_t *pHeader);
+
+/*!
+ * @brief Get the contiguous run of samples from an offset of the frozen
+ *        capture, in the ring without copy
+ *
+ * @param pCapture Pointer to the capture
+ * @param ui32Offset Offset of the first sample in the capture
+ * @param ppSamples Pointer to store the address of the first sample
+ *
+ * @return Number of contiguous samples, 0 past the end or if not frozen
+ */
+uint32_t sampleCaptureGetBlock(const sample_capture_t *pCapture,
+			       uint32_t ui32Offset,
+			       const sample_capture_xyz_t **ppSamples);
+
+/*!
+ * @brief Release the frozen capture, the ring is emptied and armed
+ *
+ * @param pCapture Pointer to the capture
+ *
+ * @return None
+ */
+void sampleCaptureRelease(sample_capture_t *pCapture);
+
+/*!
+ * @brief Encode the samples from an offset of the frozen capture into a
+ *        TELEMETRY_TYPE_CAPTURE frame
+ *
+ * @param pCapture Pointer to the capture, frozen
+ * @param ui32Offset Offset of the first sample in the capture
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ *
+ * @return Number of samples in the frame, 0 past the end or if not frozen
+ */
+uint32_t sampleCaptureEncode(const sample_capture_t *pCapture, uint32_t ui32Offset, telemetry_frame_t *pFrame);
+
+/*!
+ * @brief Decode the payload of a TELEMETRY_TYPE_CAPTURE frame
+ *
+ * @param pPayload Payload
+ * @param ui32Len Payload bytes
+ * @param pHeader Pointer to store the capture ticks, size and frame offset
+ * @param samples Array to store the samples of the frame
+ *
+ * @return Number of samples, -1 if the payload is malformed
+ */
+int32_t sampleCaptureDecode(const uint8_t *pPayload,
+			    uint32_t ui32Len,
+			    sample_capture_header_t *pHeader,
+			    sample_capture_xyz_t samples[SAMPLE_CAPTURE_FRAME_SAMPLES]);
+
+/*!
+ * @brief Get the capture statistics
+ *
+ * @param pCapture Pointer to the capture
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getSampleCaptureStats(const sample_capture_t *pCapture, sample_capture_stats_t *pStats);
+
+#endif //__SAMPLE_CAPTURE_H__
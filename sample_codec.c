@@ -0,0 +1,324 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : sample_codec.c
+ *
+ * Usage: Lossless block compression of raw sensor samples
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "sample_codec.h"
+
+#define ESCAPE_BITS (17) //zig-zag of a 16 bits delta
+#define RAW_BITS    (16)
+
+//Bits of the Rice coded deltas of a block, SAMPLE_CODEC_RICE_QMAX is 16
+//so the worst case is the raw axes
+#define BITS_MAX    (3 * RAW_BITS * (SAMPLE_CODEC_BLOCK - 1))
+
+typedef struct{
+
+  uint8_t *pBuf;
+  uint32_t ui32Len;   //buffer bytes
+  uint32_t ui32Pos;   //bit position
+
+} bit_stream_t;
+
+/*!
+ * @brief Write bits, MSB first
+ *
+ * @param pStream Pointer to the bit stream, buffer zeroed
+ * @param ui32Val Value
+ * @param ui32Bits Number of low bits of the value to write
+ *
+ * @return None
+ */
+static void putBits(bit_stream_t *pStream, uint32_t ui32Val, uint32_t ui32Bits)
+{
+
+  while(ui32Bits > 0){
+
+    --ui32Bits;
+    if((ui32Val >> ui32Bits) & 1)
+      pStream->pBuf[pStream->ui32Pos >> 3] |= (uint8_t)(0x80 >> (pStream->ui32Pos & 7));
+    ++pStream->ui32Pos;
+  }
+}
+
+/*!
+ * @brief Read bits, MSB first
+ *
+ * @param pStream Pointer to the bit stream
+ * @param ui32Bits Number of bits to read
+ * @param pui32Val Pointer to store the value
+ *
+ * @return 1 for success, 0 if the stream ends
+ */
+static int8_t getBits(bit_stream_t *pStream, uint32_t ui32Bits, uint32_t *pui32Val)
+{
+
+  uint32_t ui32Val = 0;
+
+  if(pStream->ui32Pos + ui32Bits > pStream->ui32Len * 8)
+    return 0;
+
+  while(ui32Bits > 0){
+
+    --ui32Bits;
+    ui32Val = (ui32Val << 1) |
+      ((pStream->pBuf[pStream->ui32Pos >> 3] >> (7 - (pStream->ui32Pos & 7))) & 1);
+    ++pStream->ui32Pos;
+  }
+
+  *pui32Val = ui32Val;
+
+  return 1;
+}
+
+/*!
+ * @brief Bits of a Rice coded value
+ *
+ * @param ui32Val Zig-zag mapped value
+ * @param ui32K Rice parameter
+ *
+ * @return Number of bits
+ */
+static uint32_t riceBits(uint32_t ui32Val, uint32_t ui32K)
+{
+
+  uint32_t q = ui32Val >> ui32K;
+
+  return (q < SAMPLE_CODEC_RICE_QMAX) ? q + 1 + ui32K : SAMPLE_CODEC_RICE_QMAX + ESCAPE_BITS;
+}
+
+/*!
+ * @brief Initialize an empty block
+ *
+ * @param pBlock Pointer to the block
+ *
+ * @return None
+ */
+void sampleCodecInit(sample_codec_block_t *pBlock)
+{
+
+  pBlock->ui32FirstTick = 0;
+  pBlock->ui32Count = 0;
+}
+
+/*!
+ * @brief Add a sample to the block
+ *
+ * @param pBlock Pointer to the block
+ * @param pRawData Sensor raw data, clamped to 16 bits
+ * @param ui32Tick Sampling tick of the data
+ *
+ * @return 1 for success, 0 if the block is full or the tick does not follow
+ *         the last sample, encode the block and add the sample again
+ */
+int8_t sampleCodecAdd(sample_codec_block_t *pBlock, const raw_data_xyzt_t *pRawData, uint32_t ui32Tick)
+{
+
+  int32_t i, i32Val;
+
+  if(pBlock->ui32Count == 0)
+    pBlock->ui32FirstTick = ui32Tick;
+  else if(pBlock->ui32Count >= SAMPLE_CODEC_BLOCK ||
+	  ui32Tick != pBlock->ui32FirstTick + pBlock->ui32Count)
+    return 0;
+
+  for(i = 0; i < 3; ++i){
+    i32Val = pRawData->v[i];
+    if(i32Val > INT16_MAX) i32Val = INT16_MAX;
+    if(i32Val < INT16_MIN) i32Val = INT16_MIN;
+    pBlock->samples[i][pBlock->ui32Count] = (int16_t)i32Val;
+  }
+
+  ++pBlock->ui32Count;
+
+  return 1;
+}
+
+/*!
+ * @brief Encode the block into a TELEMETRY_TYPE_SAMPLES frame and empty it
+ *
+ * @param pBlock Pointer to the block, not empty
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ *
+ * @return None
+ */
+void sampleCodecEncode(sample_codec_block_t *pBlock, telemetry_frame_t *pFrame)
+{
+
+  uint32_t i, j, k, ui32Bits, ui32BestBits;
+  uint32_t ui32Deltas = pBlock->ui32Count - 1;
+  uint32_t val[3][SAMPLE_CODEC_BLOCK - 1];
+  uint8_t ui8K[3], ui8KByte[2];
+  uint8_t ui8Buf[(BITS_MAX + 7) / 8] = {0};
+  bit_stream_t stream = {ui8Buf, sizeof(ui8Buf), 0};
+  int32_t i32Delta;
+
+  telemetryBegin(pFrame, TELEMETRY_TYPE_SAMPLES);
+  telemetryPutU32(pFrame, pBlock->ui32FirstTick);
+  telemetryPutU32(pFrame, pBlock->ui32Count);
+
+  for(i = 0; i < 3; ++i){
+
+    telemetryPutS32(pFrame, pBlock->samples[i][0]);
+
+    //Zig-zag deltas
+    for(j = 0; j < ui32Deltas; ++j){
+      i32Delta = (int32_t)pBlock->samples[i][j + 1] - pBlock->samples[i][j];
+      val[i][j] = ((uint32_t)i32Delta << 1) ^ (uint32_t)(i32Delta >> 31);
+    }
+
+    //The k with the fewest bits, the raw samples otherwise
+    ui8K[i] = SAMPLE_CODEC_K_RAW;
+    ui32BestBits = RAW_BITS * ui32Deltas;
+
+    for(k = 0; k < SAMPLE_CODEC_K_RAW; ++k){
+
+      ui32Bits = 0;
+      for(j = 0; j < ui32Deltas; ++j)
+	ui32Bits += riceBits(val[i][j], k);
+
+      if(ui32Bits < ui32BestBits){
+	ui32BestBits = ui32Bits;
+	ui8K[i] = (uint8_t)k;
+      }
+    }
+  }
+
+  ui8KByte[0] = (uint8_t)(ui8K[0] | (ui8K[1] << 4));
+  ui8KByte[1] = ui8K[2];
+  telemetryPutBytes(pFrame, ui8KByte, 2);
+
+  for(i = 0; i < 3; ++i){
+
+    k = ui8K[i];
+
+    for(j = 0; j < ui32Deltas; ++j){
+
+      if(k == SAMPLE_CODEC_K_RAW){
+	putBits(&stream, (uint16_t)pBlock->samples[i][j + 1], RAW_BITS);
+      }
+      else if((val[i][j] >> k) < SAMPLE_CODEC_RICE_QMAX){
+	putBits(&stream, ((1u << (val[i][j] >> k)) - 1) << 1, (val[i][j] >> k) + 1);
+	putBits(&stream, val[i][j], k);
+      }
+      else{
+	putBits(&stream, (1u << SAMPLE_CODEC_RICE_QMAX) - 1, SAMPLE_CODEC_RICE_QMAX);
+	putBits(&stream, val[i][j], ESCAPE_BITS);
+      }
+    }
+  }
+
+  telemetryPutBytes(pFrame, ui8Buf, (stream.ui32Pos + 7) >> 3);
+
+  pBlock->ui32Count = 0;
+}
+
+/*!
+ * @brief Decode the payload of a TELEMETRY_TYPE_SAMPLES frame
+ *
+ * @param pPayload Payload
+ * @param ui32Len Payload bytes
+ * @param pui32FirstTick Pointer to store the tick of the first sample
+ * @param samples Array to store the samples, XYZ of each sample
+ *
+ * @return Number of samples, -1 if the payload is malformed
+ */
+int32_t sampleCodecDecode(const uint8_t *pPayload,
+			  uint32_t ui32Len,
+			  uint32_t *pui32FirstTick,
+			  int16_t samples[SAMPLE_CODEC_BLOCK][3])
+{
+
+  uint32_t ui32Pos = 0, ui32Count, ui32Val, ui32Bit, q, i, j, k;
+  uint32_t ui32K[3];
+  int32_t i32Val, i32Delta;
+  bit_stream_t stream;
+
+  if(!telemetryGetU32(pPayload, ui32Len, &ui32Pos, pui32FirstTick) ||
+     !telemetryGetU32(pPayload, ui32Len, &ui32Pos, &ui32Count) ||
+     ui32Count == 0 || ui32Count > SAMPLE_CODEC_BLOCK)
+    return -1;
+
+  for(i = 0; i < 3; ++i){
+    if(!telemetryGetS32(pPayload, ui32Len, &ui32Pos, &i32Val) ||
+       i32Val > INT16_MAX || i32Val < INT16_MIN)
+      return -1;
+    samples[0][i] = (int16_t)i32Val;
+  }
+
+  if(ui32Pos + 2 > ui32Len)
+    return -1;
+
+  ui32K[0] = pPayload[ui32Pos] & 0x0F;
+  ui32K[1] = pPayload[ui32Pos] >> 4;
+  ui32K[2] = pPayload[ui32Pos + 1] & 0x0F;
+  ui32Pos += 2;
+
+  stream.pBuf = (uint8_t *)&pPayload[ui32Pos];
+  stream.ui32Len = ui32Len - ui32Pos;
+  stream.ui32Pos = 0;
+
+  for(i = 0; i < 3; ++i){
+
+    k = ui32K[i];
+
+    for(j = 1; j < ui32Count; ++j){
+
+      if(k == SAMPLE_CODEC_K_RAW){
+	if(!getBits(&stream, RAW_BITS, &ui32Val))
+	  return -1;
+	samples[j][i] = (int16_t)ui32Val;
+	continue;
+      }
+
+      //Unary prefix
+      for(q = 0; q < SAMPLE_CODEC_RICE_QMAX; ++q){
+	if(!getBits(&stream, 1, &ui32Bit))
+	  return -1;
+	if(ui32Bit == 0)
+	  break;
+      }
+
+      if(q < SAMPLE_CODEC_RICE_QMAX){
+	if(!getBits(&stream, k, &ui32Val))
+	  return -1;
+	ui32Val |= q << k;
+      }
+      else if(!getBits(&stream, ESCAPE_BITS, &ui32Val)){
+	return -1;
+      }
+
+      i32Delta = (int32_t)(ui32Val >> 1) ^ -(int32_t)(ui32Val & 1);
+      i32Val = samples[j - 1][i] + i32Delta;
+      if(i32Val > INT16_MAX || i32Val < INT16_MIN)
+	return -1;
+      samples[j][i] = (int16_t)i32Val;
+    }
+  }
+
+  return (int32_t)ui32Count;
+}
@@ -0,0 +1,124 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : sample_codec.h
+ *
+ * Usage: Lossless block compression of raw sensor samples
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file sample_codec.h
+ *  @brief Lossless compression of raw XYZ samples in fixed size blocks,
+ *         sent as TELEMETRY_TYPE_SAMPLES frames
+ *
+ *  Payload of a block:
+ *  - tick of the first sample, unsigned varint
+ *  - number of samples n, 1 to SAMPLE_CODEC_BLOCK, unsigned varint
+ *  - first sample of X, Y and Z, signed varints
+ *  - Rice parameter k of each axis, 4 bits each, X and Y in the first byte
+ *    (X in the low nibble), Z in the second byte
+ *  - bit stream, MSB first, of the n - 1 deltas of X, then Y, then Z
+ *
+ *  A delta d is zig-zag mapped to v = (d << 1) ^ (d >> 31), then coded as
+ *  q = v >> k one bits, a zero bit and the k low bits of v. A value with
+ *  q >= SAMPLE_CODEC_RICE_QMAX is escaped: SAMPLE_CODEC_RICE_QMAX one bits
+ *  and v in 17 bits. With k = SAMPLE_CODEC_K_RAW the axis is not coded,
+ *  every sample but the first is stored as 16 bits.
+ *  The encoder picks the k of each axis giving the fewest bits, so a block
+ *  is never larger than the raw samples.
+ *
+ *  The samples of a block are consecutive ticks, a block starts over on a
+ *  missed tick, and each block is decoded on its own.
+ */
+
+#ifndef __SAMPLE_CODEC_H__
+#define __SAMPLE_CODEC_H__
+
+#include <stdint.h>
+#include "type_support.h"
+#include "telemetry.h"
+
+//Samples per block
+#define SAMPLE_CODEC_BLOCK       (16)
+
+//Longest unary prefix before a value is escaped
+#define SAMPLE_CODEC_RICE_QMAX   (16)
+
+//Rice parameter of an axis stored as raw 16 bits
+#define SAMPLE_CODEC_K_RAW       (15)
+
+typedef struct{
+
+  uint32_t ui32FirstTick;                     //tick of the first sample
+  uint32_t ui32Count;                         //samples in the block
+  int16_t samples[3][SAMPLE_CODEC_BLOCK];     //samples of each axis
+
+} sample_codec_block_t;
+
+/*!
+ * @brief Initialize an empty block
+ *
+ * @param pBlock Pointer to the block
+ *
+ * @return None
+ */
+void sampleCodecInit(sample_codec_block_t *pBlock);
+
+/*!
+ * @brief Add a sample to the block
+ *
+ * @param pBlock Pointer to the block
+ * @param pRawData Sensor raw data, clamped to 16 bits
+ * @param ui32Tick Sampling tick of the data
+ *
+ * @return 1 for success, 0 if the block is full or the tick does not follow
+ *         the last sample, encode the block and add the sample again
+ */
+int8_t sampleCodecAdd(sample_codec_block_t *pBlock, const raw_data_xyzt_t *pRawData, uint32_t ui32Tick);
+
+/*!
+ * @brief Encode the block into a TELEMETRY_TYPE_SAMPLES frame and empty it
+ *
+ * @param pBlock Pointer to the block, not empty
+ * @param pFrame Pointer to the frame, to be finished by telemetryEnd()
+ *
+ * @return None
+ */
+void sampleCodecEncode(sample_codec_block_t *pBlock, telemetry_frame_t *pFrame);
+
+/*!
+ * @brief Decode the payload of a TELEMETRY_TYPE_SAMPLES frame
+ *
+ * @param pPayload Payload
+ * @param ui32Len Payload bytes
+ * @param pui32FirstTick Pointer to store the tick of the first sample
+ * @param samples Array to store the samples, XYZ of each sample
+ *
+ * @return Number of samples, -1 if the payload is malformed
+ */
+int32_t sampleCodecDecode(const uint8_t *pPayload,
+			  uint32_t ui32Len,
+			  uint32_t *pui32FirstTick,
+			  int16_t samples[SAMPLE_CODEC_BLOCK][3]);
+
+#endif //__SAMPLE_CODEC_H__
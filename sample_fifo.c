@@ -0,0 +1,166 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : sample_fifo.c
+ *
+ * Usage: Sample FIFO between the sampling tick and the processing loop
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "sample_fifo.h"
+
+#define FIFO_INDEX_MASK (SAMPLE_FIFO_SIZE - 1)
+//Keep the slot access and the index update in order
+#define FIFO_BARRIER() __sync_synchronize()
+
+/*!
+ * @brief Initialize the sample FIFO
+ *
+ * @param pFifo Pointer to the sample FIFO
+ *
+ * @return None
+ */
+void sampleFifoInit(sample_fifo_t *pFifo)
+{
+
+  pFifo->ui32Head = 0;
+  pFifo->ui32Tail = 0;
+  pFifo->ui32Tick = 0;
+  pFifo->ui32OverrunCount = 0;
+  pFifo->ui32MissedTickCount = 0;
+  pFifo->ui32HighWater = 0;
+  pFifo->ui32LagMax = 0;
+}
+
+/*!
+ * @brief Count a sampling tick, producer side
+ *
+ * @param pFifo Pointer to the sample FIFO
+ *
+ * @return The new tick count, the timestamp of the sample read at this tick
+ */
+uint32_t sampleFifoTick(sample_fifo_t *pFifo)
+{
+
+  uint32_t ui32Tick = pFifo->ui32Tick + 1;
+
+  pFifo->ui32Tick = ui32Tick;
+
+  return ui32Tick;
+}
+
+/*!
+ * @brief Count a tick that produced no sample, producer side
+ *
+ * @param pFifo Pointer to the sample FIFO
+ *
+ * @return None
+ */
+void sampleFifoMissTick(sample_fifo_t *pFifo)
+{
+
+  pFifo->ui32MissedTickCount += 1;
+}
+
+/*!
+ * @brief Push a sample, producer side
+ *        The sample is dropped and counted as overrun if the FIFO is full
+ *
+ * @param pFifo Pointer to the sample FIFO
+ * @param pRawData Pointer to the sensor raw data
+ * @param ui32Tick Tick the data was read at
+ *
+ * @return 1 for success, 0 if the FIFO is full
+ */
+int8_t sampleFifoPush(sample_fifo_t *pFifo, const raw_data_xyzt_t *pRawData, uint32_t ui32Tick)
+{
+
+  uint32_t ui32Head = pFifo->ui32Head;
+  uint32_t ui32Count = ui32Head - pFifo->ui32Tail;
+  sample_fifo_entry_t *pEntry;
+
+  if(ui32Count >= SAMPLE_FIFO_SIZE){
+    pFifo->ui32OverrunCount += 1;
+    return 0;
+  }
+
+  pEntry = &pFifo->entries[ui32Head & FIFO_INDEX_MASK];
+  pEntry->rawData = *pRawData;
+  pEntry->ui32Tick = ui32Tick;
+  FIFO_BARRIER();
+  pFifo->ui32Head = ui32Head + 1;
+
+  if(ui32Count + 1 > pFifo->ui32HighWater)
+    pFifo->ui32HighWater = ui32Count + 1;
+
+  return 1;
+}
+
+/*!
+ * @brief Pop the oldest sample, consumer side
+ *
+ * @param pFifo Pointer to the sample FIFO
+ * @param pEntry Pointer to store the sample
+ *
+ * @return 1 for success, 0 if the FIFO is empty
+ */
+int8_t sampleFifoPop(sample_fifo_t *pFifo, sample_fifo_entry_t *pEntry)
+{
+
+  uint32_t ui32Tail = pFifo->ui32Tail;
+  uint32_t ui32Lag;
+
+  if(ui32Tail == pFifo->ui32Head)
+    return 0;
+
+  *pEntry = pFifo->entries[ui32Tail & FIFO_INDEX_MASK];
+  FIFO_BARRIER();
+  pFifo->ui32Tail = ui32Tail + 1;
+
+  //Ticks elapsed since the sample was read, wrap-around safe
+  ui32Lag = pFifo->ui32Tick - pEntry->ui32Tick;
+  if(ui32Lag > pFifo->ui32LagMax)
+    pFifo->ui32LagMax = ui32Lag;
+
+  return 1;
+}
+
+/*!
+ * @brief Get the sample FIFO statistics
+ *
+ * @param pFifo Pointer to the sample FIFO
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getSampleFifoStats(sample_fifo_t *pFifo, sample_fifo_stats_t *pStats)
+{
+
+  pStats->ui32Capacity = SAMPLE_FIFO_SIZE;
+  pStats->ui32Tick = pFifo->ui32Tick;
+  pStats->ui32Pending = pFifo->ui32Head - pFifo->ui32Tail;
+  pStats->ui32HighWater = pFifo->ui32HighWater;
+  pStats->ui32OverrunCount = pFifo->ui32OverrunCount;
+  pStats->ui32MissedTickCount = pFifo->ui32MissedTickCount;
+  pStats->ui32LagMax = pFifo->ui32LagMax;
+}
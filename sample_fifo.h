@@ -0,0 +1,139 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : sample_fifo.h
+ *
+ * Usage: Sample FIFO between the sampling tick and the processing loop
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file sample_fifo.h
+ *  @brief Fixed size ring of timestamped sensor samples, filled at tick time
+ *         by the interrupt handlers and drained by the processing loop
+ */
+
+#ifndef __SAMPLE_FIFO_H__
+#define __SAMPLE_FIFO_H__
+
+#include "type_support.h"
+
+//FIFO capacity, must be a power of 2
+#define SAMPLE_FIFO_SIZE (32)
+
+typedef struct{
+
+  raw_data_xyzt_t rawData;  //sensor raw data
+  uint32_t ui32Tick;        //sampling tick the data was read at, from 1
+
+} sample_fifo_entry_t;
+
+typedef struct{
+
+  uint32_t ui32Capacity;        //FIFO capacity
+  uint32_t ui32Tick;            //sampling ticks so far
+  uint32_t ui32Pending;         //samples waiting for processing
+  uint32_t ui32HighWater;       //max number of pending samples
+  uint32_t ui32OverrunCount;    //samples dropped because the FIFO was full
+  uint32_t ui32MissedTickCount; //ticks without a sample, read busy or failed
+  uint32_t ui32LagMax;          //max ticks between reading and processing a sample
+
+} sample_fifo_stats_t;
+
+/*
+ * Single-producer/single-consumer ring, same scheme as the motion event queue.
+ * The producer side (tick, miss, push) must run at one interrupt priority,
+ * the consumer side (pop) in the processing loop.
+ */
+typedef struct{
+
+  volatile uint32_t ui32Head;      //free running write index, producer side
+  volatile uint32_t ui32Tail;      //free running read index, consumer side
+  volatile uint32_t ui32Tick;      //sampling tick counter, producer side
+  uint32_t ui32OverrunCount;
+  uint32_t ui32MissedTickCount;
+  uint32_t ui32HighWater;
+  uint32_t ui32LagMax;             //consumer side
+  sample_fifo_entry_t entries[SAMPLE_FIFO_SIZE];
+
+} sample_fifo_t;
+
+/*!
+ * @brief Initialize the sample FIFO
+ *
+ * @param pFifo Pointer to the sample FIFO
+ *
+ * @return None
+ */
+void sampleFifoInit(sample_fifo_t *pFifo);
+
+/*!
+ * @brief Count a sampling tick, producer side
+ *
+ * @param pFifo Pointer to the sample FIFO
+ *
+ * @return The new tick count, the timestamp of the sample read at this tick
+ */
+uint32_t sampleFifoTick(sample_fifo_t *pFifo);
+
+/*!
+ * @brief Count a tick that produced no sample, producer side
+ *
+ * @param pFifo Pointer to the sample FIFO
+ *
+ * @return None
+ */
+void sampleFifoMissTick(sample_fifo_t *pFifo);
+
+/*!
+ * @brief Push a sample, producer side
+ *        The sample is dropped and counted as overrun if the FIFO is full
+ *
+ * @param pFifo Pointer to the sample FIFO
+ * @param pRawData Pointer to the sensor raw data
+ * @param ui32Tick Tick the data was read at
+ *
+ * @return 1 for success, 0 if the FIFO is full
+ */
+int8_t sampleFifoPush(sample_fifo_t *pFifo, const raw_data_xyzt_t *pRawData, uint32_t ui32Tick);
+
+/*!
+ * @brief Pop the oldest sample, consumer side
+ *
+ * @param pFifo Pointer to the sample FIFO
+ * @param pEntry Pointer to store the sample
+ *
+ * @return 1 for success, 0 if the FIFO is empty
+ */
+int8_t sampleFifoPop(sample_fifo_t *pFifo, sample_fifo_entry_t *pEntry);
+
+/*!
+ * @brief Get the sample FIFO statistics
+ *
+ * @param pFifo Pointer to the sample FIFO
+ * @param pStats Pointer to store the statistics
+ *
+ * @return None
+ */
+void getSampleFifoStats(sample_fifo_t *pFifo, sample_fifo_stats_t *pStats);
+
+#endif //__SAMPLE_FIFO_H__
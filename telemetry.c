@@ -0,0 +1,217 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : telemetry.c
+ *
+ * Usage: Compact binary telemetry frames
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+#include "telemetry.h"
+
+#define FRAME_HEADER_LEN (3) //sync, type, length
+
+//CRC-8 of each nibble shifted to the top, polynomial 0x07
+static const uint8_t crc8Nibble[16] = {
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+/*!
+ * @brief Start a frame
+ *
+ * @param pFrame Pointer to the frame
+ * @param type Frame type
+ *
+ * @return None
+ */
+void telemetryBegin(telemetry_frame_t *pFrame, telemetry_type_t type)
+{
+
+  pFrame->buf[0] = TELEMETRY_SYNC;
+  pFrame->buf[1] = (uint8_t)type;
+  pFrame->buf[2] = 0;
+  pFrame->ui8Len = FRAME_HEADER_LEN;
+  pFrame->ui8Overflow = 0;
+}
+
+/*!
+ * @brief Append an unsigned value to the payload
+ *
+ * @param pFrame Pointer to the frame
+ * @param ui32Val Value
+ *
+ * @return None
+ */
+void telemetryPutU32(telemetry_frame_t *pFrame, uint32_t ui32Val)
+{
+
+  //7 bits per byte, low bits first, MSB set on all but the last byte
+  do{
+
+    if(pFrame->ui8Len >= FRAME_HEADER_LEN + TELEMETRY_PAYLOAD_MAX){
+      pFrame->ui8Overflow = 1;
+      return;
+    }
+
+    pFrame->buf[pFrame->ui8Len++] = (uint8_t)((ui32Val & 0x7F) | ((ui32Val > 0x7F) ? 0x80 : 0));
+    ui32Val >>= 7;
+
+  }while(ui32Val != 0);
+}
+
+/*!
+ * @brief Append a signed value to the payload
+ *
+ * @param pFrame Pointer to the frame
+ * @param i32Val Value
+ *
+ * @return None
+ */
+void telemetryPutS32(telemetry_frame_t *pFrame, int32_t i32Val)
+{
+
+  //zig-zag, small magnitudes of either sign give small codes
+  telemetryPutU32(pFrame, ((uint32_t)i32Val << 1) ^ (uint32_t)(i32Val >> 31));
+}
+
+/*!
+ * @brief Append bytes to the payload as they are
+ *
+ * @param pFrame Pointer to the frame
+ * @param pData Bytes to append
+ * @param ui32Len Number of bytes
+ *
+ * @return None
+ */
+void telemetryPutBytes(telemetry_frame_t *pFrame, const uint8_t *pData, uint32_t ui32Len)
+{
+
+  uint32_t i;
+
+  if(pFrame->ui8Len + ui32Len > FRAME_HEADER_LEN + TELEMETRY_PAYLOAD_MAX){
+    pFrame->ui8Overflow = 1;
+    return;
+  }
+
+  for(i = 0; i < ui32Len; ++i)
+    pFrame->buf[pFrame->ui8Len++] = pData[i];
+}
+
+/*!
+ * @brief Finish a frame, fill in the length and the CRC
+ *
+ * @param pFrame Pointer to the frame
+ *
+ * @return Frame size in bytes, 0 if the payload did not fit
+ */
+uint32_t telemetryEnd(telemetry_frame_t *pFrame)
+{
+
+  if(pFrame->ui8Overflow)
+    return 0;
+
+  pFrame->buf[2] = pFrame->ui8Len - FRAME_HEADER_LEN;
+  pFrame->buf[pFrame->ui8Len] = telemetryCrc8(&pFrame->buf[1], pFrame->ui8Len - 1);
+
+  return pFrame->ui8Len + 1;
+}
+
+/*!
+ * @brief CRC-8 of the frame, polynomial 0x07
+ *
+ * @param pData Data
+ * @param ui32Len Number of bytes
+ *
+ * @return CRC
+ */
+uint8_t telemetryCrc8(const uint8_t *pData, uint32_t ui32Len)
+{
+
+  uint8_t ui8Crc = 0;
+  uint32_t i;
+
+  //one nibble per table lookup, high nibble first
+  for(i = 0; i < ui32Len; ++i){
+
+    ui8Crc ^= pData[i];
+    ui8Crc = (uint8_t)(ui8Crc << 4) ^ crc8Nibble[ui8Crc >> 4];
+    ui8Crc = (uint8_t)(ui8Crc << 4) ^ crc8Nibble[ui8Crc >> 4];
+  }
+
+  return ui8Crc;
+}
+
+/*!
+ * @brief Read an unsigned value from a payload
+ *
+ * @param pData Payload
+ * @param ui32Len Payload bytes
+ * @param pui32Pos Pointer to the read position, advanced past the value
+ * @param pui32Val Pointer to store the value
+ *
+ * @return 1 for success, 0 if the payload ends or the value is malformed
+ */
+int8_t telemetryGetU32(const uint8_t *pData, uint32_t ui32Len, uint32_t *pui32Pos, uint32_t *pui32Val)
+{
+
+  uint32_t ui32Val = 0, ui32Shift = 0;
+  uint8_t ui8Byte;
+
+  do{
+
+    if(*pui32Pos >= ui32Len || ui32Shift > 28)
+      return 0;
+
+    ui8Byte = pData[(*pui32Pos)++];
+    ui32Val |= (uint32_t)(ui8Byte & 0x7F) << ui32Shift;
+    ui32Shift += 7;
+
+  }while(ui8Byte & 0x80);
+
+  *pui32Val = ui32Val;
+
+  return 1;
+}
+
+/*!
+ * @brief Read a signed value from a payload
+ *
+ * @param pData Payload
+ * @param ui32Len Payload bytes
+ * @param pui32Pos Pointer to the read position, advanced past the value
+ * @param pi32Val Pointer to store the value
+ *
+ * @return 1 for success, 0 if the payload ends or the value is malformed
+ */
+int8_t telemetryGetS32(const uint8_t *pData, uint32_t ui32Len, uint32_t *pui32Pos, int32_t *pi32Val)
+{
+
+  uint32_t ui32Val;
+
+  if(!telemetryGetU32(pData, ui32Len, pui32Pos, &ui32Val))
+    return 0;
+
+  *pi32Val = (int32_t)((ui32Val >> 1) ^ (0 - (ui32Val & 0x01)));
+
+  return 1;
+}
@@ -0,0 +1,169 @@
+/*
+ *
+ ****************************************************************************
+ * Copyright (C) 2016 GlobalMEMS, Inc. <www.globalmems.com>
+ * All rights reserved.
+ *
+ * File : telemetry.h
+ *
+ * Usage: Compact binary telemetry frames
+ *
+ ****************************************************************************
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ **************************************************************************/
+
+/*! @file telemetry.h
+ *  @brief Framed binary telemetry, a replacement of the text output
+ *
+ *  Frame: SYNC | type | length | payload | CRC-8
+ *  - SYNC: TELEMETRY_SYNC
+ *  - length: payload bytes, up to TELEMETRY_PAYLOAD_MAX
+ *  - payload: sequence of varints, LEB128 for unsigned values, zig-zag
+ *    LEB128 for signed values
+ *  - CRC-8: polynomial 0x07, initial value 0, over type, length and payload
+ *
+ *  Payload of each frame type:
+ *  - TELEMETRY_TYPE_EVENT: algorithm bit index, data (signed), sample index
+ *  - TELEMETRY_TYPE_STATE: sample index, then the state (signed) of each
+ *    algorithm, in motion_algorithm_t bit order
+ *  - TELEMETRY_TYPE_METRICS: metrics source id, then the unsigned values
+ *    of that source
+ *  - TELEMETRY_TYPE_SAMPLES: a block of raw samples, see sample_codec.h
+ *  - TELEMETRY_TYPE_EVENT_BATCH: a packet of events, see event_batch.h
+ *  - TELEMETRY_TYPE_CAPTURE: raw samples around a fall, see sample_capture.h
+ */
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdint.h>
+
+#define TELEMETRY_SYNC          (0xA5)
+#define TELEMETRY_PAYLOAD_MAX   (128)
+#define TELEMETRY_FRAME_MAX     (TELEMETRY_PAYLOAD_MAX + 4)
+
+typedef enum {
+  TELEMETRY_TYPE_EVENT   = 1,
+  TELEMETRY_TYPE_STATE   = 2,
+  TELEMETRY_TYPE_METRICS = 3,
+  TELEMETRY_TYPE_SAMPLES = 4,
+  TELEMETRY_TYPE_EVENT_BATCH = 5,
+  TELEMETRY_TYPE_CAPTURE = 6
+} telemetry_type_t;
+
+typedef enum {
+  TELEMETRY_METRICS_SAMPLE_FIFO = 1,  //sample_fifo_stats_t, in field order, then the sample period in ms
+  TELEMETRY_METRICS_EVENT_QUEUE = 2,  //motion_event_queue_stats_t, in field order
+  TELEMETRY_METRICS_TELEMETRY   = 3,  //frames dropped on a full UART FIFO
+  TELEMETRY_METRICS_EVENT_BATCH = 4,  //event_batch_stats_t, in field order
+  TELEMETRY_METRICS_CAPTURE     = 5   //sample_capture_stats_t, in field order
+} telemetry_metrics_t;
+
+typedef struct{
+
+  uint8_t ui8Len;                        //frame bytes so far
+  uint8_t ui8Overflow;                   //payload did not fit, frame is invalid
+  uint8_t buf[TELEMETRY_FRAME_MAX];
+
+} telemetry_frame_t;
+
+/*!
+ * @brief Start a frame
+ *
+ * @param pFrame Pointer to the frame
+ * @param type Frame type
+ *
+ * @return None
+ */
+void telemetryBegin(telemetry_frame_t *pFrame, telemetry_type_t type);
+
+/*!
+ * @brief Append an unsigned value to the payload
+ *
+ * @param pFrame Pointer to the frame
+ * @param ui32Val Value
+ *
+ * @return None
+ */
+void telemetryPutU32(telemetry_frame_t *pFrame, uint32_t ui32Val);
+
+/*!
+ * @brief Append a signed value to the payload
+ *
+ * @param pFrame Pointer to the frame
+ * @param i32Val Value
+ *
+ * @return None
+ */
+void telemetryPutS32(telemetry_frame_t *pFrame, int32_t i32Val);
+
+/*!
+ * @brief Append bytes to the payload as they are
+ *
+ * @param pFrame Pointer to the frame
+ * @param pData Bytes to append
+ * @param ui32Len Number of bytes
+ *
+ * @return None
+ */
+void telemetryPutBytes(telemetry_frame_t *pFrame, const uint8_t *pData, uint32_t ui32Len);
+
+/*!
+ * @brief Finish a frame, fill in the length and the CRC
+ *
+ * @param pFrame Pointer to the frame
+ *
+ * @return Frame size in bytes, 0 if the payload did not fit
+ */
+uint32_t telemetryEnd(telemetry_frame_t *pFrame);
+
+/*!
+ * @brief CRC-8 of the frame, polynomial 0x07
+ *
+ * @param pData Data
+ * @param ui32Len Number of bytes
+ *
+ * @return CRC
+ */
+uint8_t telemetryCrc8(const uint8_t *pData, uint32_t ui32Len);
+
+/*!
+ * @brief Read an unsigned value from a payload
+ *
+ * @param pData Payload
+ * @param ui32Len Payload bytes
+ * @param pui32Pos Pointer to the read position, advanced past the value
+ * @param pui32Val Pointer to store the value
+ *
+ * @return 1 for success, 0 if the payload ends or the value is malformed
+ */
+int8_t telemetryGetU32(const uint8_t *pData, uint32_t ui32Len, uint32_t *pui32Pos, uint32_t *pui32Val);
+
+/*!
+ * @brief Read a signed value from a payload
+ *
+ * @param pData Payload
+ * @param ui32Len Payload bytes
+ * @param pui32Pos Pointer to the read position, advanced past the value
+ * @param pi32Val Pointer to store the value
+ *
+ * @return 1 for success, 0 if the payload ends or the value is malformed
+ */
+int8_t telemetryGetS32(const uint8_t *pData, uint32_t ui32Len, uint32_t *pui32Pos, int32_t *pi32Val);
+
+#endif //__TELEMETRY_H__